@@ -1,4 +1,7 @@
 #include "bidirectional_stream_copy.hh"
+#include "ethernet_adapter.hh"
+#include "netem_adapter.hh"
+#include "random.hh"
 #include "tcp_config.hh"
 #include "tcp_minnow_socket.hh"
 #include "tun.hh"
@@ -27,7 +30,8 @@ void show_usage( const char* argv0, const char* msg )
        << "   -l              Server (listen) mode.                           (client mode)\n"
        << "                   In server mode, <host>:<port> is the address to bind.\n\n"
 
-       << "   -a <addr>       Set source address (client mode only)           " << LOCAL_ADDRESS_DFLT << "\n"
+       << "   -a <addr>       Set source address (client mode, and the tap    " << LOCAL_ADDRESS_DFLT << "\n"
+       << "                   device's address in either mode)\n"
        << "   -s <port>       Set source port (client mode only)              (random)\n\n"
 
        << "   -w <winsz>      Use a window of <winsz> bytes                   " << TCPConfig::MAX_PAYLOAD_SIZE
@@ -35,11 +39,29 @@ void show_usage( const char* argv0, const char* msg )
 
        << "   -t <tmout>      Set rt_timeout to tmout                         " << TCPConfig::TIMEOUT_DFLT << "\n\n"
 
-       << "   -d <tundev>     Connect to tun <tundev>                         " << TUN_DFLT << "\n\n"
+       << "   -d <tundev>     Connect to tun <tundev>                         " << TUN_DFLT << "\n"
+       << "   -o              Use tun checksum/segmentation offload if the    (off)\n"
+       << "                   kernel supports it\n"
+       << "   -e <tapdev>     Connect to tap <tapdev> instead, through ARP    (tun)\n"
+       << "                   and Ethernet\n"
+       << "   -g <addr>       Send to next hop <addr> on the tap device       (<addr>'s x.y.z.1)\n\n"
 
        << "   -Lu <loss>      Set uplink loss to <rate> (float in 0..1)       (no loss)\n"
        << "   -Ld <loss>      Set downlink loss to <rate> (float in 0..1)     (no loss)\n\n"
 
+       << "   -Nd <ms>        Emulate a link for outgoing segments: delay     (none)\n"
+       << "                   them by <ms>\n"
+       << "   -Nj <ms>        ... with a jitter of up to <ms> either way      (none)\n"
+       << "   -Nr <Mbit/s>    ... with a bandwidth cap of <Mbit/s>            (none)\n"
+       << "   -Nb <bytes>     ... letting bursts of <bytes> through           (one segment)\n"
+       << "   -Nq <segs>      ... queueing up to <segs> segments for it       1000\n"
+       << "   -No <p>         ... sending a fraction <p> out of order         (none)\n"
+       << "   -Nc <p>         ... duplicating a fraction <p>                  (none)\n"
+       << "   -Nl <p>         ... losing a fraction <p>                       (none)\n"
+       << "   -Ng <p>,<r>     ... losing them in bursts (Gilbert-Elliott:     (none)\n"
+       << "                   enter bad state w.p. <p>, leave w.p. <r>)\n"
+       << "   -Ns <seed>      ... making random choices from <seed>           (random)\n\n"
+
        << "   -h              Show this message.\n\n";
 
   if ( msg != nullptr ) {
@@ -56,13 +78,53 @@ void check_argc( const span<char*>& args, size_t curr, const char* err )
   }
 }
 
-tuple<TCPConfig, FdAdapterConfig, bool, const char*> get_config( const span<char*>& args )
+// The device to send and receive datagrams on: a tun device, or a tap device (with an address of our own on it)
+struct DeviceConfig
+{
+  const char* tundev = nullptr;
+  bool offload = false;
+  const char* tapdev = nullptr;
+  string address {};
+  string gateway {};
+};
+
+// Parse a probability, between 0 and 1, from the start of `arg`, leaving `end` just past it
+bool parse_probability( const char* arg, char*& end, double& probability )
+{
+  probability = strtod( arg, &end );
+  return end != arg and probability >= 0 and probability <= 1;
+}
+
+// Parse a probability for -No, -Nc or -Nl, or show usage and exit
+double get_probability( const span<char*>& args, size_t curr )
+{
+  char* end = nullptr;
+  double probability = 0;
+  if ( not parse_probability( args[curr + 1], end, probability ) or *end != '\0' ) {
+    show_usage( args[0], ( "ERROR: "s + args[curr] + " takes a probability, between 0 and 1." ).c_str() );
+    exit( 1 );
+  }
+  return probability;
+}
+
+// Parse "<p>,<r>" for -Ng
+bool parse_gilbert( const char* arg, NetemConfig& c_link )
+{
+  char* end = nullptr;
+  if ( not parse_probability( arg, end, c_link.gilbert_p ) or *end != ',' ) {
+    return false;
+  }
+  return parse_probability( end + 1, end, c_link.gilbert_r ) and *end == '\0';
+}
+
+tuple<TCPConfig, FdAdapterConfig, bool, DeviceConfig, NetemConfig> get_config( const span<char*>& args )
 {
   TCPConfig c_fsm {};
   c_fsm.isn = Wrap32 { random_device()() };
 
   FdAdapterConfig c_filt {};
-  const char* tundev = nullptr;
+  DeviceConfig c_dev {};
+  NetemConfig c_link {};
 
   size_t curr = 1;
   bool listen = false;
@@ -98,7 +160,21 @@ tuple<TCPConfig, FdAdapterConfig, bool, const char*> get_config( const span<char
 
     } else if ( strncmp( "-d", args[curr], 3 ) == 0 ) {
       check_argc( args, curr, "ERROR: -t requires one argument." );
-      tundev = args[curr + 1];
+      c_dev.tundev = args[curr + 1];
+      curr += 2;
+
+    } else if ( strncmp( "-o", args[curr], 3 ) == 0 ) {
+      c_dev.offload = true;
+      curr += 1;
+
+    } else if ( strncmp( "-e", args[curr], 3 ) == 0 ) {
+      check_argc( args, curr, "ERROR: -e requires one argument." );
+      c_dev.tapdev = args[curr + 1];
+      curr += 2;
+
+    } else if ( strncmp( "-g", args[curr], 3 ) == 0 ) {
+      check_argc( args, curr, "ERROR: -g requires one argument." );
+      c_dev.gateway = args[curr + 1];
       curr += 2;
 
     } else if ( strncmp( "-Lu", args[curr], 3 ) == 0 ) {
@@ -117,6 +193,59 @@ tuple<TCPConfig, FdAdapterConfig, bool, const char*> get_config( const span<char
         = static_cast<LossRateDnT>( static_cast<float>( numeric_limits<LossRateDnT>::max() ) * lossrate );
       curr += 2;
 
+    } else if ( strncmp( "-Nd", args[curr], 4 ) == 0 ) {
+      check_argc( args, curr, "ERROR: -Nd requires one argument." );
+      c_link.delay_ms = strtoul( args[curr + 1], nullptr, 0 );
+      curr += 2;
+
+    } else if ( strncmp( "-Nj", args[curr], 4 ) == 0 ) {
+      check_argc( args, curr, "ERROR: -Nj requires one argument." );
+      c_link.jitter_ms = strtoul( args[curr + 1], nullptr, 0 );
+      curr += 2;
+
+    } else if ( strncmp( "-Nr", args[curr], 4 ) == 0 ) {
+      check_argc( args, curr, "ERROR: -Nr requires one argument." );
+      c_link.rate_bps = static_cast<uint64_t>( strtod( args[curr + 1], nullptr ) * 1e6 );
+      curr += 2;
+
+    } else if ( strncmp( "-Nb", args[curr], 4 ) == 0 ) {
+      check_argc( args, curr, "ERROR: -Nb requires one argument." );
+      c_link.burst_bytes = strtoul( args[curr + 1], nullptr, 0 );
+      curr += 2;
+
+    } else if ( strncmp( "-Nq", args[curr], 4 ) == 0 ) {
+      check_argc( args, curr, "ERROR: -Nq requires one argument." );
+      c_link.queue_limit = strtoul( args[curr + 1], nullptr, 0 );
+      curr += 2;
+
+    } else if ( strncmp( "-No", args[curr], 4 ) == 0 ) {
+      check_argc( args, curr, "ERROR: -No requires one argument." );
+      c_link.reorder = get_probability( args, curr );
+      curr += 2;
+
+    } else if ( strncmp( "-Nc", args[curr], 4 ) == 0 ) {
+      check_argc( args, curr, "ERROR: -Nc requires one argument." );
+      c_link.duplicate = get_probability( args, curr );
+      curr += 2;
+
+    } else if ( strncmp( "-Nl", args[curr], 4 ) == 0 ) {
+      check_argc( args, curr, "ERROR: -Nl requires one argument." );
+      c_link.loss_good = get_probability( args, curr );
+      curr += 2;
+
+    } else if ( strncmp( "-Ng", args[curr], 4 ) == 0 ) {
+      check_argc( args, curr, "ERROR: -Ng requires one argument." );
+      if ( not parse_gilbert( args[curr + 1], c_link ) ) {
+        show_usage( args[0], "ERROR: -Ng takes two probabilities, between 0 and 1, as <p>,<r>." );
+        exit( 1 );
+      }
+      curr += 2;
+
+    } else if ( strncmp( "-Ns", args[curr], 4 ) == 0 ) {
+      check_argc( args, curr, "ERROR: -Ns requires one argument." );
+      c_link.seed = strtoull( args[curr + 1], nullptr, 0 );
+      curr += 2;
+
     } else if ( strncmp( "-h", args[curr], 3 ) == 0 ) {
       show_usage( args[0], nullptr );
       exit( 0 );
@@ -139,7 +268,38 @@ tuple<TCPConfig, FdAdapterConfig, bool, const char*> get_config( const span<char
     c_filt.source = { source_address, source_port };
   }
 
-  return make_tuple( c_fsm, c_filt, listen, tundev );
+  c_dev.address = source_address;
+  if ( c_dev.gateway.empty() ) {
+    const uint32_t address = Address { source_address }.ipv4_numeric();
+    c_dev.gateway = Address::from_ipv4_numeric( ( address & 0xffffff00 ) | 1 ).ip();
+  }
+
+  return make_tuple( c_fsm, c_filt, listen, c_dev, c_link );
+}
+
+template<class SocketT>
+void run( SocketT& tcp_socket, const TCPConfig& c_fsm, const FdAdapterConfig& c_filt, bool listen )
+{
+  if ( listen ) {
+    tcp_socket.listen_and_accept( c_fsm, c_filt );
+  } else {
+    tcp_socket.connect( c_fsm, c_filt );
+  }
+
+  bidirectional_stream_copy( tcp_socket, tcp_socket.peer_address().to_string() );
+  tcp_socket.wait_until_closed();
+}
+
+// A locally administered, unicast Ethernet address
+EthernetAddress random_ethernet_address()
+{
+  auto rng = get_random_engine();
+  EthernetAddress address {};
+  for ( auto& byte : address ) {
+    byte = static_cast<uint8_t>( rng() );
+  }
+  address.front() = ( address.front() | 0x02 ) & 0xfe;
+  return address;
 }
 } // namespace
 
@@ -157,18 +317,23 @@ int main( int argc, char** argv )
       return EXIT_FAILURE;
     }
 
-    auto [c_fsm, c_filt, listen, tun_dev_name] = get_config( args );
-    LossyTCPOverIPv4MinnowSocket tcp_socket( LossyFdAdapter<TCPOverIPv4OverTunFdAdapter>(
-      TCPOverIPv4OverTunFdAdapter( TunFD( tun_dev_name == nullptr ? TUN_DFLT : tun_dev_name ) ) ) );
-
-    if ( listen ) {
-      tcp_socket.listen_and_accept( c_fsm, c_filt );
-    } else {
-      tcp_socket.connect( c_fsm, c_filt );
+    auto [c_fsm, c_filt, listen, c_dev, c_link] = get_config( args );
+    if ( c_dev.tapdev != nullptr ) {
+      TCPOverIPv4OverEthernetAdapter adapter {
+        TapFD { c_dev.tapdev }, random_ethernet_address(), Address { c_dev.address }, Address { c_dev.gateway } };
+      TCPMinnowSocket<NetemAdapter<LossyFdAdapter<TCPOverIPv4OverEthernetAdapter>>> tcp_socket(
+        NetemAdapter { LossyFdAdapter<TCPOverIPv4OverEthernetAdapter>( move( adapter ) ), c_link } );
+      run( tcp_socket, c_fsm, c_filt, listen );
+      return EXIT_SUCCESS;
     }
 
-    bidirectional_stream_copy( tcp_socket, tcp_socket.peer_address().to_string() );
-    tcp_socket.wait_until_closed();
+    TunFD tun { c_dev.tundev == nullptr ? TUN_DFLT : c_dev.tundev, c_dev.offload };
+    if ( c_dev.offload and not tun.has_vnet_hdr() ) {
+      cerr << "Warning: tun offload not supported by this kernel; continuing without it.\n";
+    }
+    TCPMinnowSocket<NetemAdapter<LossyFdAdapter<TCPOverIPv4OverTunFdAdapter>>> tcp_socket( NetemAdapter {
+      LossyFdAdapter<TCPOverIPv4OverTunFdAdapter>( TCPOverIPv4OverTunFdAdapter( move( tun ) ) ), c_link } );
+    run( tcp_socket, c_fsm, c_filt, listen );
   } catch ( const exception& e ) {
     cerr << "Exception: " << e.what() << endl;
     return EXIT_FAILURE;
@@ -56,7 +56,24 @@ ttest(send_extra)
 
 ttest(net_interface)
 
+ttest(datagram_read_alloc)
+ttest(checksum)
+ttest(header_layout)
+ttest(packet_buffer)
+ttest(parser_views)
+ttest(tcp_peer_batch)
+ttest(send_path_alloc)
+ttest(arp_cache)
+
 ttest(router)
+ttest(route_churn)
+ttest(ipv4_fragments)
+ttest(ethernet_adapter)
+ttest(frame_path_alloc)
+ttest(loopback_adapter)
+ttest(netem_adapter)
+ttest(tcp_simulation)
+ttest(outbound_ring)
 
 add_custom_target (check0 COMMAND ${CMAKE_CTEST_COMMAND} --output-on-failure --stop-on-failure --timeout 12 -R 'webget|^byte_stream_')
 
@@ -90,3 +107,16 @@ set_tests_properties(${compile_name_opt} PROPERTIES FIXTURES_SETUP compile_opt)
 
 stest(byte_stream_speed_test)
 stest(reassembler_speed_test)
+stest(outbound_channel_speed_test)
+stest(checksum_speed_test)
+stest(copy_checksum_speed_test)
+stest(parse_speed_test)
+stest(header_layout_speed_test)
+stest(transmit_speed_test)
+stest(arp_cache_speed_test)
+stest(router_speed_test)
+stest(router_forward_speed_test)
+stest(ipv4_fragments_speed_test)
+stest(ethernet_adapter_speed_test)
+stest(e2e_speed_test)
+stest(tcp_simulation_speed_test)
@@ -3,13 +3,23 @@
 TUN_IP_PREFIX=169.254
 
 show_usage () {
-    echo "Usage: $0 <start | stop | restart | check> [tunnum ...]"
+    echo "Usage: $0 <start | stop | restart | check> [tunnum | tap<num> ...]"
     exit 1
 }
 
+# "144" is the tun device tun144, and "tap146" the tap device tap146 (an Ethernet link, for
+# tcp_ipv4 -e); either way the number picks the device's /24
+dev_mode () {
+    [ "${1#tap}" != "$1" ] && echo tap || echo tun
+}
+
+dev_name () {
+    [ "${1#tap}" != "$1" ] && echo "$1" || echo "tun$1"
+}
+
 start_tun () {
-    local TUNNUM="$1" TUNDEV="tun$1"
-    ip tuntap add mode tun user "${SUDO_USER}" name "${TUNDEV}"
+    local TUNNUM="${1#tap}" TUNDEV="$(dev_name "$1")"
+    ip tuntap add mode "$(dev_mode "$1")" user "${SUDO_USER}" name "${TUNDEV}"
     ip addr add "${TUN_IP_PREFIX}.${TUNNUM}.1/24" dev "${TUNDEV}"
     ip link set dev "${TUNDEV}" up
     ip route change "${TUN_IP_PREFIX}.${TUNNUM}.0/24" dev "${TUNDEV}" rto_min 10ms
@@ -21,10 +31,10 @@ start_tun () {
 }
 
 stop_tun () {
-    local TUNDEV="tun$1"
-    iptables -t nat -D PREROUTING -s ${TUN_IP_PREFIX}.${1}.0/24 -j CONNMARK --set-mark ${1}
-    iptables -t nat -D POSTROUTING -j MASQUERADE -m connmark --mark ${1}
-    ip tuntap del mode tun name "$TUNDEV"
+    local TUNNUM="${1#tap}" TUNDEV="$(dev_name "$1")"
+    iptables -t nat -D PREROUTING -s ${TUN_IP_PREFIX}.${TUNNUM}.0/24 -j CONNMARK --set-mark ${TUNNUM}
+    iptables -t nat -D POSTROUTING -j MASQUERADE -m connmark --mark ${TUNNUM}
+    ip tuntap del mode "$(dev_mode "$1")" name "$TUNDEV"
 }
 
 start_all () {
@@ -48,7 +58,7 @@ restart_all() {
 
 check_tun () {
     [ "$#" != 1 ] && { echo "bad params in check_tun"; exit 1; }
-    local TUNDEV="tun${1}"
+    local TUNDEV="$(dev_name "$1")"
     # make sure tun is healthy: device is up, ip_forward is set, and iptables is configured
     ip link show ${TUNDEV} &>/dev/null || return 1
     [ "$(cat /proc/sys/net/ipv4/ip_forward)" = "1" ] || return 2
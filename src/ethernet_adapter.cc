@@ -0,0 +1,71 @@
+#include "ethernet_adapter.hh"
+#include "parser.hh"
+
+#include <array>
+#include <span>
+#include <string>
+#include <utility>
+
+using namespace std;
+
+TCPOverIPv4OverEthernetAdapter::TCPOverIPv4OverEthernetAdapter( FileDescriptor&& device,
+                                                                const EthernetAddress& ethernet_address,
+                                                                const Address& ip_address,
+                                                                const Address& next_hop )
+  : port_( make_shared<FrameWriter>( move( device ) ) )
+  , interface_( "ethernet adapter", port_, ethernet_address, ip_address )
+  , next_hop_( next_hop.ipv4_numeric() )
+{}
+
+optional<TCPMessage> TCPOverIPv4OverEthernetAdapter::read()
+{
+  const size_t bytes_read = fd().read( span { read_buffer_.get(), MAX_FRAME_SIZE } );
+  if ( bytes_read == 0 ) {
+    return {}; // non-blocking and nothing to read
+  }
+
+  // the frame, and the datagram in it, are parsed in place (the TCP payload is the only copy made)
+  Parser parser { string_view { read_buffer_.get(), bytes_read } };
+  EthernetFrameView frame;
+  frame.parse( parser );
+  if ( parser.has_error() ) {
+    return {};
+  }
+  const auto dgram = interface_.recv_frame( frame );
+  if ( not dgram.has_value() ) {
+    return {};
+  }
+  return unwrap_tcp_in_ip( *dgram );
+}
+
+void TCPOverIPv4OverEthernetAdapter::write( const TCPMessage& seg )
+{
+  const auto [ip_header, tcp_header] = wrap_headers( seg );
+  Serializer serializer { span { tcp_header_ } };
+  tcp_header.serialize( serializer );
+  const array<string_view, 2> payload { string_view { tcp_header_.data(), tcp_header_.size() },
+                                        seg.sender.payload };
+  interface_.send_datagram( ip_header, payload, next_hop_ );
+}
+
+void TCPOverIPv4OverEthernetAdapter::tick( const size_t ms_since_last_tick )
+{
+  interface_.tick( ms_since_last_tick );
+  TCPOverIPv4Adapter::tick( ms_since_last_tick );
+}
+
+void TCPOverIPv4OverEthernetAdapter::FrameWriter::transmit( const NetworkInterface& sender [[maybe_unused]],
+                                                             const EthernetFrame& frame )
+{
+  device_.write( serialize( frame ) );
+}
+
+void TCPOverIPv4OverEthernetAdapter::FrameWriter::transmit_serialized(
+  const NetworkInterface& sender [[maybe_unused]],
+  span<const string_view> frame )
+{
+  device_.write( frame );
+}
+
+// Specialize LossyFdAdapter to TCPOverIPv4OverEthernetAdapter
+template class LossyFdAdapter<TCPOverIPv4OverEthernetAdapter>;
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "address.hh"
+#include "ethernet_frame.hh"
+#include "file_descriptor.hh"
+#include "lossy_fd_adapter.hh"
+#include "network_interface.hh"
+#include "tcp_config.hh"
+#include "tcp_over_ip.hh"
+#include "tuntap_adapter.hh"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+// A FD adapter for IPv4 datagrams carried in Ethernet frames, read from and written to a TAP device (or
+// anything else that keeps frames apart, such as a datagram socket). The datagrams go through a
+// NetworkInterface, so this is the whole stack at the link layer: the interface puts each datagram in a frame,
+// finds the next hop's Ethernet address with ARP (holding datagrams until the reply comes), and answers the
+// ARP requests of whoever is on the other side.
+class TCPOverIPv4OverEthernetAdapter : public TCPOverIPv4Adapter
+{
+public:
+  // `ethernet_address` and `ip_address` are the interface's own; every datagram is sent to `next_hop` (e.g. the
+  // host's address on the TAP device, which routes it on)
+  TCPOverIPv4OverEthernetAdapter( FileDescriptor&& device,
+                                  const EthernetAddress& ethernet_address,
+                                  const Address& ip_address,
+                                  const Address& next_hop );
+
+  // Reads one frame and hands it to the NetworkInterface, parsed in place; returns the TCP segment in it, if it
+  // carries one for the current connection (ARP frames are answered or learned from, but carry none)
+  std::optional<TCPMessage> read();
+
+  // Sends a TCP segment in an IPv4 datagram to the next hop through the NetworkInterface (once the next hop's
+  // address is known, only the headers are serialized, and the payload goes from the TCPMessage to the device)
+  void write( const TCPMessage& seg );
+
+  // One segment per frame (the device does no segmentation)
+  size_t max_payload_size() const { return TCPConfig::MAX_PAYLOAD_SIZE; }
+
+  // Called periodically when time elapses (ARP timeouts, and those of fragmented datagrams)
+  void tick( size_t ms_since_last_tick );
+
+  // Access the NetworkInterface
+  NetworkInterface& interface() { return interface_; }
+
+  // Access underlying file descriptor
+  FileDescriptor& fd() { return port_->fd(); }
+
+private:
+  // Writes the NetworkInterface's frames to the device, one write per frame (and owns the device, so that the
+  // port stays valid when the adapter is moved)
+  class FrameWriter : public NetworkInterface::OutputPort
+  {
+  public:
+    explicit FrameWriter( FileDescriptor&& device ) : device_( std::move( device ) ) {}
+    void transmit( const NetworkInterface& sender, const EthernetFrame& frame ) override;
+    void transmit_serialized( const NetworkInterface& sender, std::span<const std::string_view> frame ) override;
+    FileDescriptor& fd() { return device_; }
+
+  private:
+    FileDescriptor device_;
+  };
+
+  // Largest frame read() will accept: an Ethernet header and the largest IPv4 datagram
+  static constexpr size_t MAX_FRAME_SIZE = EthernetHeader::LENGTH + 65535;
+
+  std::shared_ptr<FrameWriter> port_;
+  NetworkInterface interface_;
+  uint32_t next_hop_;
+
+  // Buffer that read() receives every frame into
+  std::unique_ptr<char[]> read_buffer_ { std::make_unique<char[]>( MAX_FRAME_SIZE ) }; // NOLINT(*-c-arrays)
+
+  // Buffer that write() serializes every TCP header into (the NetworkInterface puts the others in front of it)
+  static constexpr size_t TCP_HEADER_LENGTH = 20; // (no options)
+  std::array<char, TCP_HEADER_LENGTH> tcp_header_ {};
+};
+
+static_assert( TCPDatagramAdapter<TCPOverIPv4OverEthernetAdapter> );
+static_assert( TCPDatagramAdapter<LossyFdAdapter<TCPOverIPv4OverEthernetAdapter>> );
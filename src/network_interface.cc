@@ -2,7 +2,9 @@
 
 #include "arp_message.hh"
 #include "exception.hh"
+#include "ipv4_fragments.hh"
 #include "network_interface.hh"
+#include "parser.hh"
 
 using namespace std;
 
@@ -27,21 +29,225 @@ NetworkInterface::NetworkInterface( string_view name,
 //! can be converted to a uint32_t (raw 32-bit IP address) by using the Address::ipv4_numeric() method.
 void NetworkInterface::send_datagram( const InternetDatagram& dgram, const Address& next_hop )
 {
-  // Your code here.
-  (void)dgram;
-  (void)next_hop;
+  send_datagram( dgram, next_hop.ipv4_numeric() );
+}
+
+void NetworkInterface::send_datagram( const IPv4Header& header,
+                                      span<const string_view> payload,
+                                      const uint32_t next_hop_ip )
+{
+  if ( header.len <= mtu_ ) {
+    if ( const auto entry = arp_table_.find( next_hop_ip ); entry != arp_table_.end() ) {
+      send_ipv4( header, payload, entry->second.ethernet_address );
+      return;
+    }
+  }
+
+  // to be fragmented, or held until the next hop's address is known: as a datagram of its own
+  InternetDatagram dgram { .header = header, .payload {} };
+  for ( const auto buffer : payload ) {
+    dgram.payload.emplace_back( buffer );
+  }
+  send_datagram( dgram, next_hop_ip );
+}
+
+void NetworkInterface::send_datagram( const InternetDatagram& dgram, const uint32_t next_hop_ip )
+{
+  if ( dgram.header.len > mtu_ ) {
+    fragment( dgram, mtu_, [&]( const InternetDatagram& piece ) { send_datagram( piece, next_hop_ip ); } );
+    return;
+  }
+
+  if ( const auto entry = arp_table_.find( next_hop_ip ); entry != arp_table_.end() ) {
+    send_ipv4( dgram, entry->second.ethernet_address );
+    return;
+  }
+
+  // Hold on to the datagram until the reply comes, and ask for the next hop's Ethernet address (at most once per
+  // ARP_REQUEST_TIMEOUT_MS). The datagram is queued first: a port that delivers frames right away may bring the
+  // reply back (and send what's waiting) before send_arp() returns.
+  auto [pending, is_new] = pending_.try_emplace( next_hop_ip, timers_.now() + ARP_REQUEST_TIMEOUT_MS );
+  auto& datagrams = pending->second.datagrams;
+  if ( datagrams.size() == MAX_PENDING_DATAGRAMS ) {
+    datagrams.pop_front();
+  }
+  datagrams.push_back( dgram );
+
+  if ( is_new ) {
+    timers_.add( ARP_REQUEST_TIMEOUT_MS, { next_hop_ip, true } );
+    send_arp( ARPMessage::OPCODE_REQUEST, {}, next_hop_ip );
+  }
 }
 
 //! \param[in] frame the incoming Ethernet frame
 void NetworkInterface::recv_frame( const EthernetFrame& frame )
 {
-  // Your code here.
-  (void)frame;
+  if ( frame.header.dst != ethernet_address_ and frame.header.dst != ETHERNET_BROADCAST ) {
+    return;
+  }
+
+  if ( frame.header.type == EthernetHeader::TYPE_IPv4 ) {
+    InternetDatagram dgram;
+    if ( parse( dgram, frame.payload ) ) {
+      datagrams_received_.push( move( dgram ) );
+    }
+    return;
+  }
+
+  if ( frame.header.type == EthernetHeader::TYPE_ARP ) {
+    ARPMessage arp;
+    if ( parse( arp, frame.payload ) ) {
+      recv_arp( arp );
+    }
+  }
+}
+
+//! \param[in] frame the incoming Ethernet frame, parsed in place
+//! \returns the IPv4 datagram the frame carries, if it's for this interface
+optional<IPv4DatagramView> NetworkInterface::recv_frame( const EthernetFrameView& frame )
+{
+  if ( frame.header.dst != ethernet_address_ and frame.header.dst != ETHERNET_BROADCAST ) {
+    return {};
+  }
+
+  Parser parser { frame.payload };
+  if ( frame.header.type == EthernetHeader::TYPE_IPv4 ) {
+    IPv4DatagramView dgram;
+    dgram.parse( parser );
+    if ( parser.has_error() ) {
+      return {};
+    }
+    return dgram;
+  }
+
+  if ( frame.header.type == EthernetHeader::TYPE_ARP ) {
+    ARPMessage arp;
+    arp.parse( parser );
+    if ( not parser.has_error() ) {
+      recv_arp( arp );
+    }
+  }
+  return {};
+}
+
+// Learn from an ARP message, and answer it if it asks for this interface's address
+void NetworkInterface::recv_arp( const ARPMessage& arp )
+{
+  if ( not arp.supported() ) {
+    return;
+  }
+
+  learn( arp.sender_ip_address, arp.sender_ethernet_address );
+
+  if ( arp.opcode == ARPMessage::OPCODE_REQUEST and arp.target_ip_address == ip_address_.ipv4_numeric() ) {
+    send_arp( ARPMessage::OPCODE_REPLY, arp.sender_ethernet_address, arp.sender_ip_address );
+  }
 }
 
 //! \param[in] ms_since_last_tick the number of milliseconds since the last call to this method
 void NetworkInterface::tick( const size_t ms_since_last_tick )
 {
-  // Your code here.
-  (void)ms_since_last_tick;
+  timers_.advance( ms_since_last_tick,
+                   [&]( const ArpTimer& timer, uint64_t deadline ) { expire( timer, deadline ); } );
+}
+
+void NetworkInterface::send_ipv4( const InternetDatagram& dgram, const EthernetAddress& dst )
+{
+  tx_frame_.resize( 1 ); // (the headers' place)
+  for ( const auto& buffer : dgram.payload ) {
+    tx_frame_.emplace_back( buffer );
+  }
+  tx_headers_.clear();
+  Serializer serializer { tx_headers_.prepend( IPv4Header::LENGTH ) };
+  dgram.header.serialize( serializer );
+  transmit( dst, EthernetHeader::TYPE_IPv4 );
+}
+
+void NetworkInterface::send_ipv4( const IPv4Header& header,
+                                  span<const string_view> payload,
+                                  const EthernetAddress& dst )
+{
+  tx_frame_.resize( 1 );
+  tx_frame_.insert( tx_frame_.end(), payload.begin(), payload.end() );
+  tx_headers_.clear();
+  Serializer serializer { tx_headers_.prepend( IPv4Header::LENGTH ) };
+  header.serialize( serializer );
+  transmit( dst, EthernetHeader::TYPE_IPv4 );
+}
+
+void NetworkInterface::send_arp( uint16_t opcode, const EthernetAddress& dst, uint32_t target_ip_address )
+{
+  ARPMessage arp;
+  arp.opcode = opcode;
+  arp.sender_ethernet_address = ethernet_address_;
+  arp.sender_ip_address = ip_address_.ipv4_numeric();
+  arp.target_ethernet_address = dst;
+  arp.target_ip_address = target_ip_address;
+
+  tx_frame_.resize( 1 );
+  tx_headers_.clear();
+  Serializer serializer { tx_headers_.prepend( ARPMessage::LENGTH ) };
+  arp.serialize( serializer );
+  transmit( opcode == ARPMessage::OPCODE_REQUEST ? ETHERNET_BROADCAST : dst, EthernetHeader::TYPE_ARP );
+}
+
+// Put the Ethernet header in front of the headers in tx_headers_, and send them with the payload in tx_frame_
+void NetworkInterface::transmit( const EthernetAddress& dst, uint16_t type )
+{
+  Serializer serializer { tx_headers_.prepend( EthernetHeader::LENGTH ) };
+  EthernetHeader { .dst = dst, .src = ethernet_address_, .type = type }.serialize( serializer );
+  tx_frame_.front() = tx_headers_.contents();
+  port_->transmit_serialized( *this, tx_frame_ );
+}
+
+void NetworkInterface::OutputPort::transmit_serialized( const NetworkInterface& sender,
+                                                        span<const string_view> frame )
+{
+  EthernetFrame parsed;
+  Parser parser { frame };
+  parsed.parse( parser );
+  transmit( sender, parsed );
+}
+
+// Remember (or refresh) a mapping, and send whatever was waiting for it
+void NetworkInterface::learn( uint32_t ip_address, const EthernetAddress& ethernet_address )
+{
+  const uint64_t expires_at = timers_.now() + ARP_ENTRY_TTL_MS;
+  const auto [entry, is_new] = arp_table_.insert_or_assign( ip_address, ArpEntry { ethernet_address, expires_at } );
+  if ( is_new ) {
+    timers_.add( ARP_ENTRY_TTL_MS, { ip_address, false } );
+  }
+
+  // take the datagrams out before sending any: the output port runs synchronously, and whatever it does (such as
+  // send another datagram through this interface) must not find the entry half-sent
+  if ( const auto pending = pending_.find( ip_address ); pending != pending_.end() ) {
+    const deque<InternetDatagram> datagrams = move( pending->second.datagrams );
+    pending_.erase( pending );
+    for ( const auto& dgram : datagrams ) {
+      send_ipv4( dgram, ethernet_address );
+    }
+  }
+}
+
+void NetworkInterface::expire( const ArpTimer& timer, uint64_t deadline )
+{
+  if ( timer.pending ) {
+    // no reply in time: drop the waiting datagrams, so that the next one sends a new request (unless this
+    // timer is stale, from a request that was answered before another was made)
+    const auto pending = pending_.find( timer.ip_address );
+    if ( pending != pending_.end() and pending->second.expires_at == deadline ) {
+      pending_.erase( pending );
+    }
+    return;
+  }
+
+  const auto entry = arp_table_.find( timer.ip_address );
+  if ( entry == arp_table_.end() ) {
+    return;
+  }
+  if ( entry->second.expires_at > timers_.now() ) {
+    timers_.add( entry->second.expires_at - timers_.now(), timer ); // refreshed since the timer was set
+  } else {
+    arp_table_.erase( entry );
+  }
 }
@@ -1,10 +1,22 @@
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
 #include <queue>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
 #include "address.hh"
+#include "arp_message.hh"
 #include "ethernet_frame.hh"
 #include "ipv4_datagram.hh"
+#include "packet_buffer.hh"
+#include "timer_wheel.hh"
 
 // A "network interface" that connects IP (the internet layer, or network layer)
 // with Ethernet (the network access layer, or link layer).
@@ -35,6 +47,12 @@ public:
   {
   public:
     virtual void transmit( const NetworkInterface& sender, const EthernetFrame& frame ) = 0;
+
+    // The interface sends every frame through this, already serialized: the Ethernet header, then the
+    // payload, in one or more buffers (valid only during the call). By default, the frame is parsed back into
+    // an EthernetFrame for transmit(); a port that sends frames out as bytes overrides this to skip that.
+    virtual void transmit_serialized( const NetworkInterface& sender, std::span<const std::string_view> frame );
+
     virtual ~OutputPort() = default;
   };
 
@@ -50,12 +68,30 @@ public:
   // hop. Sending is accomplished by calling `transmit()` (a member variable) on the frame.
   void send_datagram( const InternetDatagram& dgram, const Address& next_hop );
 
+  // The same, for a next hop given as a raw 32-bit IPv4 address (as a router has it, without making an Address)
+  void send_datagram( const InternetDatagram& dgram, uint32_t next_hop_ip );
+
+  // The same, for a datagram given as its header and its payload already serialized (e.g. a TCP header and
+  // the data after it). Sending it to a next hop whose Ethernet address is known copies and allocates nothing:
+  // the headers are serialized into headroom in front of the payload.
+  void send_datagram( const IPv4Header& header, std::span<const std::string_view> payload, uint32_t next_hop_ip );
+
+  // Largest datagram sent in one frame: a longer one is fragmented, or dropped if it says not to be ("don't
+  // fragment"; this stack doesn't send the ICMP message that would tell the sender why)
+  static constexpr size_t DEFAULT_MTU = 1500;
+  size_t mtu() const { return mtu_; }
+  void set_mtu( size_t mtu ) { mtu_ = mtu; }
+
   // Receives an Ethernet frame and responds appropriately.
   // If type is IPv4, pushes the datagram to the datagrams_in queue.
   // If type is ARP request, learn a mapping from the "sender" fields, and send an ARP reply.
   // If type is ARP reply, learn a mapping from the "sender" fields.
   void recv_frame( const EthernetFrame& frame );
 
+  // The same, for a frame parsed in place, without copying it: an IPv4 datagram is returned (as a view into
+  // the frame's buffer) rather than queued.
+  std::optional<IPv4DatagramView> recv_frame( const EthernetFrameView& frame );
+
   // Called periodically when time elapses
   void tick( size_t ms_since_last_tick );
 
@@ -71,7 +107,6 @@ private:
 
   // The physical output port (+ a helper function `transmit` that uses it to send an Ethernet frame)
   std::shared_ptr<OutputPort> port_;
-  void transmit( const EthernetFrame& frame ) const { port_->transmit( *this, frame ); }
 
   // Ethernet (known as hardware, network-access-layer, or link-layer) address of the interface
   EthernetAddress ethernet_address_;
@@ -79,6 +114,55 @@ private:
   // IP (known as internet-layer or network-layer) address of the interface
   Address ip_address_;
 
+  size_t mtu_ { DEFAULT_MTU };
+
   // Datagrams that have been received
   std::queue<InternetDatagram> datagrams_received_ {};
+
+  // Every frame sent is its headers, serialized into tx_headers_ (innermost first, each in front of the one
+  // before), and then its payload's buffers: tx_frame_ has a view of each, with the headers first
+  static constexpr size_t TX_HEADROOM
+    = EthernetHeader::LENGTH + std::max<size_t>( IPv4Header::LENGTH, ARPMessage::LENGTH );
+  PacketBuffer tx_headers_ { TX_HEADROOM, TX_HEADROOM };
+  std::vector<std::string_view> tx_frame_ {};
+
+  // How long a learned mapping lasts, and how long to wait for a reply before another ARP request
+  static constexpr uint64_t ARP_ENTRY_TTL_MS = 30000;
+  static constexpr uint64_t ARP_REQUEST_TIMEOUT_MS = 5000;
+
+  // Most datagrams kept per next hop while its Ethernet address is unknown (beyond that, the oldest are dropped)
+  static constexpr size_t MAX_PENDING_DATAGRAMS = 64;
+
+  // A learned mapping from a next hop's IP address
+  struct ArpEntry
+  {
+    EthernetAddress ethernet_address;
+    uint64_t expires_at; // (refreshing a mapping only moves this; its timer is re-armed when it fires)
+  };
+
+  // A next hop with an ARP request outstanding, and the datagrams waiting for its reply
+  struct PendingResolution
+  {
+    uint64_t expires_at;
+    std::deque<InternetDatagram> datagrams {};
+  };
+
+  // What a timer in the wheel is for: the mapping or the outstanding request for a next hop
+  struct ArpTimer
+  {
+    uint32_t ip_address;
+    bool pending;
+  };
+
+  std::unordered_map<uint32_t, ArpEntry> arp_table_ {};
+  std::unordered_map<uint32_t, PendingResolution> pending_ {};
+  TimerWheel<ArpTimer, 64, 1024> timers_ {}; // 64 ms slots, so a turn of the wheel is longer than either timeout
+
+  void send_ipv4( const InternetDatagram& dgram, const EthernetAddress& dst );
+  void send_ipv4( const IPv4Header& header, std::span<const std::string_view> payload, const EthernetAddress& dst );
+  void send_arp( uint16_t opcode, const EthernetAddress& dst, uint32_t target_ip_address );
+  void transmit( const EthernetAddress& dst, uint16_t type );
+  void recv_arp( const ARPMessage& arp );
+  void learn( uint32_t ip_address, const EthernetAddress& ethernet_address );
+  void expire( const ArpTimer& timer, uint64_t deadline );
 };
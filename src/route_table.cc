@@ -0,0 +1,161 @@
+#include "route_table.hh"
+
+#include <algorithm>
+#include <array>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace {
+// The last bit (counting from the most significant) that each level's index covers
+constexpr array<uint8_t, 3> LEVEL_END { 16, 24, 32 };
+} // namespace
+
+RouteTable::Entry RouteTable::Entry::value( uint32_t value, uint8_t prefix_length )
+{
+  Entry entry;
+  entry.raw_ = VALID | static_cast<uint32_t>( prefix_length ) << 24 | value;
+  return entry;
+}
+
+RouteTable::Entry RouteTable::Entry::group( uint32_t group_index )
+{
+  Entry entry;
+  entry.raw_ = GROUP | group_index;
+  return entry;
+}
+
+void RouteTable::lookup_batch( span<const uint32_t> addresses, span<optional<uint32_t>> results ) const
+{
+  if ( results.size() != addresses.size() ) {
+    throw runtime_error( "RouteTable::lookup_batch: results and addresses differ in length" );
+  }
+
+  constexpr size_t chunk = 64;
+  array<Entry, chunk> entries;
+  for ( size_t base = 0; base < addresses.size(); base += chunk ) {
+    const auto batch = addresses.subspan( base, min( chunk, addresses.size() - base ) );
+
+    for ( const auto address : batch ) {
+      __builtin_prefetch( &top_[address >> 16] );
+    }
+    for ( size_t i = 0; i < batch.size(); i++ ) {
+      entries[i] = top_[batch[i] >> 16];
+      if ( entries[i].is_group() ) {
+        __builtin_prefetch( &middle_[entries[i].index() << 8 | ( batch[i] >> 8 & 0xff )] );
+      }
+    }
+    for ( size_t i = 0; i < batch.size(); i++ ) {
+      if ( entries[i].is_group() ) {
+        entries[i] = middle_[entries[i].index() << 8 | ( batch[i] >> 8 & 0xff )];
+        if ( entries[i].is_group() ) {
+          __builtin_prefetch( &bottom_[entries[i].index() << 8 | ( batch[i] & 0xff )] );
+        }
+      }
+    }
+    for ( size_t i = 0; i < batch.size(); i++ ) {
+      if ( entries[i].is_group() ) {
+        entries[i] = bottom_[entries[i].index() << 8 | ( batch[i] & 0xff )];
+      }
+      results[base + i] = entries[i].valid() ? optional { entries[i].index() } : nullopt;
+    }
+  }
+}
+
+void RouteTable::insert( uint32_t prefix, uint8_t prefix_length, uint32_t value )
+{
+  if ( value > MAX_VALUE ) {
+    throw runtime_error( "RouteTable::insert: value too large" );
+  }
+
+  const Entry leaf = Entry::value( value, prefix_length );
+  const auto [run, level] = entries_covered( prefix, prefix_length, true );
+  for ( auto& entry : run ) {
+    cover( entry, level, leaf );
+  }
+}
+
+void RouteTable::remove( uint32_t prefix, uint8_t prefix_length, optional<Fallback> fallback )
+{
+  if ( fallback.has_value() and ( fallback->value > MAX_VALUE or fallback->prefix_length >= prefix_length ) ) {
+    throw runtime_error( "RouteTable::remove: invalid fallback" );
+  }
+
+  const Entry replacement
+    = fallback.has_value() ? Entry::value( fallback->value, fallback->prefix_length ) : Entry {};
+  const auto [run, level] = entries_covered( prefix, prefix_length, false );
+  for ( auto& entry : run ) {
+    uncover( entry, level, prefix_length, replacement );
+  }
+}
+
+pair<span<RouteTable::Entry>, int> RouteTable::entries_covered( uint32_t prefix,
+                                                                uint8_t prefix_length,
+                                                                bool make_groups )
+{
+  if ( prefix_length > 32 ) {
+    throw runtime_error( "RouteTable: prefix longer than 32 bits" );
+  }
+
+  Entry* table = top_.data();
+  for ( size_t level = 0; level < LEVEL_END.size(); level++ ) {
+    const uint8_t begin = level == 0 ? 0 : LEVEL_END.at( level - 1 );
+    const uint8_t end = LEVEL_END.at( level );
+    const uint32_t index = static_cast<uint32_t>( prefix >> ( 32 - end ) ) & ( ( 1U << ( end - begin ) ) - 1 );
+
+    // the prefix ends at this level: it covers a run of entries (one per value of the bits it leaves free)
+    if ( prefix_length <= end ) {
+      const uint32_t first = index & ~( ( 1U << ( end - prefix_length ) ) - 1 );
+      return { span { table + first, size_t { 1 } << ( end - prefix_length ) }, static_cast<int>( level ) };
+    }
+
+    // the prefix goes on: continue in the entry's group at the next level (making one if need be)
+    Entry& entry = table[index];
+    if ( not entry.is_group() ) {
+      if ( not make_groups ) {
+        return {}; // (so no prefix this long was ever inserted here)
+      }
+      split( entry, static_cast<int>( level ) );
+    }
+    table = ( level == 0 ? middle_ : bottom_ ).data() + ( entry.index() << 8 );
+  }
+  return {};
+}
+
+void RouteTable::cover( Entry& entry, int level, Entry value )
+{
+  if ( entry.is_group() ) {
+    auto& groups = level == 0 ? middle_ : bottom_;
+    for ( uint32_t i = 0; i < 256; i++ ) {
+      cover( groups[entry.index() << 8 | i], level + 1, value );
+    }
+  } else if ( not entry.valid() or entry.prefix_length() <= value.prefix_length() ) {
+    entry = value;
+  }
+}
+
+void RouteTable::uncover( Entry& entry, int level, uint8_t prefix_length, Entry replacement )
+{
+  if ( entry.is_group() ) {
+    auto& groups = level == 0 ? middle_ : bottom_;
+    for ( uint32_t i = 0; i < 256; i++ ) {
+      uncover( groups[entry.index() << 8 | i], level + 1, prefix_length, replacement );
+    }
+  } else if ( entry.valid() and entry.prefix_length() == prefix_length ) {
+    entry = replacement;
+  }
+}
+
+void RouteTable::split( Entry& entry, int level )
+{
+  auto& groups = level == 0 ? middle_ : bottom_;
+  const size_t group_index = groups.size() / 256;
+  if ( group_index > MAX_VALUE ) {
+    throw runtime_error( "RouteTable: too many groups" );
+  }
+  groups.insert( groups.end(), 256, entry );
+  entry = Entry::group( static_cast<uint32_t>( group_index ) );
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+// A longest-prefix-match table from IPv4 prefixes to values (e.g. the index of a route), in the style of
+// DIR-24-8 but with three levels (DIR-16-8-8): a 65,536-entry table indexed by the top 16 bits of the address,
+// and groups of 256 entries for the next 8 bits and the last 8, allocated only for prefixes longer than 16 or
+// 24 bits. Every entry holds the value of the longest prefix that covers it (or points to a group at the next
+// level), so a lookup is at most three dependent loads, however many prefixes there are, and the top level
+// takes 256 KiB rather than the 64 MiB of DIR-24-8's.
+class RouteTable
+{
+public:
+  // Largest value that can be stored
+  static constexpr uint32_t MAX_VALUE = ( 1U << 24 ) - 1;
+
+  // Map the `prefix_length`-bit prefix `prefix` (the rest of whose bits are ignored) to `value`, replacing the
+  // value of the same prefix if it was already in the table
+  void insert( uint32_t prefix, uint8_t prefix_length, uint32_t value );
+
+  // The longest prefix shorter than one being removed that covers it, whose value takes the removed one's place
+  struct Fallback
+  {
+    uint32_t value;
+    uint8_t prefix_length;
+  };
+
+  // Remove the `prefix_length`-bit prefix `prefix` (if it was in the table). The table only keeps the best
+  // value for each address, not every prefix, so the caller says what was under it: the `fallback` prefix.
+  // Groups that were made for the prefix stay (holding the fallback's value).
+  void remove( uint32_t prefix, uint8_t prefix_length, std::optional<Fallback> fallback );
+
+  // The value of the longest prefix that matches `address`, if any does
+  std::optional<uint32_t> lookup( uint32_t address ) const
+  {
+    Entry entry = top_[address >> 16];
+    if ( entry.is_group() ) {
+      entry = middle_[entry.index() << 8 | ( address >> 8 & 0xff )];
+      if ( entry.is_group() ) {
+        entry = bottom_[entry.index() << 8 | ( address & 0xff )];
+      }
+    }
+    if ( not entry.valid() ) {
+      return std::nullopt;
+    }
+    return entry.index();
+  }
+
+  // Look up many addresses at once: each level's entries are prefetched for the whole batch before any of
+  // them is read, so the cache misses of different lookups overlap instead of following one another.
+  // `results` must be as long as `addresses`.
+  void lookup_batch( std::span<const uint32_t> addresses, std::span<std::optional<uint32_t>> results ) const;
+
+  // Number of 256-entry groups at the second and third levels
+  size_t group_count() const { return ( middle_.size() + bottom_.size() ) / 256; }
+
+private:
+  // bit 31: points to a group at the next level; bit 30: holds a value; bits 24-29: the length of the prefix
+  // the value is for; bits 0-23: the value, or the index of the group
+  class Entry
+  {
+    uint32_t raw_; // (no initializer: a trivial Entry lets a table be copied as plain memory; Entry {} is 0)
+
+    static constexpr uint32_t GROUP = 1U << 31;
+    static constexpr uint32_t VALID = 1U << 30;
+
+  public:
+    static Entry value( uint32_t value, uint8_t prefix_length );
+    static Entry group( uint32_t group_index );
+
+    bool is_group() const { return raw_ & GROUP; }
+    bool valid() const { return raw_ & VALID; }
+    uint8_t prefix_length() const { return raw_ >> 24 & 0x3f; }
+    uint32_t index() const { return raw_ & MAX_VALUE; }
+  };
+
+  std::vector<Entry> top_ = std::vector<Entry>( 1 << 16 );
+  std::vector<Entry> middle_ {};
+  std::vector<Entry> bottom_ {};
+
+  // The run of entries that a prefix covers at the level where it ends, and that level (an empty run if the
+  // groups it ends in don't exist and `make_groups` is false)
+  std::pair<std::span<Entry>, int> entries_covered( uint32_t prefix, uint8_t prefix_length, bool make_groups );
+
+  // Give `entry`, and everything under it, the value of a prefix that covers all of it (where no longer
+  // prefix already has)
+  void cover( Entry& entry, int level, Entry value );
+
+  // Give whatever in `entry` has the value of a removed `prefix_length`-bit prefix the `replacement` instead
+  void uncover( Entry& entry, int level, uint8_t prefix_length, Entry replacement );
+
+  // Turn `entry` (at `level`) into a group at the next level, each of whose entries starts with its value
+  void split( Entry& entry, int level );
+};
@@ -0,0 +1,79 @@
+#include "router.hh"
+
+#include "checksum.hh"
+
+#include <span>
+#include <stdexcept>
+
+using namespace std;
+
+// route_prefix: The "up-to-32-bit" IPv4 address prefix to match the datagram's destination address against
+// prefix_length: For this route to be applicable, how many high-order (most-significant) bits of
+//    the route_prefix will need to match the corresponding bits of the datagram's destination address?
+// next_hop: The IP address of the next hop. Will be empty if the network is directly attached to the router (in
+//    which case, the next hop address should be the datagram's final destination).
+// interface_num: The index of the interface to send the datagram out on.
+void Router::add_route( const uint32_t route_prefix,
+                        const uint8_t prefix_length,
+                        const optional<Address> next_hop,
+                        const size_t interface_num )
+{
+  if ( interface_num >= interfaces_.size() ) {
+    throw runtime_error( "Router::add_route: no such interface" );
+  }
+
+  routes_.push_back(
+    { next_hop.has_value() ? optional { next_hop->ipv4_numeric() } : nullopt, interface_num } );
+  table_.insert( route_prefix, prefix_length, static_cast<uint32_t>( routes_.size() - 1 ) );
+}
+
+// Go through all the interfaces, and route every incoming datagram to its proper outgoing interface.
+void Router::route()
+{
+  for ( const auto& interface : interfaces_ ) {
+    auto& received = interface->datagrams_received();
+    while ( not received.empty() ) {
+      batch_.clear();
+      while ( not received.empty() and batch_.size() < ROUTE_BATCH ) {
+        batch_.push_back( move( received.front() ) );
+        received.pop();
+      }
+      forward_batch();
+    }
+  }
+}
+
+void Router::forward_batch()
+{
+  for ( size_t i = 0; i < batch_.size(); i++ ) {
+    destinations_[i] = batch_[i].header.dst;
+  }
+  table_.lookup_batch( span { destinations_ }.first( batch_.size() ),
+                       span { route_indices_ }.first( batch_.size() ) );
+
+  for ( size_t i = 0; i < batch_.size(); i++ ) {
+    InternetDatagram& dgram = batch_[i];
+    if ( dgram.header.ttl <= 1 or not route_indices_[i].has_value() ) {
+      continue; // TTL expired, or no route
+    }
+
+    // Decrement the TTL, and update the checksum for the one 16-bit word that changed (RFC 1624)
+    const auto ttl_and_protocol
+      = [&] { return static_cast<uint16_t>( dgram.header.ttl << 8 | dgram.header.proto ); };
+    const uint16_t old_word = ttl_and_protocol();
+    dgram.header.ttl--;
+    dgram.header.cksum = InternetChecksum::update( dgram.header.cksum, old_word, ttl_and_protocol() );
+
+    const Route& route = routes_[route_indices_[i].value()];
+    const uint32_t next_hop = route.next_hop.value_or( dgram.header.dst );
+    egress_[route.interface_num].push_back( { static_cast<uint32_t>( i ), next_hop } );
+  }
+
+  for ( size_t i = 0; i < egress_.size(); i++ ) {
+    NetworkInterface& interface = *interfaces_[i];
+    for ( const auto& outgoing : egress_[i] ) {
+      interface.send_datagram( batch_[outgoing.batch_index], outgoing.next_hop );
+    }
+    egress_[i].clear();
+  }
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <array>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "exception.hh"
+#include "network_interface.hh"
+#include "route_table.hh"
+
+// \brief A router that has multiple network interfaces and
+// performs longest-prefix-match routing between them.
+class Router
+{
+public:
+  // Add an interface to the router
+  // \param[in] interface an already-constructed network interface
+  // \returns The index of the interface after it has been added to the router
+  size_t add_interface( std::shared_ptr<NetworkInterface> interface )
+  {
+    interfaces_.push_back( notnull( "add_interface", std::move( interface ) ) );
+    egress_.emplace_back();
+    return interfaces_.size() - 1;
+  }
+
+  // Access an interface by index
+  std::shared_ptr<NetworkInterface> interface( const size_t N ) { return interfaces_.at( N ); }
+
+  // Add a route (a forwarding rule)
+  void add_route( uint32_t route_prefix,
+                  uint8_t prefix_length,
+                  std::optional<Address> next_hop,
+                  size_t interface_num );
+
+  // Route packets between the interfaces: each interface's received datagrams are taken in batches of up to
+  // ROUTE_BATCH, looked up together, and sent out once the whole batch has been sorted by egress interface
+  void route();
+
+  static constexpr size_t ROUTE_BATCH = 32;
+
+private:
+  // The router's collection of network interfaces
+  std::vector<std::shared_ptr<NetworkInterface>> interfaces_ {};
+
+  struct Route
+  {
+    std::optional<uint32_t> next_hop; // (none if the destination is on the interface's own network)
+    size_t interface_num;
+  };
+
+  // The routes, and a longest-prefix-match table from each route's prefix to its index here
+  std::vector<Route> routes_ {};
+  RouteTable table_ {};
+
+  // A datagram of the batch waiting to go out of an interface, and the IPv4 address of its next hop
+  struct Outgoing
+  {
+    uint32_t batch_index;
+    uint32_t next_hop;
+  };
+
+  // The batch being routed, its destinations and the routes found for them, and what goes out of each interface
+  // (all kept between batches, so that routing doesn't allocate once they have grown)
+  std::vector<InternetDatagram> batch_ {};
+  std::array<uint32_t, ROUTE_BATCH> destinations_ {};
+  std::array<std::optional<uint32_t>, ROUTE_BATCH> route_indices_ {};
+  std::vector<std::vector<Outgoing>> egress_ {};
+
+  // Look up the routes for the whole batch, queue each datagram on its egress interface (or drop it, if its TTL
+  // runs out or there is no route), then send everything that was queued
+  void forward_batch();
+};
@@ -0,0 +1,91 @@
+#include "shared_route_table.hh"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+uint32_t mask( uint8_t prefix_length )
+{
+  return prefix_length == 0 ? 0 : ~uint32_t {} << ( 32 - prefix_length );
+}
+} // namespace
+
+SharedRouteTable::SharedRouteTable( size_t reader_count )
+  : published_( new RouteTable ), readers_( reader_count )
+{}
+
+SharedRouteTable::~SharedRouteTable()
+{
+  delete published_.load(); // NOLINT(*-owning-memory)
+}
+
+SharedRouteTable::Snapshot::~Snapshot()
+{
+  slot_.store( IDLE, memory_order_release );
+}
+
+SharedRouteTable::Snapshot SharedRouteTable::read( size_t reader ) const
+{
+  // Announce the epoch before loading the table (both sequentially consistent): if the writer's scan of the
+  // slots in reclaim() misses the announcement, the announcement comes after that publish's exchange, so the
+  // load finds the new table and not the one being freed.
+  auto& slot = readers_.at( reader ).epoch;
+  slot.store( epoch_.load() );
+  return { slot, published_.load() };
+}
+
+RouteTable& SharedRouteTable::staged()
+{
+  if ( not staged_ ) {
+    staged_ = make_unique<RouteTable>( *published_.load( memory_order_relaxed ) );
+  }
+  return *staged_;
+}
+
+void SharedRouteTable::insert( uint32_t prefix, uint8_t prefix_length, uint32_t value )
+{
+  staged().insert( prefix, prefix_length, value );
+  routes_[{ prefix & mask( prefix_length ), prefix_length }] = value;
+}
+
+bool SharedRouteTable::remove( uint32_t prefix, uint8_t prefix_length )
+{
+  if ( prefix_length > 32 or routes_.erase( { prefix & mask( prefix_length ), prefix_length } ) == 0 ) {
+    return false;
+  }
+
+  // what the prefix covered goes to the longest shorter prefix that covers it
+  optional<RouteTable::Fallback> fallback;
+  for ( int length = prefix_length - 1; length >= 0 and not fallback.has_value(); length-- ) {
+    const auto shorter = static_cast<uint8_t>( length );
+    if ( const auto it = routes_.find( { prefix & mask( shorter ), shorter } ); it != routes_.end() ) {
+      fallback = RouteTable::Fallback { it->second, shorter };
+    }
+  }
+  staged().remove( prefix, prefix_length, fallback );
+  return true;
+}
+
+void SharedRouteTable::publish()
+{
+  if ( not staged_ ) {
+    return;
+  }
+
+  const RouteTable* replaced = published_.exchange( staged_.release() );
+  retired_.emplace_back( epoch_.fetch_add( 1 ), replaced );
+  reclaim();
+}
+
+void SharedRouteTable::reclaim()
+{
+  // A reader that announced epoch e might have loaded any table published before epoch e ended, so a table
+  // retired in epoch e can go once every reader is idle or has announced a later epoch.
+  uint64_t oldest = IDLE;
+  for ( const auto& reader : readers_ ) {
+    oldest = min( oldest, reader.epoch.load() );
+  }
+  erase_if( retired_, [&]( const auto& retired ) { return retired.first < oldest; } );
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <memory>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "route_table.hh"
+
+// A RouteTable that one thread (the writer) changes while others (the readers, e.g. forwarding loops) look
+// addresses up in it, without locks and without the readers ever waiting, in the style of RCU:
+//
+// - Readers look up in an immutable snapshot of the table. Taking one is two atomic operations: the reader
+//   announces the current epoch in its own slot, then loads the pointer to the published table.
+// - The writer stages its changes in a copy of the published table, and publish() swaps the copy in with one
+//   atomic pointer exchange, so a reader sees all of a publish's changes or none of them.
+// - The table a publish replaces is retired, with the epoch it was replaced in, and freed once every reader has
+//   either let go of its snapshot or announced a later epoch (when none of them can still be looking at it).
+//
+// Each publish copies the whole table, so the writer should stage a batch of changes between publishes.
+class SharedRouteTable
+{
+public:
+  // A table for up to `reader_count` readers, each of which uses its own slot (0 to reader_count - 1)
+  explicit SharedRouteTable( size_t reader_count );
+  ~SharedRouteTable();
+
+  SharedRouteTable( const SharedRouteTable& other ) = delete;
+  SharedRouteTable& operator=( const SharedRouteTable& other ) = delete;
+
+  // Writer: stage adding (or replacing) and removing prefixes, as RouteTable::insert does; remove() returns
+  // whether the prefix was there
+  void insert( uint32_t prefix, uint8_t prefix_length, uint32_t value );
+  bool remove( uint32_t prefix, uint8_t prefix_length );
+
+  // Writer: make the staged changes visible to readers, and free the retired tables that no reader can see
+  void publish();
+
+  // Writer: free the retired tables that no reader can see any more (as publish() does, after its exchange)
+  void reclaim();
+
+  // Writer: number of tables retired but not yet freed (because a reader might still be looking at them)
+  size_t retired_count() const { return retired_.size(); }
+
+  // Reader: the table as of the last publish, until the Snapshot is destroyed. A reader holds one Snapshot at a
+  // time, and should hold it briefly (e.g. for one batch of datagrams): while it does, no table retired since
+  // it was taken can be freed.
+  class Snapshot
+  {
+  public:
+    std::optional<uint32_t> lookup( uint32_t address ) const { return table_->lookup( address ); }
+    void lookup_batch( std::span<const uint32_t> addresses, std::span<std::optional<uint32_t>> results ) const
+    {
+      table_->lookup_batch( addresses, results );
+    }
+
+    ~Snapshot();
+    Snapshot( const Snapshot& other ) = delete;
+    Snapshot& operator=( const Snapshot& other ) = delete;
+
+  private:
+    friend class SharedRouteTable;
+    Snapshot( std::atomic<uint64_t>& slot, const RouteTable* table ) : slot_( slot ), table_( table ) {}
+
+    std::atomic<uint64_t>& slot_;
+    const RouteTable* table_;
+  };
+
+  Snapshot read( size_t reader ) const;
+
+private:
+  // What a reader's slot holds when it has no snapshot
+  static constexpr uint64_t IDLE = std::numeric_limits<uint64_t>::max();
+
+  // Each reader's slot on its own cache line, so that readers don't slow each other down
+  struct alignas( 64 ) ReaderSlot
+  {
+    std::atomic<uint64_t> epoch { IDLE };
+  };
+
+  std::atomic<const RouteTable*> published_;
+  std::atomic<uint64_t> epoch_ { 0 };
+  mutable std::vector<ReaderSlot> readers_;
+
+  // The writer's own state: every prefix (to find a removed one's fallback), the copy being changed (if any
+  // change is staged), and the retired tables with the epochs they were retired in
+  std::map<std::pair<uint32_t, uint8_t>, uint32_t> routes_ {};
+  std::unique_ptr<RouteTable> staged_ {};
+  std::vector<std::pair<uint64_t, std::unique_ptr<const RouteTable>>> retired_ {};
+
+  RouteTable& staged();
+};
@@ -1,5 +1,16 @@
+#include "ethernet_adapter.hh"
+#include "loopback_adapter.hh"
+#include "netem_adapter.hh"
 #include "tcp_minnow_socket_impl.hh"
 
-//! Specializations of TCPMinnowSocket for TCPOverIPv4OverTunFdAdapter and its lossy version
+//! Specializations of TCPMinnowSocket for TCPOverIPv4OverTunFdAdapter, TCPOverIPv4OverEthernetAdapter,
+//! LoopbackAdapter, their lossy versions, and their versions behind an emulated link
 template class TCPMinnowSocket<TCPOverIPv4OverTunFdAdapter>;
 template class TCPMinnowSocket<LossyFdAdapter<TCPOverIPv4OverTunFdAdapter>>;
+template class TCPMinnowSocket<NetemAdapter<LossyFdAdapter<TCPOverIPv4OverTunFdAdapter>>>;
+template class TCPMinnowSocket<TCPOverIPv4OverEthernetAdapter>;
+template class TCPMinnowSocket<LossyFdAdapter<TCPOverIPv4OverEthernetAdapter>>;
+template class TCPMinnowSocket<NetemAdapter<LossyFdAdapter<TCPOverIPv4OverEthernetAdapter>>>;
+template class TCPMinnowSocket<LoopbackAdapter>;
+template class TCPMinnowSocket<LossyFdAdapter<LoopbackAdapter>>;
+template class TCPMinnowSocket<NetemAdapter<LoopbackAdapter>>;
@@ -1,5 +1,6 @@
 #include "tcp_sender.hh"
 #include "byte_stream.hh"
+#include "checksum.hh"
 #include "tcp_config.hh"
 #include "tcp_sender_message.hh"
 #include "wrapping_integers.hh"
@@ -21,8 +22,17 @@ uint64_t TCPSender::consecutive_retransmissions() const
   return retransmission_times_;
 }
 
+// Returns the number of milliseconds until the retransmission timer expires, or nothing if it isn't running
+optional<uint64_t> TCPSender::time_until_timeout() const
+{
+  if ( !timer_.is_actived() ) {
+    return nullopt;
+  }
+  return timer_.time_remaining();
+}
+
 // Pushes data into the TCP sender's output buffer and manages retransmission logic
-void TCPSender::push( const TransmitFunction& transmit )
+void TCPSender::push( TransmitFunction transmit )
 {
   // Continue sending data as long as there's space in the window
   while ( ( wnd_size_ == 0 ? 1 : wnd_size_ ) > sequence_numbers_in_flight() ) {
@@ -30,8 +40,14 @@ void TCPSender::push( const TransmitFunction& transmit )
       break; // Stop if FIN flag is already set
     }
 
-    // Create a new TCP message with empty payload
-    auto msg = make_empty_message();
+    // Create a new TCP message with empty payload (in a recycled slot, keeping its payload's capacity)
+    auto& msg = outstanding_messages_.next_slot();
+    msg.seqno = Wrap32::wrap( sentno_, isn_ );
+    msg.SYN = false;
+    msg.payload.clear();
+    msg.FIN = false;
+    msg.RST = input_.has_error();
+    msg.payload_sum.reset();
 
     if ( !SYN_flag_ ) {
       // Set SYN flag on the first message
@@ -47,13 +63,19 @@ void TCPSender::push( const TransmitFunction& transmit )
 
     // NOTE: here must use reference not directly use reader_end, it will copy it.
     auto& reader_end = input_.reader();
-    // Fill the message payload with data from the input buffer
-    while ( reader_end.bytes_buffered() && datas.size() < len ) {
+    // Fill the message payload with data from the input buffer, checksumming it on the way
+    // (so the bytes are only read once)
+    const uint64_t payload_len = min( len, reader_end.bytes_buffered() );
+    datas.resize( payload_len );
+    InternetChecksum payload_sum;
+    for ( uint64_t filled = 0; filled < payload_len; ) {
       auto cur_datas = reader_end.peek();
-      cur_datas = cur_datas.substr( 0, len - datas.size() );
-      datas += cur_datas;
-      reader_end.pop( datas.size() );
+      cur_datas = cur_datas.substr( 0, payload_len - filled );
+      payload_sum.copy_and_add( datas.data() + filled, cur_datas );
+      filled += cur_datas.size();
+      reader_end.pop( cur_datas.size() );
     }
+    msg.payload_sum = payload_sum.folded_sum();
 
     if ( !FIN_flag_ && remaining_wnd_space > msg.sequence_length() && reader_end.is_finished() ) {
       // Set FIN flag if all data has been read and there's space left in the window
@@ -72,7 +94,7 @@ void TCPSender::push( const TransmitFunction& transmit )
     }
 
     sentno_ += msg.sequence_length();  // Update the sequence number
-    outstanding_messages_.push( msg ); // Store the message in the queue for retransmission
+    outstanding_messages_.push_next(); // Keep the message in the queue for retransmission
   }
 }
 
@@ -102,7 +124,7 @@ void TCPSender::receive( const TCPReceiverMessage& msg )
     }
 
     while ( !outstanding_messages_.empty() ) {
-      auto first = outstanding_messages_.front();
+      const auto& first = outstanding_messages_.front();
       if ( ackno < ackno_ + first.sequence_length() ) {
         break; // Stop if the acknowledgment does not cover the entire message
       }
@@ -121,7 +143,7 @@ void TCPSender::receive( const TCPReceiverMessage& msg )
 }
 
 // Handles the passage of time and retransmission logic
-void TCPSender::tick( uint64_t ms_since_last_tick, const TransmitFunction& transmit )
+void TCPSender::tick( uint64_t ms_since_last_tick, TransmitFunction transmit )
 {
   if ( timer_.is_actived() ) {
     timer_.tick( ms_since_last_tick ); // Update the timer with the elapsed time
@@ -130,7 +152,7 @@ void TCPSender::tick( uint64_t ms_since_last_tick, const TransmitFunction& trans
   if ( timer_.is_expired() ) {
     // If the timer has expired, retransmit the first unacknowledged message
     while ( !outstanding_messages_.empty() ) {
-      auto msg = outstanding_messages_.front();
+      const auto& msg = outstanding_messages_.front();
       auto idx = msg.seqno.unwrap( isn_, sentno_ );
 
       if ( idx + msg.sequence_length() > ackno_ ) {
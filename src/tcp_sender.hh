@@ -1,12 +1,13 @@
 #pragma once
 
 #include "byte_stream.hh"
+#include "function_ref.hh"
+#include "recycling_queue.hh"
 #include "tcp_receiver_message.hh"
 #include "tcp_sender_message.hh"
 
 #include <cstdint>
-#include <functional>
-#include <queue>
+#include <optional>
 
 class RetransmissionTimer
 {
@@ -14,6 +15,7 @@ public:
   RetransmissionTimer( uint64_t RTO_ms ) : RTO_ms_( RTO_ms ) {}
   bool is_actived() const noexcept { return actived_; }
   bool is_expired() const noexcept { return actived_ && time_elapsed >= RTO_ms_; }
+  uint64_t time_remaining() const noexcept { return is_expired() ? 0 : RTO_ms_ - time_elapsed; }
   void stop() noexcept { actived_ = false; }
 
   void active() noexcept;
@@ -42,18 +44,20 @@ public:
   /* Receive and process a TCPReceiverMessage from the peer's receiver */
   void receive( const TCPReceiverMessage& msg );
 
-  /* Type of the `transmit` function that the push and tick methods can use to send messages */
-  using TransmitFunction = std::function<void( const TCPSenderMessage& )>;
+  /* Type of the `transmit` function that the push and tick methods can use to send messages (a reference to
+   * the caller's callable, so each message costs one direct call through a function pointer) */
+  using TransmitFunction = FunctionRef<void( const TCPSenderMessage& )>;
 
   /* Push bytes from the outbound stream */
-  void push( const TransmitFunction& transmit );
+  void push( TransmitFunction transmit );
 
   /* Time has passed by the given # of milliseconds since the last time the tick() method was called */
-  void tick( uint64_t ms_since_last_tick, const TransmitFunction& transmit );
+  void tick( uint64_t ms_since_last_tick, TransmitFunction transmit );
 
   // Accessors
-  uint64_t sequence_numbers_in_flight() const;  // How many sequence numbers are outstanding?
-  uint64_t consecutive_retransmissions() const; // How many consecutive *re*transmissions have happened?
+  uint64_t sequence_numbers_in_flight() const;        // How many sequence numbers are outstanding?
+  uint64_t consecutive_retransmissions() const;       // How many consecutive *re*transmissions have happened?
+  std::optional<uint64_t> time_until_timeout() const; // How many ms until the retransmission timer expires?
   Writer& writer() { return input_.writer(); }
   const Writer& writer() const { return input_.writer(); }
 
@@ -66,7 +70,8 @@ private:
   Wrap32 isn_;
   uint64_t initial_RTO_ms_;
 
-  std::queue<TCPSenderMessage> outstanding_messages_ {};
+  // Each segment is built in the slot of one that has been acknowledged, reusing its payload's buffer
+  RecyclingQueue<TCPSenderMessage> outstanding_messages_ {};
 
   bool SYN_flag_ {};
   bool FIN_flag_ {};
@@ -0,0 +1,281 @@
+#include "tcp_simulation.hh"
+
+#include <algorithm>
+#include <ranges>
+#include <utility>
+
+using namespace std;
+
+namespace {
+// Spread out a seed (splitmix64's finalizer), so that the links' seeds, made from consecutive numbers, aren't
+// close together
+uint64_t mix( uint64_t x )
+{
+  x = ( x ^ ( x >> 30 ) ) * 0xbf58476d1ce4e5b9;
+  x = ( x ^ ( x >> 27 ) ) * 0x94d049bb133111eb;
+  return x ^ ( x >> 31 );
+}
+} // namespace
+
+TCPSimulation::Flow::Flow( const FlowConfig& flow_config,
+                           LoopbackAdapter&& client_side,
+                           LoopbackAdapter&& server_side )
+  : config( flow_config )
+  , client { TCPPeer { config.tcp }, NetemAdapter { move( client_side ), config.forward } }
+  , server { TCPPeer { config.tcp }, NetemAdapter { move( server_side ), config.reverse } }
+{}
+
+size_t TCPSimulation::add_flow( const FlowConfig& config )
+{
+  FlowConfig flow_config = config;
+  const uint64_t link_seed = mix( seed_ ) + 2 * flows_.size();
+  flow_config.forward.seed = config.forward.seed.value_or( mix( link_seed ) );
+  flow_config.reverse.seed = config.reverse.seed.value_or( mix( link_seed + 1 ) );
+
+  auto [client_side, server_side] = LoopbackAdapter::make_pair();
+  flows_.push_back( make_unique<Flow>( flow_config, move( client_side ), move( server_side ) ) );
+  return flows_.size() - 1;
+}
+
+bool TCPSimulation::finished() const
+{
+  return ranges::all_of( flows_, []( const auto& flow ) { return flow->finished(); } );
+}
+
+void TCPSimulation::run_for( uint64_t ms )
+{
+  const uint64_t end = now_ms_ + ms;
+  while ( true ) {
+    for ( auto& flow : flows_ ) {
+      flow->step( now_ms_, chunk_ );
+    }
+    if ( now_ms_ >= end or finished() ) {
+      return;
+    }
+
+    // jump to the next event (if nothing is due, to the end)
+    uint64_t next = end;
+    for ( const auto& flow : flows_ ) {
+      next = min( next, flow->next_event( now_ms_ ).value_or( end ) );
+    }
+    const uint64_t elapsed = max<uint64_t>( next - now_ms_, 1 );
+    for ( auto& flow : flows_ ) {
+      flow->tick( now_ms_, elapsed );
+    }
+    now_ms_ += elapsed;
+  }
+}
+
+void TCPSimulation::Flow::step( uint64_t now, const string& chunk )
+{
+  if ( now < config.start_ms ) {
+    return;
+  }
+  started = true;
+
+  const auto client_transmit = [&]( const TCPMessage& msg ) {
+    client_sent( msg, now );
+    client.link.write( msg );
+  };
+  const auto server_transmit = [&]( const TCPMessage& msg ) { server.link.write( msg ); };
+
+  // both take what has arrived before either replies (so each way, a segment takes at least a ms to arrive)
+  for ( Endpoint* endpoint : { &server, &client } ) {
+    while ( auto msg = endpoint->link.read() ) {
+      endpoint->batch.push_back( move( msg.value() ) );
+    }
+    endpoint->received += endpoint->batch.size();
+  }
+  for ( const auto& msg : client.batch ) {
+    client_received( msg, now );
+  }
+
+  // the server reads everything (once its TCPPeer has acknowledged it, as with a socket's application), and
+  // closes its side once the client has closed its own
+  if ( not server.batch.empty() ) {
+    server.peer.receive_batch( server.batch, server_transmit );
+    server.batch.clear();
+  }
+  Reader& inbound = server.peer.inbound_reader();
+  if ( inbound.bytes_buffered() > 0 ) {
+    delivered += inbound.bytes_buffered();
+    inbound.pop( inbound.bytes_buffered() );
+  }
+  if ( inbound.is_finished() and not stream_ended_ms.has_value() ) {
+    stream_ended_ms = now;
+  }
+  if ( inbound.is_finished() and not server.peer.outbound_writer().is_closed() ) {
+    server.peer.outbound_writer().close();
+    server.peer.push( server_transmit );
+  }
+
+  // the client keeps its stream full (until it has written all it sends), and sends what the window allows
+  if ( not client.batch.empty() ) {
+    client.peer.receive_batch( client.batch, client_transmit );
+    client.batch.clear();
+  }
+  Writer& outbound = client.peer.outbound_writer();
+  while ( pushed < config.bytes and outbound.available_capacity() > 0 ) {
+    const uint64_t length = min( { outbound.available_capacity(), chunk.size(), config.bytes - pushed } );
+    outbound.push( chunk.substr( 0, length ) );
+    pushed += length;
+  }
+  if ( pushed == config.bytes and not outbound.is_closed() ) {
+    outbound.close();
+  }
+  client.peer.push( client_transmit );
+}
+
+optional<uint64_t> TCPSimulation::Flow::next_event( uint64_t now ) const
+{
+  if ( now < config.start_ms ) {
+    return config.start_ms;
+  }
+  if ( finished() ) {
+    return {};
+  }
+
+  // a segment that a link passed on at once arrives in the next ms
+  if ( client.link.stats().sent > server.received or server.link.stats().sent > client.received ) {
+    return now;
+  }
+
+  optional<uint64_t> ret;
+  for ( const auto deadline : { client.peer.time_until_deadline(),
+                                server.peer.time_until_deadline(),
+                                client.link.time_until_deadline(),
+                                server.link.time_until_deadline() } ) {
+    if ( deadline.has_value() ) {
+      ret = min( ret.value_or( UINT64_MAX ), now + deadline.value() );
+    }
+  }
+  return ret;
+}
+
+void TCPSimulation::Flow::tick( uint64_t now, uint64_t ms )
+{
+  // the links pass on what has reached the other end by now, then the peers' timers fire
+  client.link.tick( ms );
+  server.link.tick( ms );
+  client.peer.tick( ms, [&]( const TCPMessage& msg ) {
+    client_sent( msg, now + ms );
+    client.link.write( msg );
+  } );
+  server.peer.tick( ms, [&]( const TCPMessage& msg ) { server.link.write( msg ); } );
+}
+
+void TCPSimulation::Flow::client_sent( const TCPMessage& msg, uint64_t now )
+{
+  const uint64_t length = msg.sender.sequence_length();
+  if ( length == 0 ) {
+    return;
+  }
+  segments_sent++;
+
+  const uint64_t seqno = msg.sender.seqno.unwrap( config.tcp.isn, next_seqno );
+  if ( seqno + length > next_seqno ) {
+    in_flight.push_back( { seqno + length, now, false } );
+    next_seqno = seqno + length;
+    return;
+  }
+
+  // a retransmission: whatever it carries can no longer be timed
+  retransmissions++;
+  for ( auto& sent : in_flight | views::reverse ) {
+    if ( sent.end <= seqno ) {
+      break;
+    }
+    sent.retransmitted |= sent.end <= seqno + length;
+  }
+}
+
+void TCPSimulation::Flow::client_received( const TCPMessage& msg, uint64_t now )
+{
+  if ( not msg.receiver.ackno.has_value() ) {
+    return;
+  }
+
+  const uint64_t ackno = msg.receiver.ackno->unwrap( config.tcp.isn, next_seqno );
+  optional<uint64_t> rtt;
+  while ( not in_flight.empty() and in_flight.front().end <= ackno ) {
+    const Sent& newest = in_flight.front();
+    rtt = newest.retransmitted ? optional<uint64_t> {} : now - newest.sent_ms;
+    in_flight.pop_front();
+  }
+
+  if ( rtt.has_value() ) {
+    if ( rtt_histogram.size() <= rtt.value() ) {
+      rtt_histogram.resize( rtt.value() + 1 );
+    }
+    rtt_histogram[rtt.value()]++;
+  }
+}
+
+TCPSimulation::FlowReport TCPSimulation::report( size_t flow ) const
+{
+  const Flow& f = *flows_.at( flow );
+  FlowReport ret;
+  if ( not f.started ) {
+    return ret;
+  }
+
+  ret.bytes_delivered = f.delivered;
+  ret.duration_ms = max( f.stream_ended_ms.value_or( now_ms_ ), f.config.start_ms ) - f.config.start_ms;
+  if ( ret.duration_ms > 0 ) {
+    ret.goodput_bps = static_cast<double>( f.delivered ) * 8 * 1000 / static_cast<double>( ret.duration_ms );
+  }
+
+  ret.rtt_histogram = f.rtt_histogram;
+  ret.segments_sent = f.segments_sent;
+  ret.retransmissions = f.retransmissions;
+
+  ret.forward = f.client.link.stats();
+  ret.reverse = f.server.link.stats();
+  if ( ret.duration_ms > 0 ) {
+    ret.mean_queue
+      = static_cast<double>( ret.forward.queue_wait_us ) / 1000 / static_cast<double>( ret.duration_ms );
+  }
+  ret.max_queue = ret.forward.max_queue;
+
+  ret.finished = f.finished();
+  return ret;
+}
+
+uint64_t TCPSimulation::FlowReport::rtt_samples() const
+{
+  uint64_t ret = 0;
+  for ( const auto count : rtt_histogram ) {
+    ret += count;
+  }
+  return ret;
+}
+
+optional<uint64_t> TCPSimulation::FlowReport::rtt_quantile( double quantile ) const
+{
+  const uint64_t samples = rtt_samples();
+  if ( samples == 0 ) {
+    return {};
+  }
+  const auto rank = static_cast<uint64_t>( quantile * static_cast<double>( samples - 1 ) );
+  uint64_t seen = 0;
+  for ( size_t ms = 0; ms < rtt_histogram.size(); ms++ ) {
+    seen += rtt_histogram[ms];
+    if ( seen > rank ) {
+      return ms;
+    }
+  }
+  return rtt_histogram.size() - 1;
+}
+
+double TCPSimulation::FlowReport::rtt_mean() const
+{
+  const uint64_t samples = rtt_samples();
+  if ( samples == 0 ) {
+    return 0;
+  }
+  uint64_t total = 0;
+  for ( size_t ms = 0; ms < rtt_histogram.size(); ms++ ) {
+    total += ms * rtt_histogram[ms];
+  }
+  return static_cast<double>( total ) / static_cast<double>( samples );
+}
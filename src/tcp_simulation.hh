@@ -0,0 +1,131 @@
+#pragma once
+
+#include "loopback_adapter.hh"
+#include "netem_adapter.hh"
+#include "tcp_config.hh"
+#include "tcp_peer.hh"
+#include "tcp_segment.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+// A deterministic discrete-event simulation of TCP connections, each between two TCPPeers over an emulated link
+// (a NetemAdapter each way), in virtual time. Nothing waits for a clock: the simulation hands each peer what
+// has arrived for it and lets the applications write and read, then jumps straight to the next moment
+// something is due (a segment reaching the other end, a retransmission timer, a connection starting), and
+// ticks every peer and link by that many ms. A run takes as long as the work in it, not as long as the time it
+// simulates, and makes the same choices every time (the links are seeded from the simulation's seed, unless
+// their configs have seeds of their own). Time goes in whole ms, and a segment takes at least one to arrive,
+// even over a link that does nothing to it.
+//
+// Each connection is a bulk transfer: the client sends, the server reads everything (and sends nothing back but
+// acknowledgments), then closes its side once the client has closed its own. Connections don't share their
+// links: each is on its own, with time the only thing they have in common.
+class TCPSimulation
+{
+public:
+  struct FlowConfig
+  {
+    TCPConfig tcp {};       // for both peers
+    NetemConfig forward {}; // the link from client to server
+    NetemConfig reverse {}; // and from server to client
+
+    uint64_t bytes = std::numeric_limits<uint64_t>::max(); // to send (then the client closes its stream)
+    uint64_t start_ms = 0;                                 // when the client connects
+  };
+
+  struct FlowReport
+  {
+    uint64_t bytes_delivered {}; // read by the server
+    uint64_t duration_ms {};     // from connecting to the end of the stream (or to now, if it hasn't ended)
+    double goodput_bps {};       // bytes delivered over the duration
+
+    // The client's RTT samples, from each acknowledgment of data, timed from when the newest segment it acked
+    // was sent (unless that segment was retransmitted, so that no sample is ambiguous): how many samples took
+    // each number of ms
+    std::vector<uint64_t> rtt_histogram {};
+    uint64_t rtt_samples() const;
+    std::optional<uint64_t> rtt_quantile( double quantile ) const; // e.g. 0.5 for the median
+    double rtt_mean() const;
+
+    uint64_t segments_sent {};   // by the client (those that occupy sequence numbers, retransmissions included)
+    uint64_t retransmissions {}; // of those
+
+    NetemStats forward {}; // what the link did to the client's segments
+    NetemStats reverse {}; // and to the server's
+    double mean_queue {};  // segments waiting for the forward link's bandwidth cap, on average over the duration
+    size_t max_queue {};   // and at most
+
+    bool finished {}; // both streams ended, and both peers done
+  };
+
+  explicit TCPSimulation( uint64_t seed = 0 ) : seed_( seed ) {}
+
+  // Add a connection, returning its index
+  size_t add_flow( const FlowConfig& config );
+
+  // Simulate `ms` more ms (or until every connection has finished)
+  void run_for( uint64_t ms );
+
+  uint64_t now_ms() const { return now_ms_; }
+  size_t flow_count() const { return flows_.size(); }
+  bool finished() const;
+  FlowReport report( size_t flow ) const;
+
+private:
+  // A TCPPeer and the link it sends over (its NetemAdapter, in front of its end of a LoopbackAdapter pair)
+  struct Endpoint
+  {
+    TCPPeer peer;
+    NetemAdapter<LoopbackAdapter> link;
+    std::vector<TCPMessage> batch {};
+    uint64_t received {}; // messages read from the other end's link
+  };
+
+  // A segment of the client's, sent for the first time
+  struct Sent
+  {
+    uint64_t end;     // absolute sequence number just past it
+    uint64_t sent_ms; // when
+    bool retransmitted;
+  };
+
+  struct Flow
+  {
+    FlowConfig config;
+    Endpoint client;
+    Endpoint server;
+
+    bool started {};
+    uint64_t pushed {};
+    uint64_t delivered {};
+    std::optional<uint64_t> stream_ended_ms {}; // when the server read the end of the client's stream
+
+    std::deque<Sent> in_flight {}; // the client's segments not yet acknowledged, in order
+    uint64_t next_seqno {};        // absolute sequence number of the client's next new byte
+    std::vector<uint64_t> rtt_histogram {};
+    uint64_t segments_sent {};
+    uint64_t retransmissions {};
+
+    Flow( const FlowConfig& flow_config, LoopbackAdapter&& client_side, LoopbackAdapter&& server_side );
+
+    bool finished() const { return started and not client.peer.active() and not server.peer.active(); }
+    void step( uint64_t now, const std::string& chunk );
+    std::optional<uint64_t> next_event( uint64_t now ) const;
+    void tick( uint64_t now, uint64_t ms );
+
+    void client_sent( const TCPMessage& msg, uint64_t now );
+    void client_received( const TCPMessage& msg, uint64_t now );
+  };
+
+  uint64_t seed_;
+  uint64_t now_ms_ {};
+  std::vector<std::unique_ptr<Flow>> flows_ {};
+  std::string chunk_ = std::string( TCPConfig::DEFAULT_CAPACITY, 'x' ); // what the clients send
+};
@@ -0,0 +1,46 @@
+#include "alloc_counter.hh"
+
+#include <cstdlib>
+#include <new>
+
+using namespace std;
+
+// Count every call to the global allocation functions made while `counting` is set
+namespace {
+bool counting = false;
+size_t allocations = 0;
+} // namespace
+
+void* operator new( size_t size )
+{
+  if ( counting ) {
+    ++allocations;
+  }
+  void* ptr = malloc( size ); // NOLINT(*-no-malloc)
+  if ( not ptr ) {
+    throw bad_alloc {};
+  }
+  return ptr;
+}
+
+void operator delete( void* ptr ) noexcept
+{
+  free( ptr ); // NOLINT(*-no-malloc)
+}
+
+void operator delete( void* ptr, size_t size [[maybe_unused]] ) noexcept
+{
+  free( ptr ); // NOLINT(*-no-malloc)
+}
+
+bool set_counting_allocations( bool count )
+{
+  const bool ret = counting;
+  counting = count;
+  return ret;
+}
+
+size_t allocations_counted()
+{
+  return allocations;
+}
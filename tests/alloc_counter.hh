@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+
+// Counting of the calls to the global allocation functions, by the replacement operator new in alloc_counter.cc
+// (which a test that uses these must link; see add_alloc_test_exec)
+
+// Set whether allocations are counted, returning whether they were
+bool set_counting_allocations( bool counting );
+
+// How many allocations have been counted so far
+size_t allocations_counted();
+
+// Run `operation` with counting off (e.g. the part of a counted operation that feeds it input)
+template<typename OperationT>
+void without_counting_allocations( OperationT&& operation )
+{
+  const bool was_counting = set_counting_allocations( false );
+  operation();
+  set_counting_allocations( was_counting );
+}
+
+// How many times `operation` calls the global allocation functions over `rounds` runs, once warmed up by as many
+// runs uncounted (so that whatever it keeps between runs has grown to its working size)
+template<typename OperationT>
+size_t count_allocations( OperationT&& operation, size_t rounds = 100 )
+{
+  for ( size_t i = 0; i < rounds; i++ ) {
+    operation();
+  }
+  const size_t before = allocations_counted();
+  for ( size_t i = 0; i < rounds; i++ ) {
+    set_counting_allocations( true );
+    operation();
+    set_counting_allocations( false );
+  }
+  return allocations_counted() - before;
+}
@@ -0,0 +1,144 @@
+#include "arp_message.hh"
+#include "ethernet_header.hh"
+#include "ipv4_datagram.hh"
+#include "network_interface_test_harness.hh"
+#include "timer_wheel.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+constexpr EthernetAddress local_eth { 2, 0, 0, 0, 0, 1 };
+constexpr EthernetAddress remote_eth { 2, 0, 0, 0, 0, 2 };
+constexpr const char* local_ip = "10.0.0.1";
+const Address next_hop { "10.0.0.2", 0 };
+const Address other_hop { "10.0.0.3", 0 };
+} // namespace
+
+InternetDatagram make_datagram( uint16_t id )
+{
+  InternetDatagram dgram;
+  dgram.header.id = id;
+  dgram.header.src = Address( local_ip, 0 ).ipv4_numeric();
+  dgram.header.dst = Address( "1.1.1.1", 0 ).ipv4_numeric();
+  dgram.header.len = IPv4Header::LENGTH;
+  dgram.header.compute_checksum();
+  return dgram;
+}
+
+ExpectFrame arp_request( const Address& target )
+{
+  return ExpectFrame { make_frame(
+    local_eth,
+    ETHERNET_BROADCAST,
+    EthernetHeader::TYPE_ARP,
+    serialize( make_arp( ARPMessage::OPCODE_REQUEST, local_eth, local_ip, {}, target.ip() ) ) ) };
+}
+
+ReceiveFrame arp_reply( const Address& sender )
+{
+  return ReceiveFrame {
+    make_frame( remote_eth,
+                local_eth,
+                EthernetHeader::TYPE_ARP,
+                serialize( make_arp( ARPMessage::OPCODE_REPLY, remote_eth, sender.ip(), local_eth, local_ip ) ) ),
+    {} };
+}
+
+ExpectFrame datagram_sent( uint16_t id )
+{
+  return ExpectFrame {
+    make_frame( local_eth, remote_eth, EthernetHeader::TYPE_IPv4, serialize( make_datagram( id ) ) ) };
+}
+
+void check_timer_wheel()
+{
+  TimerWheel<int, 10, 8> wheel;
+  vector<int> fired;
+  const auto record = [&]( int value, uint64_t /* deadline */ ) { fired.push_back( value ); };
+
+  wheel.add( 5, 1 );
+  wheel.add( 15, 2 );
+  wheel.add( 200, 3 ); // more than a turn of the wheel ahead: shares a slot with earlier timers
+  wheel.advance( 4, record );
+  check( fired.empty(), "no timer fires early" );
+  wheel.advance( 1, record );
+  check( fired == vector<int> { 1 }, "a timer fires at exactly its deadline" );
+  wheel.advance( 100, record );
+  check( fired == vector<int> { 1, 2 } and wheel.size() == 1, "a timer a turn ahead waits for its turn" );
+  wheel.advance( 95, record );
+  check( fired == vector<int> { 1, 2, 3 } and wheel.size() == 0, "and then fires" );
+}
+
+int main()
+{
+  try {
+    check_timer_wheel();
+
+    {
+      NetworkInterfaceTestHarness test { "only the newest datagrams wait for ARP", local_eth, Address( local_ip ) };
+      for ( uint16_t id = 0; id < 100; id++ ) {
+        test.execute( SendDatagram { make_datagram( id ), next_hop } );
+      }
+      test.execute( arp_request( next_hop ) );
+      test.execute( ExpectNoFrame {} );
+
+      // the newest MAX_PENDING_DATAGRAMS (64) go out in order once the reply comes
+      test.execute( arp_reply( next_hop ) );
+      for ( uint16_t id = 36; id < 100; id++ ) {
+        test.execute( datagram_sent( id ) );
+      }
+      test.execute( ExpectNoFrame {} );
+    }
+
+    {
+      NetworkInterfaceTestHarness test {
+        "a refreshed mapping lasts 30 s from the refresh", local_eth, Address( local_ip ) };
+      test.execute( SendDatagram { make_datagram( 1 ), next_hop } );
+      test.execute( arp_request( next_hop ) );
+      test.execute( arp_reply( next_hop ) );
+      test.execute( datagram_sent( 1 ) );
+
+      test.execute( Tick { 20000 } );
+      test.execute( arp_reply( next_hop ) );
+      test.execute( Tick { 29000 } );
+      test.execute( SendDatagram { make_datagram( 2 ), next_hop } );
+      test.execute( datagram_sent( 2 ) );
+
+      test.execute( Tick { 1000 } );
+      test.execute( SendDatagram { make_datagram( 3 ), next_hop } );
+      test.execute( arp_request( next_hop ) );
+      test.execute( ExpectNoFrame {} );
+    }
+
+    {
+      NetworkInterfaceTestHarness test { "one long tick expires everything", local_eth, Address( local_ip ) };
+      test.execute( SendDatagram { make_datagram( 1 ), next_hop } );
+      test.execute( arp_request( next_hop ) );
+      test.execute( arp_reply( next_hop ) );
+      test.execute( datagram_sent( 1 ) );
+      test.execute( SendDatagram { make_datagram( 2 ), other_hop } );
+      test.execute( arp_request( other_hop ) );
+
+      // the mapping, the pending datagram, and the wait before asking again all expire together
+      test.execute( Tick { 1'000'000 } );
+      test.execute( ExpectNoFrame {} );
+      test.execute( SendDatagram { make_datagram( 3 ), next_hop } );
+      test.execute( arp_request( next_hop ) );
+      test.execute( SendDatagram { make_datagram( 4 ), other_hop } );
+      test.execute( arp_request( other_hop ) );
+      test.execute( ExpectNoFrame {} );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,132 @@
+#include "arp_message.hh"
+#include "network_interface.hh"
+#include "parser.hh"
+
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+// Send datagrams to next hops picked at random among N neighbors that the NetworkInterface has learned, and
+// tick it in 1 ms steps, for N from a handful to many thousands. Both rates should stay flat as N grows: a
+// lookup is one hash, and a tick only looks at the timers that expire in the time that passed.
+
+class CountingPort : public NetworkInterface::OutputPort
+{
+public:
+  uint64_t frames {};
+  void transmit( const NetworkInterface& n [[maybe_unused]], const EthernetFrame& x [[maybe_unused]] ) override
+  {
+    frames++;
+  }
+  void transmit_serialized( const NetworkInterface& n [[maybe_unused]],
+                            span<const string_view> frame [[maybe_unused]] ) override
+  {
+    frames++;
+  }
+};
+
+template<typename OperationT>
+double speed_test( const string& mode, size_t rounds, OperationT&& operation )
+{
+  const auto start_time = steady_clock::now();
+  for ( size_t i = 0; i < rounds; i++ ) {
+    operation( i );
+  }
+  const auto stop_time = steady_clock::now();
+
+  auto test_duration = duration_cast<duration<double>>( stop_time - start_time );
+  auto millions_per_second = static_cast<double>( rounds ) / test_duration.count() / 1e6;
+
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  cout << "  " << left << setw( 40 ) << mode << right << fixed << setprecision( 2 ) << setw( 8 )
+       << millions_per_second << " million/s\n";
+
+  debug_output << "             " << mode << ": " << fixed << setprecision( 2 ) << millions_per_second
+               << " million/s\n";
+
+  if ( millions_per_second < 0.01 ) {
+    throw runtime_error( mode + " did not meet minimum speed of 0.01 million/s." );
+  }
+
+  return millions_per_second;
+}
+
+void benchmark( size_t neighbors )
+{
+  const auto port = make_shared<CountingPort>();
+  const EthernetAddress local_eth { 2, 0, 0, 0, 0, 1 };
+  const uint32_t base_ip = Address( "10.0.0.0", 0 ).ipv4_numeric();
+  NetworkInterface iface { "bench", port, local_eth, Address( "10.255.255.254", 0 ) };
+
+  // learn every neighbor from an ARP reply, spread over a few seconds (so their timers are spread over the wheel)
+  vector<Address> next_hops;
+  for ( size_t i = 0; i < neighbors; i++ ) {
+    const auto ip = static_cast<uint32_t>( base_ip + 1 + i );
+    ARPMessage arp;
+    arp.opcode = ARPMessage::OPCODE_REPLY;
+    arp.sender_ethernet_address = { 2, 0, static_cast<uint8_t>( i >> 16 ), static_cast<uint8_t>( i >> 8 ),
+                                    static_cast<uint8_t>( i ), 2 };
+    arp.sender_ip_address = ip;
+    arp.target_ethernet_address = local_eth;
+    arp.target_ip_address = Address( "10.255.255.254", 0 ).ipv4_numeric();
+    const EthernetHeader header {
+      .dst = local_eth, .src = arp.sender_ethernet_address, .type = EthernetHeader::TYPE_ARP };
+    iface.recv_frame( { .header = header, .payload = serialize( arp ) } );
+    if ( i % ( neighbors / 16 + 1 ) == 0 ) {
+      iface.tick( 100 );
+    }
+    next_hops.push_back( Address::from_ipv4_numeric( ip ) );
+  }
+
+  InternetDatagram dgram;
+  dgram.header.src = Address( "10.255.255.254", 0 ).ipv4_numeric();
+  dgram.header.dst = Address( "1.1.1.1", 0 ).ipv4_numeric();
+  dgram.header.len = IPv4Header::LENGTH;
+  dgram.header.compute_checksum();
+
+  cout << neighbors << " neighbors:\n";
+  const uint64_t frames_before = port->frames;
+  uint64_t state = 1;
+  speed_test( "send_datagram to a random neighbor", 1'000'000, [&]( size_t ) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL; // LCG
+    iface.send_datagram( dgram, next_hops[( state >> 33 ) % next_hops.size()] );
+  } );
+  if ( port->frames - frames_before != 1'000'000 ) {
+    throw runtime_error( "a learned neighbor's mapping was missing" );
+  }
+
+  speed_test( "tick( 1 ms )", 10'000, [&]( size_t ) { iface.tick( 1 ); } );
+}
+
+void program_body()
+{
+  for ( const size_t neighbors : { 16, 1024, 16384 } ) {
+    benchmark( neighbors );
+  }
+}
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,136 @@
+#include "checksum.hh"
+#include "tcp_segment.hh"
+
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+// The straightforward byte-at-a-time definition, to check the word-at-a-time version against
+uint16_t reference_checksum( uint32_t initial_sum, string_view data )
+{
+  uint64_t sum = initial_sum;
+  for ( size_t i = 0; i < data.size(); i++ ) {
+    const uint8_t byte = data[i];
+    sum += ( i % 2 ) ? byte : byte << 8;
+  }
+  while ( sum > 0xffff ) {
+    sum = ( sum >> 16 ) + ( sum & 0xffff );
+  }
+  return static_cast<uint16_t>( ~sum );
+}
+
+void check( const string& test_name, uint16_t expected, uint16_t actual )
+{
+  if ( expected != actual ) {
+    throw runtime_error( test_name + ": expected checksum " + to_string( expected ) + ", got "
+                         + to_string( actual ) );
+  }
+}
+
+int main()
+{
+  try {
+    // RFC 1071 section 3: the example bytes sum to 0xddf2
+    {
+      InternetChecksum check_rfc;
+      check_rfc.add( string_view { "\x00\x01\xf2\x03\xf4\xf5\xf6\xf7", 8 } );
+      check( "RFC 1071 example", static_cast<uint16_t>( ~0xddf2 ), check_rfc.value() );
+    }
+
+    // an odd-length fragment leaves half a word for the next fragment to finish
+    {
+      InternetChecksum check_odd;
+      check_odd.add( string_view { "\x00\x01\xf2", 3 } );
+      check_odd.add( string_view { "\x03\xf4\xf5\xf6\xf7", 5 } );
+      check( "odd-length fragments", static_cast<uint16_t>( ~0xddf2 ), check_odd.value() );
+    }
+
+    default_random_engine rd { 31 };
+    uniform_int_distribution<char> byte_dist;
+    uniform_int_distribution<uint32_t> sum_dist;
+
+    // whole buffers of every length around the 8- and 32-byte kernel boundaries, and some big ones
+    vector<size_t> lengths;
+    for ( size_t len = 0; len < 300; len++ ) {
+      lengths.push_back( len );
+    }
+    for ( const size_t len : { 1499, 1500, 4096, 65535, 65536, 1 << 20 } ) {
+      lengths.push_back( len );
+    }
+
+    for ( const size_t len : lengths ) {
+      string data( len, 0 );
+      for ( auto& c : data ) {
+        c = byte_dist( rd );
+      }
+      const uint32_t initial_sum = sum_dist( rd );
+
+      InternetChecksum whole { initial_sum };
+      whole.add( data );
+      check( "length " + to_string( len ), reference_checksum( initial_sum, data ), whole.value() );
+
+      // the same bytes in random fragments, as a vector of views (any alignment, any parity)
+      vector<string_view> fragments;
+      for ( size_t i = 0; i < len; ) {
+        const size_t fragment_len = uniform_int_distribution<size_t> { 0, min<size_t>( len - i, 70 ) }( rd );
+        fragments.push_back( string_view { data }.substr( i, fragment_len ) );
+        i += fragment_len;
+      }
+      InternetChecksum pieces { initial_sum };
+      pieces.add( fragments );
+      check( "length " + to_string( len ) + " in fragments",
+             reference_checksum( initial_sum, data ),
+             pieces.value() );
+
+      // copying the fragments out while checksumming them
+      string copy( len, 0 );
+      InternetChecksum copied { initial_sum };
+      size_t offset = 0;
+      for ( const auto fragment : fragments ) {
+        copied.copy_and_add( copy.data() + offset, fragment );
+        offset += fragment.size();
+      }
+      check( "length " + to_string( len ) + " copied", reference_checksum( initial_sum, data ), copied.value() );
+      if ( copy != data ) {
+        throw runtime_error( "length " + to_string( len ) + ": copy_and_add did not copy the data" );
+      }
+    }
+
+    // RFC 1624: updating the checksum of the previous pure ACK gives the same answer as computing it afresh
+    TCPSegment previous;
+    previous.udinfo = { .src_port = 9000, .dst_port = 1234, .cksum = 0 };
+    previous.compute_checksum( sum_dist( rd ) & 0xfffff );
+    for ( size_t i = 0; i < 10000; i++ ) {
+      const uint32_t pseudo_checksum = sum_dist( rd ) & 0xfffff;
+      previous.compute_checksum( pseudo_checksum );
+
+      TCPSegment next = previous;
+      next.message.sender.seqno = Wrap32 { sum_dist( rd ) };
+      if ( i % 3 ) {
+        next.message.receiver.ackno = Wrap32 { sum_dist( rd ) };
+      } else {
+        next.message.receiver.ackno.reset();
+      }
+      next.message.sender.FIN = i % 5 == 0;
+      next.message.receiver.window_size = static_cast<uint16_t>( sum_dist( rd ) );
+      next.update_checksum( previous );
+
+      const uint16_t updated = next.udinfo.cksum;
+      next.compute_checksum( pseudo_checksum );
+      check( "incremental update " + to_string( i ), next.udinfo.cksum, updated );
+      previous = next;
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,115 @@
+#include "checksum.hh"
+
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+using namespace std;
+using namespace std::chrono;
+
+// The byte-at-a-time loop that InternetChecksum::add used to run, for comparison
+uint16_t bytewise_checksum( string_view data )
+{
+  uint32_t sum = 0;
+  bool parity = false;
+  for ( const uint8_t i : data ) {
+    uint16_t val = i;
+    if ( not parity ) {
+      val <<= 8;
+    }
+    sum += val;
+    parity = !parity;
+  }
+  while ( sum > 0xffff ) {
+    sum = ( sum >> 16 ) + static_cast<uint16_t>( sum );
+  }
+  return ~sum;
+}
+
+template<typename ChecksumT>
+double speed_test( const string& mode, string_view buffer, size_t total_bytes, ChecksumT&& checksum )
+{
+  const size_t rounds = total_bytes / buffer.size();
+  uint64_t sink = 0; // keep the compiler from skipping the work
+
+  const auto start_time = steady_clock::now();
+  for ( size_t i = 0; i < rounds; i++ ) {
+    sink += checksum( buffer );
+  }
+  const auto stop_time = steady_clock::now();
+
+  if ( sink != rounds * checksum( buffer ) ) {
+    throw runtime_error( mode + " checksum is not deterministic" );
+  }
+
+  auto test_duration = duration_cast<duration<double>>( stop_time - start_time );
+  auto gigabytes_per_second = static_cast<double>( rounds * buffer.size() ) / test_duration.count() / 1e9;
+
+  cout << "  " << setw( 16 ) << mode << " over " << setw( 5 ) << buffer.size() << "-byte buffers: " << fixed
+       << setprecision( 2 ) << gigabytes_per_second << " GB/s\n";
+
+  return gigabytes_per_second;
+}
+
+void program_body()
+{
+  const string data = [] {
+    default_random_engine rd { 31 };
+    uniform_int_distribution<char> ud;
+    string ret( 65536, 0 );
+    for ( auto& c : ret ) {
+      c = ud( rd );
+    }
+    return ret;
+  }();
+
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  cout << "InternetChecksum throughput:\n";
+  for ( const size_t size : { 64, 256, 1500, 4096, 16384, 65536 } ) {
+    const string_view buffer = string_view { data }.substr( 0, size );
+
+    const double bytewise = speed_test( "byte-at-a-time", buffer, 2e8, bytewise_checksum );
+    const double wordwise = speed_test( "InternetChecksum", buffer, 2e9, []( string_view buf ) {
+      InternetChecksum check;
+      check.add( buf );
+      return check.value();
+    } );
+
+    if ( bytewise_checksum( buffer ) != [&] {
+           InternetChecksum check;
+           check.add( buffer );
+           return check.value();
+         }() ) {
+      throw runtime_error( "InternetChecksum disagrees with the byte-at-a-time checksum" );
+    }
+
+    debug_output << "             InternetChecksum over " << size << "-byte buffers: " << fixed
+                 << setprecision( 2 ) << wordwise << " GB/s (" << wordwise / bytewise << "x byte-at-a-time)\n";
+
+    if ( size >= 1500 and wordwise < 1 ) {
+      throw runtime_error( "InternetChecksum did not meet minimum speed of 1 GB/s on " + to_string( size )
+                           + "-byte buffers." );
+    }
+  }
+}
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -35,6 +35,14 @@ inline ExpectationViolation::ExpectationViolation( const std::string& property_n
                            + ", but instead it was " + boolstr( actual ) + "." }
 {}
 
+// For tests that check conditions directly rather than through a TestHarness
+inline void check( bool condition, const std::string& description )
+{
+  if ( not condition ) {
+    throw ExpectationViolation( "check failed: " + description );
+  }
+}
+
 template<class T>
 struct TestStep
 {
@@ -0,0 +1,125 @@
+#include "checksum.hh"
+#include "tcp_config.hh"
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#if defined( __x86_64__ )
+#include <x86intrin.h>
+#endif
+
+using namespace std;
+using namespace std::chrono;
+
+// Copying a payload out of the ByteStream and checksumming it, either in one fused pass
+// (InternetChecksum::copy_and_add) or as a memcpy followed by InternetChecksum::add.
+
+uint64_t cycles()
+{
+#if defined( __x86_64__ )
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+struct Result
+{
+  double gigabytes_per_second;
+  double bytes_per_cycle;
+};
+
+template<typename CopyChecksumT>
+Result speed_test( const string& mode, string_view src, string& dest, CopyChecksumT&& copy_checksum )
+{
+  constexpr size_t total_bytes = 2e9;
+  const size_t rounds = total_bytes / src.size();
+  uint64_t sink = 0; // keep the compiler from skipping the work
+
+  const auto start_time = steady_clock::now();
+  const uint64_t start_cycles = cycles();
+  for ( size_t i = 0; i < rounds; i++ ) {
+    sink += copy_checksum( dest.data(), src );
+  }
+  const uint64_t stop_cycles = cycles();
+  const auto stop_time = steady_clock::now();
+
+  if ( string_view { dest }.substr( 0, src.size() ) != src or sink != rounds * copy_checksum( dest.data(), src ) ) {
+    throw runtime_error( mode + " did not copy and checksum consistently" );
+  }
+
+  const auto test_duration = duration_cast<duration<double>>( stop_time - start_time );
+  const double bytes = static_cast<double>( rounds * src.size() );
+  const Result result { .gigabytes_per_second = bytes / test_duration.count() / 1e9,
+                        .bytes_per_cycle = bytes / static_cast<double>( stop_cycles - start_cycles ) };
+
+  cout << "  " << setw( 20 ) << mode << " of " << setw( 5 ) << src.size() << "-byte payloads: " << fixed
+       << setprecision( 2 ) << result.gigabytes_per_second << " GB/s, " << result.bytes_per_cycle
+       << " bytes/cycle\n";
+
+  return result;
+}
+
+void program_body()
+{
+  const string data = [] {
+    default_random_engine rd { 33 };
+    uniform_int_distribution<char> ud;
+    string ret( 65536, 0 );
+    for ( auto& c : ret ) {
+      c = ud( rd );
+    }
+    return ret;
+  }();
+  string dest( data.size(), 0 );
+
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  cout << "Payload copy + checksum:\n";
+  for ( const size_t size : { TCPConfig::MAX_PAYLOAD_SIZE, 1460UL, 16384UL, 65536UL } ) {
+    const string_view src = string_view { data }.substr( 0, size );
+
+    const Result separate = speed_test( "memcpy, then add", src, dest, []( char* out, string_view in ) {
+      memcpy( out, in.data(), in.size() );
+      InternetChecksum check;
+      check.add( { out, in.size() } );
+      return check.value();
+    } );
+
+    const Result fused = speed_test( "copy_and_add", src, dest, []( char* out, string_view in ) {
+      InternetChecksum check;
+      check.copy_and_add( out, in );
+      return check.value();
+    } );
+
+    debug_output << "             Fused copy+checksum of " << size << "-byte payloads: " << fixed
+                 << setprecision( 2 ) << fused.gigabytes_per_second << " GB/s ("
+                 << fused.gigabytes_per_second / separate.gigabytes_per_second << "x separate passes)\n";
+
+    if ( fused.gigabytes_per_second < 1 ) {
+      throw runtime_error( "Fused copy+checksum did not meet minimum speed of 1 GB/s." );
+    }
+  }
+}
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,106 @@
+#include "alloc_counter.hh"
+#include "exception.hh"
+#include "file_descriptor.hh"
+#include "ipv4_header.hh"
+#include "parser.hh"
+#include "tcp_over_ip.hh"
+
+#include <array>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/socket.h>
+
+using namespace std;
+
+// Receive every datagram the way TCPOverIPv4OverTunFdAdapter::read() does (into one fixed buffer, parsed
+// in place), and also parse it from scattered buffers, and check how many heap allocations each one costs
+// once the path is warmed up.
+void check_datagram_read( const string& test_name, const TCPMessage& msg, size_t expected_allocations )
+{
+  TCPOverIPv4Adapter sender;
+  sender.config_mut().source = Address { "169.254.144.9", 9000 };
+  sender.config_mut().destination = Address { "169.254.144.1", 1234 };
+
+  TCPOverIPv4Adapter receiver;
+  receiver.config_mut().source = sender.config().destination;
+  receiver.config_mut().destination = sender.config().source;
+
+  const auto datagram = [&] {
+    string ret;
+    for ( const auto& buf : serialize( sender.wrap_tcp_in_ip( msg ) ) ) {
+      ret += buf;
+    }
+    return ret;
+  }();
+
+  array<int, 2> fds {};
+  CheckSystemCall( "socketpair", ::socketpair( AF_UNIX, SOCK_DGRAM, 0, fds.data() ) );
+  FileDescriptor tun_side { fds[0] };
+  FileDescriptor adapter_side { fds[1] };
+
+  constexpr size_t rounds = 100;
+  array<char, 65535> buffer {};
+  bool all_received = true;
+  const size_t read_allocations = count_allocations(
+    [&] {
+      without_counting_allocations( [&] { tun_side.write( datagram ); } );
+      const size_t bytes_read = adapter_side.read( span { buffer } );
+      const auto received = receiver.unwrap_tcp_in_ip( string_view { buffer.data(), bytes_read } );
+      all_received &= received.has_value() and received->sender.payload == msg.sender.payload
+                      and received->receiver.ackno == msg.receiver.ackno;
+    },
+    rounds );
+  if ( not all_received ) {
+    throw runtime_error( test_name + ": datagram did not round-trip" );
+  }
+
+  // the same datagram scattered over two buffers (headers, then payload), parsed through a borrowed list of views
+  const array<string_view, 2> scattered { string_view { datagram }.substr( 0, 40 ),
+                                         string_view { datagram }.substr( 40 ) };
+  bool all_parsed = true;
+  const size_t parse_allocations = count_allocations(
+    [&] {
+      Parser parser { span<const string_view> { scattered } };
+      IPv4Header header;
+      header.parse( parser );
+      TCPSegment segment;
+      segment.parse( parser, header.pseudo_checksum() );
+      all_parsed &= not parser.has_error() and segment.message.sender.payload == msg.sender.payload;
+    },
+    rounds );
+  if ( not all_parsed ) {
+    throw runtime_error( test_name + ": scattered datagram did not round-trip" );
+  }
+
+  const size_t allocations = read_allocations + parse_allocations;
+  if ( allocations != expected_allocations * rounds * 2 ) {
+    throw runtime_error( test_name + ": expected " + to_string( expected_allocations * rounds * 2 )
+                         + " allocations over " + to_string( rounds * 2 ) + " datagrams, saw "
+                         + to_string( allocations ) );
+  }
+}
+
+int main()
+{
+  try {
+    TCPMessage ack;
+    ack.sender.seqno = Wrap32 { 1000 };
+    ack.receiver.ackno = Wrap32 { 5000 };
+    ack.receiver.window_size = 4096;
+    check_datagram_read( "pure ACK", ack, 0 );
+
+    TCPMessage data = ack;
+    data.sender.payload = string( 1400, 'x' );
+    check_datagram_read( "full-sized segment", data, 1 ); // only the copy of the payload out of the buffer
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,298 @@
+#include "loopback_adapter.hh"
+#include "netem_adapter.hh"
+#include "socket_transfer.hh"
+#include "tcp_config.hh"
+#include "tcp_minnow_socket.hh"
+#include "tcp_peer.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/socket.h>
+#include <utility>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+// Two TCP stacks talking end to end over a LoopbackAdapter pair, with no device and no privileges needed. First
+// two TCPPeers driven by one loop (the cost of TCP itself), then two TCPMinnowSockets, each with its thread and
+// EventLoop (the whole socket path an application sees). For each: the goodput of a bulk transfer, and the
+// latency of request/response transactions (a small request, answered by a larger response). Last, a bulk
+// transfer between the sockets over an emulated link, with a delay and a bandwidth cap.
+
+namespace {
+constexpr size_t REQUEST_SIZE = 100;
+constexpr size_t RESPONSE_SIZE = 1000;
+} // namespace
+
+void report_goodput( const string& mode, uint64_t bytes, const steady_clock::duration& elapsed )
+{
+  const double seconds = duration_cast<duration<double>>( elapsed ).count();
+  const double gigabits_per_second = static_cast<double>( bytes ) * 8 / seconds / 1e9;
+
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  cout << "  " << left << setw( 44 ) << mode << right << fixed << setprecision( 2 ) << setw( 8 )
+       << gigabits_per_second << " Gbit/s\n";
+  debug_output << "             " << mode << ": " << fixed << setprecision( 2 ) << gigabits_per_second
+               << " Gbit/s\n";
+
+  if ( gigabits_per_second < 0.01 ) {
+    throw runtime_error( mode + " did not meet minimum goodput of 0.01 Gbit/s." );
+  }
+}
+
+void report_latency( const string& mode, vector<steady_clock::duration>& latencies )
+{
+  ranges::sort( latencies );
+  const auto microseconds = [&]( double quantile ) {
+    const auto index = static_cast<size_t>( quantile * static_cast<double>( latencies.size() - 1 ) );
+    return duration_cast<duration<double, micro>>( latencies[index] ).count();
+  };
+  steady_clock::duration total {};
+  for ( const auto& latency : latencies ) {
+    total += latency;
+  }
+  const double per_second = static_cast<double>( latencies.size() ) / duration<double>( total ).count();
+
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  cout << "  " << left << setw( 44 ) << mode << right << fixed << setprecision( 1 ) << setw( 8 )
+       << microseconds( 0.5 ) << " us median, " << microseconds( 0.99 ) << " us 99th percentile ("
+       << setprecision( 0 ) << per_second << " transactions/s)\n";
+  debug_output << "             " << mode << ": " << fixed << setprecision( 1 ) << microseconds( 0.5 )
+               << " us median, " << microseconds( 0.99 ) << " us 99th percentile\n";
+
+  if ( per_second < 100 ) {
+    throw runtime_error( mode + " did not meet minimum rate of 100 transactions/s." );
+  }
+}
+
+// A TCPPeer and its end of the link, driven by the caller
+class Stack
+{
+public:
+  Stack( const TCPConfig& config, LoopbackAdapter&& adapter ) : peer_( config ), adapter_( move( adapter ) ) {}
+
+  TCPPeer& peer() { return peer_; }
+
+  void push()
+  {
+    peer_.push( [&]( const TCPMessage& msg ) { adapter_.write( msg ); } );
+  }
+
+  // Give the TCPPeer everything that has arrived, as one batch (as TCPMinnowSocket does)
+  void service()
+  {
+    while ( auto msg = adapter_.read() ) {
+      batch_.push_back( move( msg.value() ) );
+    }
+    if ( not batch_.empty() ) {
+      peer_.receive_batch( batch_, [&]( const TCPMessage& msg ) { adapter_.write( msg ); } );
+      batch_.clear();
+    }
+  }
+
+private:
+  TCPPeer peer_;
+  LoopbackAdapter adapter_;
+  vector<TCPMessage> batch_ {};
+};
+
+pair<Stack, Stack> connected_stacks()
+{
+  auto [client_side, server_side] = LoopbackAdapter::make_pair();
+  pair<Stack, Stack> ret { Stack { TCPConfig {}, move( client_side ) },
+                          Stack { TCPConfig {}, move( server_side ) } };
+  auto& [client, server] = ret;
+  client.push();    // SYN
+  server.service(); // SYN/ACK
+  client.service(); // ACK
+  server.service();
+  if ( not client.peer().has_ackno() or not server.peer().has_ackno() ) {
+    throw runtime_error( "TCPPeers did not connect" );
+  }
+  return ret;
+}
+
+void peers_bulk( uint64_t total_bytes )
+{
+  auto [client, server] = connected_stacks();
+  const string chunk( TCPConfig::DEFAULT_CAPACITY, 'x' );
+  uint64_t pushed = 0;
+
+  const auto start_time = steady_clock::now();
+  while ( server.peer().inbound_reader().bytes_popped() < total_bytes ) {
+    Writer& outbound = client.peer().outbound_writer();
+    const uint64_t length = min( { outbound.available_capacity(), chunk.size(), total_bytes - pushed } );
+    if ( length > 0 ) {
+      outbound.push( chunk.substr( 0, length ) );
+      pushed += length;
+    }
+    client.push();
+    server.service();
+    server.peer().inbound_reader().pop( server.peer().inbound_reader().bytes_buffered() );
+    client.service();
+  }
+  report_goodput( "TCPPeers, bulk transfer", total_bytes, steady_clock::now() - start_time );
+}
+
+void peers_request_response( size_t transactions )
+{
+  auto [client, server] = connected_stacks();
+  const string request( REQUEST_SIZE, 'q' );
+  const string response( RESPONSE_SIZE, 'r' );
+  vector<steady_clock::duration> latencies;
+  latencies.reserve( transactions );
+
+  for ( size_t i = 0; i < transactions; i++ ) {
+    const auto start_time = steady_clock::now();
+    client.peer().outbound_writer().push( request );
+    client.push();
+    while ( client.peer().inbound_reader().bytes_buffered() < RESPONSE_SIZE ) {
+      server.service();
+      if ( server.peer().inbound_reader().bytes_buffered() >= REQUEST_SIZE ) {
+        server.peer().inbound_reader().pop( REQUEST_SIZE );
+        server.peer().outbound_writer().push( response );
+        server.push();
+      }
+      client.service();
+    }
+    client.peer().inbound_reader().pop( RESPONSE_SIZE );
+    latencies.push_back( steady_clock::now() - start_time );
+  }
+  report_latency( "TCPPeers, request/response", latencies );
+}
+
+// (with the default NetemConfig, the NetemAdapter passes segments straight through)
+using LoopbackSocket = TCPMinnowSocket<NetemAdapter<LoopbackAdapter>>;
+
+// Connect two TCPMinnowSockets, each sending over `link`, run `server_body` on the server's in a thread and
+// `client_body` on the client's
+template<typename ServerT, typename ClientT>
+void run_sockets( const NetemConfig& link, ServerT&& server_body, ClientT&& client_body )
+{
+  auto [client_side, server_side] = LoopbackAdapter::make_pair();
+  LoopbackSocket client { NetemAdapter { move( client_side ), link } };
+  LoopbackSocket server { NetemAdapter { move( server_side ), link } };
+  run_connection( client, server, socket_pair_tcp_config(), server_body, client_body );
+}
+
+// Read exactly `length` bytes
+void read_exactly( LoopbackSocket& socket, size_t length, string& buffer )
+{
+  for ( size_t received = 0; received < length; received += buffer.size() ) {
+    buffer.resize( length - received );
+    socket.read( buffer );
+    if ( socket.eof() ) {
+      throw runtime_error( "stream ended early" );
+    }
+  }
+}
+
+void sockets_bulk( const string& mode, uint64_t total_bytes, const NetemConfig& link = {} )
+{
+  const string chunk( 65536, 'x' );
+  steady_clock::time_point start_time;
+  steady_clock::time_point stop_time;
+  uint64_t received = 0;
+
+  run_sockets(
+    link,
+    [&]( LoopbackSocket& server ) {
+      string buffer;
+      while ( not server.eof() ) {
+        buffer.clear();
+        server.read( buffer );
+        received += buffer.size();
+      }
+      stop_time = steady_clock::now();
+    },
+    [&]( LoopbackSocket& client ) {
+      start_time = steady_clock::now();
+      for ( uint64_t sent = 0; sent < total_bytes; sent += chunk.size() ) {
+        write_all( client, string_view { chunk }.substr( 0, total_bytes - sent ) );
+      }
+      client.shutdown( SHUT_WR );
+      string buffer;
+      while ( not client.eof() ) {
+        client.read( buffer ); // (until the server has closed its side)
+      }
+    } );
+
+  if ( received != total_bytes ) {
+    throw runtime_error( mode + ": stream was not delivered" );
+  }
+  report_goodput( mode, total_bytes, stop_time - start_time );
+}
+
+void sockets_request_response( size_t transactions )
+{
+  const string request( REQUEST_SIZE, 'q' );
+  const string response( RESPONSE_SIZE, 'r' );
+  vector<steady_clock::duration> latencies;
+  latencies.reserve( transactions );
+
+  run_sockets(
+    {},
+    [&]( LoopbackSocket& server ) {
+      string buffer;
+      for ( size_t i = 0; i < transactions; i++ ) {
+        read_exactly( server, REQUEST_SIZE, buffer );
+        write_all( server, response );
+      }
+      while ( not server.eof() ) {
+        server.read( buffer ); // (until the client closes its side)
+      }
+    },
+    [&]( LoopbackSocket& client ) {
+      string buffer;
+      for ( size_t i = 0; i < transactions; i++ ) {
+        const auto start_time = steady_clock::now();
+        write_all( client, request );
+        read_exactly( client, RESPONSE_SIZE, buffer );
+        latencies.push_back( steady_clock::now() - start_time );
+      }
+      client.shutdown( SHUT_WR );
+      while ( not client.eof() ) {
+        client.read( buffer ); // (until the server has closed its side)
+      }
+    } );
+  report_latency( "TCPMinnowSockets, request/response", latencies );
+}
+
+void program_body()
+{
+  peers_bulk( 1'000'000'000 );
+  peers_request_response( 200'000 );
+  sockets_bulk( "TCPMinnowSockets, bulk transfer", 100'000'000 );
+  sockets_request_response( 20'000 );
+
+  NetemConfig link;
+  link.delay_ms = 1;
+  link.rate_bps = 200'000'000;
+  link.queue_limit = 100;
+  sockets_bulk( "TCPMinnowSockets, 200 Mbit/s, 2 ms RTT link", 20'000'000, link );
+}
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
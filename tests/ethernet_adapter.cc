@@ -0,0 +1,131 @@
+#include "common.hh"
+#include "ethernet_adapter.hh"
+#include "exception.hh"
+#include "file_descriptor.hh"
+#include "parser.hh"
+#include "socket_transfer.hh"
+#include "tcp_minnow_socket.hh"
+
+#include <array>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <sys/socket.h>
+#include <utility>
+
+using namespace std;
+
+namespace {
+const EthernetAddress ETH_A { 2, 0, 0, 0, 0, 1 };
+const EthernetAddress ETH_B { 2, 0, 0, 0, 0, 2 };
+const Address IP_A { "10.0.0.1" };
+const Address IP_B { "10.0.0.2" };
+} // namespace
+
+// Two connected sockets that keep frames apart (the two sides of a wire, in place of a TAP device)
+pair<FileDescriptor, FileDescriptor> wire()
+{
+  array<int, 2> fds {};
+  CheckSystemCall( "socketpair", ::socketpair( AF_UNIX, SOCK_SEQPACKET, 0, fds.data() ) );
+  return { FileDescriptor { fds[0] }, FileDescriptor { fds[1] } };
+}
+
+// Read one frame (there must be one), returning whether it carried a TCP segment
+optional<TCPMessage> read_frame( TCPOverIPv4OverEthernetAdapter& adapter )
+{
+  const auto reads_before = adapter.fd().read_count();
+  auto ret = adapter.read();
+  check( adapter.fd().read_count() == reads_before + 1, "a frame was waiting" );
+  return ret;
+}
+
+void check_nothing_waiting( TCPOverIPv4OverEthernetAdapter& adapter )
+{
+  const auto reads_before = adapter.fd().read_count();
+  check( not adapter.read().has_value() and adapter.fd().read_count() == reads_before, "no frame waiting" );
+}
+
+// Segments go through ARP and Ethernet: the first waits for the next hop's address, and the rest don't
+void check_adapters()
+{
+  auto [a_side, b_side] = wire();
+  TCPOverIPv4OverEthernetAdapter a { move( a_side ), ETH_A, IP_A, IP_B };
+  TCPOverIPv4OverEthernetAdapter b { move( b_side ), ETH_B, IP_B, IP_A };
+  a.fd().set_blocking( false );
+  b.fd().set_blocking( false );
+  a.config_mut().source = Address { "10.0.0.1", 9000 };
+  a.config_mut().destination = Address { "10.0.0.2", 1234 };
+  b.config_mut().source = a.config().destination;
+  b.config_mut().destination = a.config().source;
+
+  TCPMessage msg;
+  msg.sender.seqno = Wrap32 { 1000 };
+  msg.sender.payload = "hello, link layer";
+
+  a.write( msg );
+  check( not read_frame( b ).has_value(), "the first frame is an ARP request (which b answers)" );
+  check_nothing_waiting( b );
+  check( not read_frame( a ).has_value(), "a gets the ARP reply (and sends the datagram that waited for it)" );
+  const auto received = read_frame( b );
+  check( received.has_value() and received->sender.payload == msg.sender.payload
+           and received->sender.seqno == msg.sender.seqno,
+         "b gets the segment" );
+
+  // b learned a's address from its request, so b's reply goes straight out
+  TCPMessage reply;
+  reply.receiver.ackno = Wrap32 { 1018 };
+  b.write( reply );
+  const auto ack = read_frame( a );
+  check( ack.has_value() and ack->receiver.ackno == reply.receiver.ackno, "a gets the reply, with no ARP" );
+  check_nothing_waiting( a );
+  check_nothing_waiting( b );
+
+  // a frame for another Ethernet address is ignored
+  EthernetFrame stray { .header { .dst = { 2, 0, 0, 0, 0, 3 }, .src = ETH_A, .type = EthernetHeader::TYPE_IPv4 },
+                        .payload = serialize( a.wrap_tcp_in_ip( msg ) ) };
+  a.fd().write( serialize( stray ) );
+  check( not read_frame( b ).has_value(), "frame for someone else ignored" );
+
+  // so is a runt
+  a.fd().write( string_view { "\x02\x00\x00", 3 } );
+  check( not read_frame( b ).has_value(), "runt frame ignored" );
+
+  // once a's mapping expires, the next segment asks again
+  a.tick( 30'000 );
+  a.write( msg );
+  check( not read_frame( b ).has_value() and not read_frame( a ).has_value(), "ARP again after expiry" );
+  check( read_frame( b ).has_value(), "and then the segment" );
+}
+
+// A whole connection between two TCPMinnowSockets, through their NetworkInterfaces
+void check_connection()
+{
+  auto [client_side, server_side] = wire();
+  TCPMinnowSocket<TCPOverIPv4OverEthernetAdapter> client {
+    TCPOverIPv4OverEthernetAdapter { move( client_side ), ETH_A, IP_A, IP_B } };
+  TCPMinnowSocket<TCPOverIPv4OverEthernetAdapter> server {
+    TCPOverIPv4OverEthernetAdapter { move( server_side ), ETH_B, IP_B, IP_A } };
+
+  TCPConfig tcp_config;
+  tcp_config.rt_timeout = 10;
+  tcp_config.recv_capacity = 16000; // (what the socket pair can buffer, in frames of a full segment)
+
+  check_transfer( client, server, tcp_config, 100'000 );
+}
+
+int main()
+{
+  try {
+    check_adapters();
+    check_connection();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,297 @@
+#include "ethernet_adapter.hh"
+#include "exception.hh"
+#include "file_descriptor.hh"
+#include "ipv4_datagram.hh"
+#include "parser.hh"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/socket.h>
+#include <utility>
+
+using namespace std;
+using namespace std::chrono;
+
+// What the Ethernet and ARP layers cost per frame. First in memory: segments wrapped in IPv4 and unwrapped
+// again, either directly or through two NetworkInterfaces that hand their frames to each other (as EthernetFrames,
+// or serialized into one buffer and parsed in place, as a device would see them, against bare datagrams
+// serialized and parsed the same way). Then the same
+// over a socket pair, as bare IPv4 datagrams (as on a TUN device) and through TCPOverIPv4OverEthernetAdapter:
+// both pay two system calls per frame, which is most of the cost. Last, the cost of resolving a next hop: an
+// ARP request and reply before each segment.
+
+template<typename OperationT>
+double speed_test( const string& mode, size_t rounds, const string& unit, OperationT&& operation )
+{
+  const auto start_time = steady_clock::now();
+  for ( size_t i = 0; i < rounds; i++ ) {
+    operation( i );
+  }
+  const auto stop_time = steady_clock::now();
+
+  auto test_duration = duration_cast<duration<double>>( stop_time - start_time );
+  auto millions_per_second = static_cast<double>( rounds ) / test_duration.count() / 1e6;
+
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  cout << "  " << left << setw( 44 ) << mode << right << fixed << setprecision( 2 ) << setw( 8 )
+       << millions_per_second << " million " << unit << "/s\n";
+
+  debug_output << "             " << mode << ": " << fixed << setprecision( 2 ) << millions_per_second
+               << " million " << unit << "/s\n";
+
+  if ( millions_per_second < 0.01 ) {
+    throw runtime_error( mode + " did not meet minimum speed of 0.01 million " + unit + "/s." );
+  }
+
+  return millions_per_second;
+}
+
+pair<FileDescriptor, FileDescriptor> wire()
+{
+  array<int, 2> fds {};
+  CheckSystemCall( "socketpair", ::socketpair( AF_UNIX, SOCK_SEQPACKET, 0, fds.data() ) );
+  return { FileDescriptor { fds[0] }, FileDescriptor { fds[1] } };
+}
+
+TCPMessage make_segment( size_t payload_length )
+{
+  TCPMessage msg;
+  msg.sender.seqno = Wrap32 { 1000 };
+  msg.sender.payload = string( payload_length, 'x' );
+  msg.receiver.ackno = Wrap32 { 2000 };
+  msg.receiver.window_size = 64000;
+  return msg;
+}
+
+void configure( TCPOverIPv4Adapter& sender, TCPOverIPv4Adapter& receiver )
+{
+  sender.config_mut().source = Address { "10.0.0.1", 9000 };
+  sender.config_mut().destination = Address { "10.0.0.2", 1234 };
+  receiver.config_mut().source = sender.config().destination;
+  receiver.config_mut().destination = sender.config().source;
+}
+
+void expect( const optional<TCPMessage>& received, const TCPMessage& sent )
+{
+  if ( not received.has_value() or received->sender.payload.size() != sent.sender.payload.size() ) {
+    throw runtime_error( "segment did not arrive" );
+  }
+}
+
+// Hands each frame straight to another NetworkInterface
+class Wire : public NetworkInterface::OutputPort
+{
+public:
+  NetworkInterface* peer {};
+  void transmit( const NetworkInterface& sender [[maybe_unused]], const EthernetFrame& frame ) override
+  {
+    peer->recv_frame( frame );
+  }
+};
+
+// Copies each frame into one buffer, as a device would, for the receiver to parse in place
+class FrameBuffer : public NetworkInterface::OutputPort
+{
+public:
+  array<char, 2048> buffer {};
+  string_view frame {};
+  void transmit( const NetworkInterface& sender [[maybe_unused]], const EthernetFrame& x [[maybe_unused]] ) override
+  {
+    throw runtime_error( "frame sent unserialized" );
+  }
+  void transmit_serialized( const NetworkInterface& sender [[maybe_unused]], span<const string_view> bufs ) override
+  {
+    copy( bufs );
+  }
+  void copy( span<const string_view> bufs )
+  {
+    size_t length = 0;
+    for ( const auto buf : bufs ) {
+      ranges::copy( buf, buffer.begin() + static_cast<ptrdiff_t>( length ) );
+      length += buf.size();
+    }
+    frame = { buffer.data(), length };
+  }
+};
+
+void in_memory( const string& size, const TCPMessage& msg, size_t rounds )
+{
+  TCPOverIPv4Adapter sender;
+  TCPOverIPv4Adapter receiver;
+  configure( sender, receiver );
+
+  const double bare = speed_test( "IPv4 only, in memory (" + size + ")", rounds, "frames", [&]( size_t ) {
+    expect( receiver.unwrap_tcp_in_ip( sender.wrap_tcp_in_ip( msg ) ), msg );
+  } );
+
+  const auto sender_wire = make_shared<Wire>();
+  const auto receiver_wire = make_shared<Wire>();
+  NetworkInterface sender_interface { "sender", sender_wire, { 2, 0, 0, 0, 0, 1 }, Address { "10.0.0.1" } };
+  NetworkInterface receiver_interface { "receiver", receiver_wire, { 2, 0, 0, 0, 0, 2 }, Address { "10.0.0.2" } };
+  sender_wire->peer = &receiver_interface;
+  receiver_wire->peer = &sender_interface;
+  const Address next_hop { "10.0.0.2" };
+  auto& received = receiver_interface.datagrams_received();
+
+  const double framed = speed_test( "Ethernet + ARP, in memory (" + size + ")", rounds, "frames", [&]( size_t ) {
+    sender_interface.send_datagram( sender.wrap_tcp_in_ip( msg ), next_hop );
+    expect( receiver.unwrap_tcp_in_ip( received.front() ), msg );
+    received.pop();
+  } );
+  cout << "    (the link layer adds " << fixed << setprecision( 0 ) << 1e3 / framed - 1e3 / bare
+       << " ns per frame)\n";
+
+  // the headers serialized in front of the payload, and the frame parsed where it lies
+  const auto sender_buffer = make_shared<FrameBuffer>();
+  const auto receiver_buffer = make_shared<FrameBuffer>();
+  NetworkInterface sender_in_place { "sender", sender_buffer, { 2, 0, 0, 0, 0, 1 }, Address { "10.0.0.1" } };
+  NetworkInterface receiver_in_place { "receiver", receiver_buffer, { 2, 0, 0, 0, 0, 2 }, Address { "10.0.0.2" } };
+  const uint32_t next_hop_ip = next_hop.ipv4_numeric();
+  array<char, 20> tcp_header_buffer {}; // (no options)
+  const auto deliver = []( NetworkInterface& to, const FrameBuffer& from ) {
+    Parser parser { from.frame };
+    EthernetFrameView frame;
+    frame.parse( parser );
+    return to.recv_frame( frame );
+  };
+  sender_in_place.send_datagram( InternetDatagram {}, next_hop );
+  deliver( receiver_in_place, *sender_buffer ); // ARP request
+  deliver( sender_in_place, *receiver_buffer ); // ARP reply (and the datagram that waited for it)
+  deliver( receiver_in_place, *sender_buffer );
+
+  // the baseline for that: the same steps without the link layer, the IPv4 header serialized by hand and the
+  // datagram parsed in place
+  array<char, IPv4Header::LENGTH> ip_header_buffer {};
+  FrameBuffer datagram_buffer;
+  const double bare_in_place = speed_test( "IPv4 only, in place (" + size + ")", rounds, "frames", [&]( size_t ) {
+    const auto [ip_header, tcp_header] = sender.wrap_headers( msg );
+    Serializer ip_serializer { span { ip_header_buffer } };
+    ip_header.serialize( ip_serializer );
+    Serializer tcp_serializer { span { tcp_header_buffer } };
+    tcp_header.serialize( tcp_serializer );
+    const array<string_view, 3> datagram { string_view { ip_header_buffer.data(), ip_header_buffer.size() },
+                                           string_view { tcp_header_buffer.data(), tcp_header_buffer.size() },
+                                           msg.sender.payload };
+    datagram_buffer.copy( datagram );
+    Parser parser { datagram_buffer.frame };
+    IPv4DatagramView received_dgram;
+    received_dgram.parse( parser );
+    if ( parser.has_error() ) {
+      throw runtime_error( "datagram did not parse" );
+    }
+    expect( receiver.unwrap_tcp_in_ip( received_dgram ), msg );
+  } );
+
+  const double in_place = speed_test( "Ethernet + ARP, in place (" + size + ")", rounds, "frames", [&]( size_t ) {
+    const auto [ip_header, tcp_header] = sender.wrap_headers( msg );
+    Serializer serializer { span { tcp_header_buffer } };
+    tcp_header.serialize( serializer );
+    const array<string_view, 2> payload { string_view { tcp_header_buffer.data(), tcp_header_buffer.size() },
+                                          msg.sender.payload };
+    sender_in_place.send_datagram( ip_header, payload, next_hop_ip );
+    const auto received_dgram = deliver( receiver_in_place, *sender_buffer );
+    if ( not received_dgram.has_value() ) {
+      throw runtime_error( "datagram did not arrive" );
+    }
+    expect( receiver.unwrap_tcp_in_ip( *received_dgram ), msg );
+  } );
+  cout << "    (in place, the link layer adds " << fixed << setprecision( 0 )
+       << 1e3 / in_place - 1e3 / bare_in_place << " ns per frame)\n";
+}
+
+// bare IPv4 datagrams, serialized and parsed as TCPOverIPv4OverTunFdAdapter does
+void bare_ipv4( const string& mode, const TCPMessage& msg, size_t rounds )
+{
+  auto [sender_side, receiver_side] = wire();
+  TCPOverIPv4Adapter sender;
+  TCPOverIPv4Adapter receiver;
+  configure( sender, receiver );
+  string buffer( 65535, 0 );
+
+  speed_test( mode, rounds, "frames", [&]( size_t ) {
+    sender_side.write( serialize( sender.wrap_tcp_in_ip( msg ) ) );
+    const size_t length = receiver_side.read( span { buffer } );
+    expect( receiver.unwrap_tcp_in_ip( string_view { buffer.data(), length } ), msg );
+  } );
+}
+
+struct AdapterPair
+{
+  TCPOverIPv4OverEthernetAdapter sender;
+  TCPOverIPv4OverEthernetAdapter receiver;
+};
+
+AdapterPair ethernet_pair()
+{
+  auto [sender_side, receiver_side] = wire();
+  AdapterPair ret { { move( sender_side ), { 2, 0, 0, 0, 0, 1 }, Address { "10.0.0.1" }, Address { "10.0.0.2" } },
+                    { move( receiver_side ), { 2, 0, 0, 0, 0, 2 }, Address { "10.0.0.2" }, Address { "10.0.0.1" } } };
+  configure( ret.sender, ret.receiver );
+  return ret;
+}
+
+// the same, through the NetworkInterfaces (with the next hop's address already resolved)
+void ethernet( const string& mode, const TCPMessage& msg, size_t rounds )
+{
+  auto [sender, receiver] = ethernet_pair();
+  sender.write( msg );
+  receiver.read(); // ARP request
+  sender.read();   // ARP reply
+  receiver.read(); // the segment
+
+  speed_test( mode, rounds, "frames", [&]( size_t ) {
+    sender.write( msg );
+    expect( receiver.read(), msg );
+  } );
+}
+
+void program_body()
+{
+  constexpr size_t rounds = 200'000;
+  for ( const size_t payload_length : { size_t { 0 }, TCPConfig::MAX_PAYLOAD_SIZE } ) {
+    const TCPMessage msg = make_segment( payload_length );
+    const string size = payload_length == 0 ? "ACKs" : "full segments";
+    in_memory( size, msg, rounds * 5 );
+    bare_ipv4( "IPv4 only, socket pair (" + size + ")", msg, rounds );
+    ethernet( "Ethernet + ARP, socket pair (" + size + ")", msg, rounds );
+  }
+
+  // every segment to a next hop whose mapping has expired: three frames (request, reply, segment)
+  {
+    const TCPMessage msg = make_segment( 0 );
+    auto [sender, receiver] = ethernet_pair();
+    speed_test( "ARP resolution, then the segment", rounds / 4, "resolutions", [&]( size_t ) {
+      sender.tick( 30'000 ); // (the mapping lasts 30 seconds)
+      sender.write( msg );
+      receiver.read();
+      sender.read();
+      expect( receiver.read(), msg );
+    } );
+  }
+}
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
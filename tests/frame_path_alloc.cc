@@ -0,0 +1,218 @@
+#include "alloc_counter.hh"
+#include "arp_message.hh"
+#include "common.hh"
+#include "ethernet_adapter.hh"
+#include "exception.hh"
+#include "network_interface.hh"
+#include "parser.hh"
+#include "router.hh"
+
+#include <array>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/socket.h>
+#include <utility>
+
+using namespace std;
+
+namespace {
+const EthernetAddress ETH_A { 2, 0, 0, 0, 0, 1 };
+const EthernetAddress ETH_B { 2, 0, 0, 0, 0, 2 };
+} // namespace
+
+// Keeps the last frame sent, as a device would: its bytes, in one buffer
+class FrameCopy : public NetworkInterface::OutputPort
+{
+public:
+  array<char, 2048> buffer {};
+  string_view frame {};
+  size_t frames {};
+
+  void transmit( const NetworkInterface& sender [[maybe_unused]], const EthernetFrame& x [[maybe_unused]] ) override
+  {
+    throw runtime_error( "frame sent unserialized" );
+  }
+
+  void transmit_serialized( const NetworkInterface& sender [[maybe_unused]],
+                            span<const string_view> buffers ) override
+  {
+    size_t length = 0;
+    for ( const auto buf : buffers ) {
+      ranges::copy( buf, buffer.begin() + static_cast<ptrdiff_t>( length ) );
+      length += buf.size();
+    }
+    frame = { buffer.data(), length };
+    frames++;
+  }
+
+  EthernetFrameView parsed() const
+  {
+    Parser parser { frame };
+    EthernetFrameView ret;
+    ret.parse( parser );
+    if ( parser.has_error() ) {
+      throw runtime_error( "frame sent doesn't parse" );
+    }
+    return ret;
+  }
+};
+
+InternetDatagram make_datagram( size_t payload_length )
+{
+  InternetDatagram dgram;
+  dgram.header.src = Address { "10.0.0.1" }.ipv4_numeric();
+  dgram.header.dst = Address { "10.0.0.2" }.ipv4_numeric();
+  dgram.header.len = static_cast<uint16_t>( IPv4Header::LENGTH + payload_length );
+  dgram.header.compute_checksum();
+  dgram.payload.emplace_back( payload_length, 'x' );
+  return dgram;
+}
+
+// Two interfaces with a frame-copying port each, that have resolved each other
+pair<NetworkInterface, NetworkInterface> connected_interfaces( const shared_ptr<FrameCopy>& a_port,
+                                                               const shared_ptr<FrameCopy>& b_port )
+{
+  pair<NetworkInterface, NetworkInterface> ret { NetworkInterface { "a", a_port, ETH_A, Address { "10.0.0.1" } },
+                                                 NetworkInterface { "b", b_port, ETH_B, Address { "10.0.0.2" } } };
+  ret.first.send_datagram( make_datagram( 0 ), Address { "10.0.0.2" } );
+  ret.second.recv_frame( a_port->parsed() ); // the ARP request
+  ret.first.recv_frame( b_port->parsed() );  // the reply (and a sends the datagram)
+  return ret;
+}
+
+// Frames sent and received by NetworkInterfaces, and forwarded by a Router
+void check_interfaces()
+{
+  const auto a_port = make_shared<FrameCopy>();
+  const auto b_port = make_shared<FrameCopy>();
+  auto [a, b] = connected_interfaces( a_port, b_port );
+
+  const InternetDatagram dgram = make_datagram( 1000 );
+  const uint32_t b_ip = Address { "10.0.0.2" }.ipv4_numeric();
+  check( count_allocations( [&] { a.send_datagram( dgram, b_ip ); } ) == 0,
+         "send_datagram( InternetDatagram ) allocates nothing" );
+
+  const array<string_view, 1> payload { dgram.payload.front() };
+  check( count_allocations( [&] { a.send_datagram( dgram.header, payload, b_ip ); } ) == 0,
+         "send_datagram( header, payload ) allocates nothing" );
+
+  // received in place: the datagram is a view into the frame
+  // (the results are checked after counting: a check's description is a string of its own)
+  bool all_received = true;
+  const size_t receive_allocations = count_allocations( [&] {
+    const auto received = b.recv_frame( a_port->parsed() );
+    all_received &= received.has_value() and received->payload == dgram.payload.front();
+  } );
+  check( all_received, "datagram received in place" );
+  check( receive_allocations == 0, "recv_frame( EthernetFrameView ) allocates nothing" );
+
+  // an ARP request for b, which b learns from and answers
+  ARPMessage request;
+  request.opcode = ARPMessage::OPCODE_REQUEST;
+  request.sender_ethernet_address = ETH_A;
+  request.sender_ip_address = Address { "10.0.0.1" }.ipv4_numeric();
+  request.target_ip_address = b_ip;
+  const string request_frame = [&] {
+    string ret;
+    for ( const auto& buf : serialize( EthernetFrame { { ETHERNET_BROADCAST, ETH_A, EthernetHeader::TYPE_ARP },
+                                                       serialize( request ) } ) ) {
+      ret += buf;
+    }
+    return ret;
+  }();
+  const size_t replies_before = b_port->frames;
+  const size_t arp_allocations = count_allocations( [&] {
+    Parser parser { request_frame };
+    EthernetFrameView frame;
+    frame.parse( parser );
+    b.recv_frame( frame );
+  } );
+  check( b_port->frames == replies_before + 200, "ARP requests answered" );
+  check( arp_allocations == 0, "answering an ARP request allocates nothing" );
+
+  // forwarded by a router: datagrams into one interface and out another, to a neighbor it knows
+  Router router;
+  const auto in_port = make_shared<FrameCopy>();
+  const auto out_port = make_shared<FrameCopy>();
+  const auto neighbor_port = make_shared<FrameCopy>();
+  const auto in = make_shared<NetworkInterface>( "in", in_port, ETH_A, Address { "10.0.0.1" } );
+  [[maybe_unused]] auto [out, neighbor] = connected_interfaces( out_port, neighbor_port );
+  router.add_interface( in );
+  router.add_interface( make_shared<NetworkInterface>( move( out ) ) );
+  router.add_route( b_ip, 32, {}, 1 );
+  const size_t forwarded_before = out_port->frames;
+  const size_t route_allocations = count_allocations( [&] {
+    // (the datagram comes from outside the router)
+    without_counting_allocations( [&] { in->datagrams_received().push( dgram ); } );
+    router.route();
+  } );
+  check( out_port->frames == forwarded_before + 200, "datagrams forwarded" );
+  check( route_allocations == 0, "Router::route() allocates nothing" );
+}
+
+// A TCPOverIPv4OverEthernetAdapter writing segments to another, over a socket pair
+void check_adapter( const string& test_name, const TCPMessage& msg, size_t expected_read_allocations )
+{
+  array<int, 2> fds {};
+  CheckSystemCall( "socketpair", ::socketpair( AF_UNIX, SOCK_SEQPACKET, 0, fds.data() ) );
+  const Address a_ip { "10.0.0.1" };
+  const Address b_ip { "10.0.0.2" };
+  TCPOverIPv4OverEthernetAdapter a { FileDescriptor { fds[0] }, ETH_A, a_ip, b_ip };
+  TCPOverIPv4OverEthernetAdapter b { FileDescriptor { fds[1] }, ETH_B, b_ip, a_ip };
+  a.config_mut().source = Address { "10.0.0.1", 9000 };
+  a.config_mut().destination = Address { "10.0.0.2", 1234 };
+  b.config_mut().source = a.config().destination;
+  b.config_mut().destination = a.config().source;
+  a.write( msg );
+  b.read(); // the ARP request
+  a.read(); // the reply
+  b.read(); // the segment
+
+  const size_t write_allocations = count_allocations( [&] {
+    a.write( msg );
+    without_counting_allocations( [&] { b.read(); } );
+  } );
+  check( write_allocations == 0, test_name + ": write allocates nothing" );
+
+  constexpr size_t rounds = 100;
+  bool all_arrived = true;
+  const size_t read_allocations = count_allocations(
+    [&] {
+      without_counting_allocations( [&] { a.write( msg ); } );
+      const auto received = b.read();
+      all_arrived &= received.has_value() and received->sender.payload == msg.sender.payload;
+    },
+    rounds );
+  check( all_arrived, test_name + ": segments arrived" );
+  check( read_allocations == expected_read_allocations * rounds,
+         test_name + ": read makes " + to_string( expected_read_allocations ) + " allocations" );
+}
+
+int main()
+{
+  try {
+    check_interfaces();
+
+    TCPMessage ack;
+    ack.sender.seqno = Wrap32 { 1000 };
+    ack.receiver.ackno = Wrap32 { 5000 };
+    ack.receiver.window_size = 4096;
+    check_adapter( "pure ACK", ack, 0 );
+
+    TCPMessage data = ack;
+    data.sender.payload = string( 1000, 'x' );
+    check_adapter( "full-sized segment", data, 1 ); // only the copy of the payload out of the frame
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
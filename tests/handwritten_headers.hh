@@ -0,0 +1,165 @@
+#pragma once
+
+#include "arp_message.hh"
+#include "ethernet_header.hh"
+#include "ipv4_header.hh"
+#include "parser.hh"
+#include "tcp_segment.hh"
+#include "wrapping_integers.hh"
+
+#include <cstdint>
+
+// The field-by-field parse and serialize code that the HeaderLayout descriptions replaced (fixed-size
+// header only: no options, payload, or checks), to test and benchmark the generated code against.
+
+class RawWrap32 : public Wrap32
+{
+public:
+  uint32_t raw_value() const { return raw_value_; }
+};
+
+inline void handwritten_parse( IPv4Header& h, Parser& parser )
+{
+  uint8_t first_byte {};
+  parser.integer( first_byte );
+  h.ver = first_byte >> 4;
+  h.hlen = first_byte & 0x0f;
+  parser.integer( h.tos );
+  parser.integer( h.len );
+  parser.integer( h.id );
+
+  uint16_t fo_val {};
+  parser.integer( fo_val );
+  h.df = static_cast<bool>( fo_val & 0x4000 );
+  h.mf = static_cast<bool>( fo_val & 0x2000 );
+  h.offset = fo_val & 0x1fff;
+
+  parser.integer( h.ttl );
+  parser.integer( h.proto );
+  parser.integer( h.cksum );
+  parser.integer( h.src );
+  parser.integer( h.dst );
+}
+
+inline void handwritten_serialize( const IPv4Header& h, Serializer& serializer )
+{
+  const uint8_t first_byte = ( static_cast<uint32_t>( h.ver ) << 4 ) | ( h.hlen & 0xfU );
+  serializer.integer( first_byte );
+  serializer.integer( h.tos );
+  serializer.integer( h.len );
+  serializer.integer( h.id );
+
+  const uint16_t fo_val = ( h.df ? 0x4000U : 0 ) | ( h.mf ? 0x2000U : 0 ) | ( h.offset & 0x1fffU );
+  serializer.integer( fo_val );
+
+  serializer.integer( h.ttl );
+  serializer.integer( h.proto );
+  serializer.integer( h.cksum );
+  serializer.integer( h.src );
+  serializer.integer( h.dst );
+}
+
+inline void handwritten_parse( TCPSegment& seg, Parser& parser )
+{
+  uint32_t raw32 {};
+  uint16_t raw16 {};
+  uint8_t octet {};
+
+  parser.integer( seg.udinfo.src_port );
+  parser.integer( seg.udinfo.dst_port );
+
+  parser.integer( raw32 );
+  seg.message.sender.seqno = Wrap32 { raw32 };
+
+  parser.integer( raw32 );
+  seg.message.receiver.ackno = Wrap32 { raw32 };
+
+  parser.integer( octet ); // data offset
+
+  parser.integer( octet ); // flags
+  if ( not( octet & 0b0001'0000 ) ) {
+    seg.message.receiver.ackno.reset();
+  }
+
+  seg.message.sender.RST = seg.message.receiver.RST = octet & 0b0000'0100;
+  seg.message.sender.SYN = octet & 0b0000'0010;
+  seg.message.sender.FIN = octet & 0b0000'0001;
+
+  parser.integer( seg.message.receiver.window_size );
+  parser.integer( seg.udinfo.cksum );
+  parser.integer( raw16 ); // urgent pointer
+}
+
+inline void handwritten_serialize( const TCPSegment& seg, Serializer& serializer )
+{
+  const TCPMessage& msg = seg.message;
+  const bool reset = msg.sender.RST or msg.receiver.RST;
+  const uint8_t flags = ( msg.receiver.ackno.has_value() ? 0b0001'0000U : 0 ) | ( reset ? 0b0000'0100U : 0 )
+                        | ( msg.sender.SYN ? 0b0000'0010U : 0 ) | ( msg.sender.FIN ? 0b0000'0001U : 0 );
+
+  serializer.integer( seg.udinfo.src_port );
+  serializer.integer( seg.udinfo.dst_port );
+  serializer.integer( RawWrap32 { msg.sender.seqno }.raw_value() );
+  serializer.integer( RawWrap32 { msg.receiver.ackno.value_or( Wrap32 { 0 } ) }.raw_value() );
+  serializer.integer( uint8_t { 5 << 4 } ); // data offset
+  serializer.integer( flags );
+  serializer.integer( msg.receiver.window_size );
+  serializer.integer( seg.udinfo.cksum );
+  serializer.integer( uint16_t { 0 } ); // urgent pointer
+}
+
+inline void handwritten_parse( ARPMessage& arp, Parser& parser )
+{
+  parser.integer( arp.hardware_type );
+  parser.integer( arp.protocol_type );
+  parser.integer( arp.hardware_address_size );
+  parser.integer( arp.protocol_address_size );
+  parser.integer( arp.opcode );
+  for ( auto& b : arp.sender_ethernet_address ) {
+    parser.integer( b );
+  }
+  parser.integer( arp.sender_ip_address );
+  for ( auto& b : arp.target_ethernet_address ) {
+    parser.integer( b );
+  }
+  parser.integer( arp.target_ip_address );
+}
+
+inline void handwritten_serialize( const ARPMessage& arp, Serializer& serializer )
+{
+  serializer.integer( arp.hardware_type );
+  serializer.integer( arp.protocol_type );
+  serializer.integer( arp.hardware_address_size );
+  serializer.integer( arp.protocol_address_size );
+  serializer.integer( arp.opcode );
+  for ( const auto& b : arp.sender_ethernet_address ) {
+    serializer.integer( b );
+  }
+  serializer.integer( arp.sender_ip_address );
+  for ( const auto& b : arp.target_ethernet_address ) {
+    serializer.integer( b );
+  }
+  serializer.integer( arp.target_ip_address );
+}
+
+inline void handwritten_parse( EthernetHeader& eth, Parser& parser )
+{
+  for ( auto& b : eth.dst ) {
+    parser.integer( b );
+  }
+  for ( auto& b : eth.src ) {
+    parser.integer( b );
+  }
+  parser.integer( eth.type );
+}
+
+inline void handwritten_serialize( const EthernetHeader& eth, Serializer& serializer )
+{
+  for ( const auto& b : eth.dst ) {
+    serializer.integer( b );
+  }
+  for ( const auto& b : eth.src ) {
+    serializer.integer( b );
+  }
+  serializer.integer( eth.type );
+}
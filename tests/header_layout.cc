@@ -0,0 +1,157 @@
+#include "handwritten_headers.hh"
+#include "header_layout.hh"
+
+#include <array>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Fields that straddle byte boundaries, a constant, a byte array, and a 64-bit integer
+struct Toy
+{
+  uint8_t a {};
+  uint16_t b {};
+  bool c {};
+  uint32_t d {};
+  EthernetAddress e {};
+  uint64_t f {};
+};
+
+using ToyLayout = HeaderLayout<Field<&Toy::a, 3>,
+                               Field<&Toy::b, 11>,
+                               Field<&Toy::c, 1>,
+                               Constant<1, 1>,
+                               Field<&Toy::d, 24>,
+                               Field<&Toy::e>,
+                               Field<&Toy::f>>;
+static_assert( ToyLayout::size == 19 );
+
+string concat( const vector<string>& buffers )
+{
+  string ret;
+  for ( const auto& buf : buffers ) {
+    ret += buf;
+  }
+  return ret;
+}
+
+void test_toy()
+{
+  const string expected { "\xb6\x8f\x12\x34\x56\x01\x02\x03\x04\x05\x06\x01\x02\x03\x04\x05\x06\x07\x08", 19 };
+
+  // bits beyond a field's width are dropped
+  const Toy toy { .a = 0xfd, .b = 0xf5a3, .c = true, .d = 0xff123456, .e = { 1, 2, 3, 4, 5, 6 }, .f = 0x0102030405060708 };
+  array<char, ToyLayout::size> out {};
+  ToyLayout::serialize( toy, span { out } );
+  if ( string { out.data(), out.size() } != expected ) {
+    throw runtime_error( "toy layout serialized incorrectly" );
+  }
+
+  Toy parsed;
+  ToyLayout::parse( parsed, span<const char, ToyLayout::size> { expected.data(), ToyLayout::size } );
+  if ( parsed.a != 5 or parsed.b != 0x5a3 or not parsed.c or parsed.d != 0x123456 or parsed.e != toy.e
+       or parsed.f != toy.f ) {
+    throw runtime_error( "toy layout parsed incorrectly" );
+  }
+}
+
+// Check the generated serialize and parse against the hand-written ones, from one buffer and from many
+template<class Header>
+void check_against_handwritten( const string& name, const Header& header, auto&&... parse_args )
+{
+  const string generated = concat( serialize( header ) );
+  const string handwritten = [&] {
+    Serializer s;
+    handwritten_serialize( header, s );
+    return concat( s.output() );
+  }();
+  if ( generated != handwritten ) {
+    throw runtime_error( name + ": generated serialize differs from hand-written" );
+  }
+
+  vector<string> bytes;
+  for ( const char c : generated ) {
+    bytes.emplace_back( 1, c );
+  }
+  for ( const auto& input : { vector<string> { generated }, bytes } ) {
+    Header parsed;
+    if ( not parse( parsed, input, parse_args... ) ) {
+      throw runtime_error( name + ": generated parse failed" );
+    }
+    Serializer s;
+    handwritten_serialize( parsed, s );
+    if ( concat( s.output() ) != generated ) {
+      throw runtime_error( name + ": generated parse differs from hand-written" );
+    }
+  }
+}
+
+int main()
+{
+  try {
+    test_toy();
+
+    default_random_engine rd { 35 };
+    uniform_int_distribution<uint32_t> ud;
+    const auto random_address = [&] {
+      EthernetAddress ret {};
+      for ( auto& b : ret ) {
+        b = ud( rd );
+      }
+      return ret;
+    };
+
+    for ( size_t i = 0; i < 1000; i++ ) {
+      IPv4Header ip;
+      ip.tos = ud( rd );
+      ip.len = ud( rd ) | 20;
+      ip.id = ud( rd );
+      ip.df = ud( rd ) % 2;
+      ip.mf = ud( rd ) % 2;
+      ip.offset = ud( rd ) & 0x1fff;
+      ip.ttl = ud( rd );
+      ip.proto = ud( rd );
+      ip.src = ud( rd );
+      ip.dst = ud( rd );
+      ip.compute_checksum();
+      check_against_handwritten( "IPv4Header", ip );
+
+      TCPSegment seg;
+      seg.udinfo = { .src_port = static_cast<uint16_t>( ud( rd ) ),
+                     .dst_port = static_cast<uint16_t>( ud( rd ) ),
+                     .cksum = static_cast<uint16_t>( ud( rd ) ) };
+      seg.message.sender.seqno = Wrap32 { ud( rd ) };
+      if ( ud( rd ) % 2 ) {
+        seg.message.receiver.ackno = Wrap32 { ud( rd ) };
+      }
+      seg.message.sender.SYN = ud( rd ) % 2;
+      seg.message.sender.FIN = ud( rd ) % 2;
+      seg.message.sender.RST = seg.message.receiver.RST = ud( rd ) % 2;
+      seg.message.receiver.window_size = ud( rd );
+      check_against_handwritten( "TCPSegment", seg, uint32_t {}, false );
+
+      ARPMessage arp;
+      arp.opcode = ud( rd ) % 2 ? ARPMessage::OPCODE_REQUEST : ARPMessage::OPCODE_REPLY;
+      arp.sender_ethernet_address = random_address();
+      arp.sender_ip_address = ud( rd );
+      arp.target_ethernet_address = random_address();
+      arp.target_ip_address = ud( rd );
+      check_against_handwritten( "ARPMessage", arp );
+
+      const EthernetHeader eth { random_address(), random_address(), static_cast<uint16_t>( ud( rd ) ) };
+      check_against_handwritten( "EthernetHeader", eth );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
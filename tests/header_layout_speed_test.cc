@@ -0,0 +1,159 @@
+#include "handwritten_headers.hh"
+
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+using namespace std;
+using namespace std::chrono;
+
+// Parse and serialize each header with the code generated from its HeaderLayout and with the hand-written
+// field-by-field code it replaced, and report how many headers per second each manages.
+
+template<typename OperationT>
+double speed_test( const string& mode, OperationT&& operation )
+{
+  constexpr size_t rounds = 2'000'000;
+  uint64_t sink = 0; // keep the compiler from skipping the work
+
+  const auto start_time = steady_clock::now();
+  for ( size_t i = 0; i < rounds; i++ ) {
+    sink += operation();
+  }
+  const auto stop_time = steady_clock::now();
+
+  auto test_duration = duration_cast<duration<double>>( stop_time - start_time );
+  auto millions_per_second = static_cast<double>( rounds ) / test_duration.count() / 1e6;
+
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  cout << "  " << left << setw( 40 ) << mode << right << fixed << setprecision( 2 ) << setw( 8 )
+       << millions_per_second << " million/s" << ( sink ? "" : " " ) << "\n";
+
+  debug_output << "             " << mode << ": " << fixed << setprecision( 2 ) << millions_per_second
+               << " million/s\n";
+
+  if ( millions_per_second < 0.1 ) {
+    throw runtime_error( mode + " did not meet minimum speed of 0.1 million/s." );
+  }
+
+  return millions_per_second;
+}
+
+// A word that depends on the parsed header, so that parsing can't be optimized away
+uint64_t checkword( const IPv4Header& h )
+{
+  return h.src ^ h.dst ^ h.len ^ h.offset;
+}
+
+uint64_t checkword( const TCPSegment& s )
+{
+  return s.udinfo.src_port ^ s.message.receiver.window_size ^ s.message.receiver.ackno.has_value();
+}
+
+uint64_t checkword( const ARPMessage& a )
+{
+  return a.sender_ip_address ^ a.target_ethernet_address[5];
+}
+
+uint64_t checkword( const EthernetHeader& e )
+{
+  return e.type ^ e.src[5];
+}
+
+template<class Header>
+void compare( const string& name, const Header& header, auto&&... parse_args )
+{
+  const string wire = [&] {
+    string ret;
+    for ( const auto& buf : serialize( header ) ) {
+      ret += buf;
+    }
+    return ret;
+  }();
+
+  cout << name << " (" << wire.size() << " bytes):\n";
+
+  const double generated_parse = speed_test( name + " parse, generated", [&] {
+    Parser parser { string_view { wire } };
+    Header parsed;
+    parsed.parse( parser, parse_args... );
+    if ( parser.has_error() ) {
+      throw runtime_error( name + ": parse failed" );
+    }
+    return checkword( parsed );
+  } );
+
+  const double handwritten_parse_speed = speed_test( name + " parse, hand-written", [&] {
+    Parser parser { string_view { wire } };
+    Header parsed;
+    handwritten_parse( parsed, parser );
+    if ( parser.has_error() ) {
+      throw runtime_error( name + ": parse failed" );
+    }
+    return checkword( parsed );
+  } );
+
+  const double generated_serialize = speed_test( name + " serialize, generated", [&] {
+    Serializer serializer;
+    header.serialize( serializer );
+    return serializer.output().front().size();
+  } );
+
+  const double handwritten_serialize_speed = speed_test( name + " serialize, hand-written", [&] {
+    Serializer serializer;
+    handwritten_serialize( header, serializer );
+    return serializer.output().front().size();
+  } );
+
+  cout << "  generated / hand-written: parse " << fixed << setprecision( 2 )
+       << generated_parse / handwritten_parse_speed << "x, serialize "
+       << generated_serialize / handwritten_serialize_speed << "x\n";
+}
+
+void program_body()
+{
+  IPv4Header ip;
+  ip.len = 1040;
+  ip.id = 1234;
+  ip.src = 0xa9fe9009;
+  ip.dst = 0xa9fe9001;
+  ip.compute_checksum();
+  compare( "IPv4Header", ip );
+
+  TCPSegment seg;
+  seg.udinfo = { .src_port = 9000, .dst_port = 1234, .cksum = 0x1234 };
+  seg.message.sender.seqno = Wrap32 { 1000 };
+  seg.message.receiver.ackno = Wrap32 { 5000 };
+  seg.message.receiver.window_size = 4096;
+  compare( "TCPSegment", seg, uint32_t {}, false );
+
+  ARPMessage arp;
+  arp.opcode = ARPMessage::OPCODE_REQUEST;
+  arp.sender_ethernet_address = { 2, 0, 0, 0, 0, 1 };
+  arp.sender_ip_address = 0x0a000001;
+  arp.target_ip_address = 0x0a000002;
+  compare( "ARPMessage", arp );
+
+  const EthernetHeader eth { ETHERNET_BROADCAST, { 2, 0, 0, 0, 0, 1 }, EthernetHeader::TYPE_ARP };
+  compare( "EthernetHeader", eth );
+}
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,247 @@
+#include "arp_message.hh"
+#include "ipv4_fragments.hh"
+#include "network_interface.hh"
+#include "network_interface_test_harness.hh"
+#include "parser.hh"
+#include "random.hh"
+#include "tcp_over_ip.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+InternetDatagram make_datagram( uint16_t id, size_t payload_length )
+{
+  InternetDatagram dgram;
+  dgram.header.id = id;
+  dgram.header.df = false;
+  dgram.header.src = Address( "10.0.0.1", 0 ).ipv4_numeric();
+  dgram.header.dst = Address( "10.0.0.2", 0 ).ipv4_numeric();
+  string payload( payload_length, 0 );
+  for ( size_t i = 0; i < payload_length; i++ ) {
+    payload[i] = static_cast<char>( i * 7 + id );
+  }
+  // in a few buffers, to be cut across
+  for ( size_t start = 0; start < payload_length; start += 777 ) {
+    dgram.payload.push_back( payload.substr( start, 777 ) );
+  }
+  dgram.header.len = static_cast<uint16_t>( IPv4Header::LENGTH + payload_length );
+  dgram.header.compute_checksum();
+  return dgram;
+}
+
+string concatenated( const vector<string>& buffers )
+{
+  string ret;
+  for ( const auto& buffer : buffers ) {
+    ret += buffer;
+  }
+  return ret;
+}
+
+// Cut a datagram into fragments, as they'd come off the wire (serialized, and parsed again)
+vector<InternetDatagram> fragments_of( const InternetDatagram& dgram, size_t mtu )
+{
+  vector<InternetDatagram> ret;
+  check( fragment( dgram, mtu, [&]( const InternetDatagram& piece ) {
+           InternetDatagram parsed;
+           check( parse( parsed, serialize( piece ) ), "fragment parses (and its checksum is right)" );
+           ret.push_back( parsed );
+         } ),
+         "datagram fragmented" );
+  return ret;
+}
+
+optional<pair<IPv4Header, string>> push( IPv4Reassembler& reassembler, const InternetDatagram& piece )
+{
+  Parser payload { piece.payload };
+  const auto whole = reassembler.push( piece.header, payload );
+  if ( not whole.has_value() ) {
+    return {};
+  }
+  return pair { whole->first, string { whole->second } };
+}
+
+void check_fragment()
+{
+  const InternetDatagram dgram = make_datagram( 1, 5000 );
+  const auto pieces = fragments_of( dgram, 1500 );
+  check( pieces.size() == 4, "5000 bytes in 1480-byte pieces is four fragments" );
+  size_t expected_offset = 0;
+  for ( size_t i = 0; i < pieces.size(); i++ ) {
+    const auto& header = pieces[i].header;
+    check( header.len <= 1500 and header.offset * 8UL == expected_offset, "fragment fits, at its offset" );
+    check( header.mf == ( i + 1 < pieces.size() ), "more-fragments set on all but the last" );
+    check( header.id == dgram.header.id and header.dst == dgram.header.dst, "fragment has the datagram's id" );
+    expected_offset += header.payload_length();
+  }
+  check( expected_offset == 5000, "the fragments carry the whole payload" );
+
+  // fragmenting a fragment again keeps offsets relative to the original datagram
+  const auto smaller = fragments_of( pieces[1], 576 );
+  check( smaller.front().header.offset == pieces[1].header.offset and smaller.back().header.mf,
+         "re-fragmented fragment keeps its offset and more-fragments flag" );
+
+  // a datagram that fits is passed on whole, and one that mustn't be fragmented isn't
+  check( fragments_of( make_datagram( 2, 100 ), 1500 ).size() == 1, "small datagram passed whole" );
+  InternetDatagram dont = dgram;
+  dont.header.df = true;
+  check( not fragment( dont, 1500, []( const InternetDatagram& ) {} ), "don't-fragment datagram refused" );
+}
+
+void check_reassembly()
+{
+  auto rng = get_random_engine();
+  const InternetDatagram dgram = make_datagram( 3, 9000 );
+  auto pieces = fragments_of( dgram, 576 );
+
+  // in any order, with duplicates: the datagram comes out once, when its last missing piece arrives
+  for ( int round = 0; round < 20; round++ ) {
+    IPv4Reassembler reassembler;
+    vector<InternetDatagram> arrivals = pieces;
+    arrivals.push_back( pieces.at( rng() % pieces.size() ) );
+    arrivals.push_back( pieces.at( rng() % pieces.size() ) );
+    shuffle( arrivals.begin(), arrivals.end(), rng );
+
+    optional<pair<IPv4Header, string>> whole;
+    size_t completions = 0;
+    for ( const auto& piece : arrivals ) {
+      if ( auto result = push( reassembler, piece ) ) {
+        whole = move( result );
+        completions++;
+        check( reassembler.datagrams_pending() == 0 and reassembler.bytes_pending() == 0, "nothing left" );
+      }
+    }
+    check( completions == 1 and reassembler.stats().reassembled == 1, "datagram reassembled once" );
+    check( whole->second == concatenated( dgram.payload ), "reassembled payload intact" );
+    check( whole->first.len == dgram.header.len and not whole->first.mf and whole->first.offset == 0,
+           "reassembled header made whole" );
+  }
+
+  // a fragment overlapping others (but not a duplicate of received data) drops the datagram
+  {
+    IPv4Reassembler reassembler;
+    push( reassembler, pieces[0] );
+    push( reassembler, pieces[2] );
+    InternetDatagram overlapping = pieces[1];
+    overlapping.header.offset = static_cast<uint16_t>( overlapping.header.offset - 1 ); // 8 bytes early
+    overlapping.header.compute_checksum();
+    check( not push( reassembler, overlapping ).has_value() and reassembler.stats().malformed == 1,
+           "overlapping fragment drops the datagram" );
+    check( reassembler.datagrams_pending() == 0, "dropped datagram forgotten" );
+  }
+
+  // two final fragments that disagree about where the datagram ends
+  {
+    IPv4Reassembler reassembler;
+    push( reassembler, pieces.back() );
+    InternetDatagram early_end = pieces[1];
+    early_end.header.mf = false;
+    early_end.header.compute_checksum();
+    push( reassembler, early_end );
+    check( reassembler.stats().malformed == 1, "inconsistent end drops the datagram" );
+  }
+
+  // a datagram whose fragments don't all arrive in time is dropped
+  {
+    IPv4Reassembler reassembler { { .max_datagrams = 64, .max_bytes = 1 << 20, .timeout_ms = 1000 } };
+    push( reassembler, pieces[0] );
+    reassembler.tick( 999 );
+    check( reassembler.datagrams_pending() == 1, "incomplete datagram waits" );
+    reassembler.tick( 1 );
+    check( reassembler.datagrams_pending() == 0 and reassembler.stats().timed_out == 1, "and then times out" );
+    for ( size_t i = 1; i < pieces.size(); i++ ) {
+      check( not push( reassembler, pieces[i] ).has_value(), "late fragments don't complete it" );
+    }
+  }
+
+  // memory stays bounded: beyond the limits, the oldest datagrams are dropped
+  {
+    IPv4Reassembler reassembler { { .max_datagrams = 4, .max_bytes = 1 << 20, .timeout_ms = 1000 } };
+    for ( uint16_t id = 0; id < 10; id++ ) {
+      push( reassembler, fragments_of( make_datagram( id, 3000 ), 576 ).front() );
+    }
+    check( reassembler.datagrams_pending() == 4 and reassembler.stats().evicted == 6, "at most 4 datagrams" );
+
+    IPv4Reassembler small { { .max_datagrams = 64, .max_bytes = 4000, .timeout_ms = 1000 } };
+    for ( uint16_t id = 0; id < 10; id++ ) {
+      push( small, fragments_of( make_datagram( id, 3000 ), 576 ).front() );
+      check( small.bytes_pending() <= 4000, "at most 4000 bytes" );
+    }
+    check( small.stats().evicted > 0, "byte limit evicts" );
+  }
+}
+
+// A NetworkInterface fragments datagrams longer than its MTU, and a TCP adapter reassembles them
+void check_stack()
+{
+  const EthernetAddress local_eth { 2, 0, 0, 0, 0, 1 };
+  const EthernetAddress remote_eth { 2, 0, 0, 0, 0, 2 };
+  const auto out = make_shared<FramesOut>();
+  NetworkInterface iface { "test", out, local_eth, Address( "10.0.0.1", 0 ) };
+  iface.set_mtu( 576 );
+
+  ARPMessage arp;
+  arp.opcode = ARPMessage::OPCODE_REPLY;
+  arp.sender_ethernet_address = remote_eth;
+  arp.sender_ip_address = Address( "10.0.0.2", 0 ).ipv4_numeric();
+  arp.target_ethernet_address = local_eth;
+  arp.target_ip_address = Address( "10.0.0.1", 0 ).ipv4_numeric();
+  iface.recv_frame( { .header { .dst = local_eth, .src = remote_eth, .type = EthernetHeader::TYPE_ARP },
+                      .payload = serialize( arp ) } );
+
+  TCPOverIPv4Adapter sender;
+  sender.config_mut().source = Address { "10.0.0.1", 9000 };
+  sender.config_mut().destination = Address { "10.0.0.2", 1234 };
+  TCPOverIPv4Adapter receiver;
+  receiver.config_mut().source = sender.config().destination;
+  receiver.config_mut().destination = sender.config().source;
+
+  TCPMessage msg;
+  msg.sender.seqno = Wrap32 { 12345 };
+  msg.sender.payload = string( 1400, 'x' );
+  InternetDatagram dgram = sender.wrap_tcp_in_ip( msg );
+  iface.send_datagram( dgram, Address( "10.0.0.2", 0 ) );
+  check( out->frames.empty(), "a don't-fragment datagram longer than the MTU is dropped" );
+
+  dgram.header.df = false;
+  dgram.header.compute_checksum();
+  iface.send_datagram( dgram, Address( "10.0.0.2", 0 ) );
+  check( out->frames.size() == 3, "1420 bytes of TCP over a 576-byte MTU is three fragments" );
+
+  optional<TCPMessage> received;
+  for ( ; not out->frames.empty(); out->frames.pop() ) {
+    const auto& frame = out->frames.front();
+    check( frame.header.dst == remote_eth and frame.header.type == EthernetHeader::TYPE_IPv4, "IPv4 frame" );
+    check( not received.has_value(), "TCP segment only once the datagram is whole" );
+    received = receiver.unwrap_tcp_in_ip( concatenated( frame.payload ) );
+  }
+  check( received.has_value() and received->sender.seqno == msg.sender.seqno
+           and received->sender.payload == msg.sender.payload,
+         "TCP segment reassembled from fragments" );
+}
+
+int main()
+{
+  try {
+    check_fragment();
+    check_reassembly();
+    check_stack();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,189 @@
+#include "ipv4_fragments.hh"
+#include "parser.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+// Cut datagrams into fragments, and put them back together: in order, interleaved with many other datagrams'
+// in random order, and in storms of fragments that will never complete (or that overlap), which the
+// reassembler has to keep dropping while it still completes the honest datagrams that it can.
+
+template<typename OperationT>
+double speed_test( const string& mode, size_t rounds, OperationT&& operation )
+{
+  const auto start_time = steady_clock::now();
+  for ( size_t i = 0; i < rounds; i++ ) {
+    operation( i );
+  }
+  const auto stop_time = steady_clock::now();
+
+  auto test_duration = duration_cast<duration<double>>( stop_time - start_time );
+  auto millions_per_second = static_cast<double>( rounds ) / test_duration.count() / 1e6;
+
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  cout << "  " << left << setw( 44 ) << mode << right << fixed << setprecision( 2 ) << setw( 8 )
+       << millions_per_second << " million fragments/s\n";
+
+  debug_output << "             " << mode << ": " << fixed << setprecision( 2 ) << millions_per_second
+               << " million fragments/s\n";
+
+  if ( millions_per_second < 0.01 ) {
+    throw runtime_error( mode + " did not meet minimum speed of 0.01 million fragments/s." );
+  }
+
+  return millions_per_second;
+}
+
+InternetDatagram make_datagram( uint32_t src, uint16_t id, size_t payload_length )
+{
+  InternetDatagram dgram;
+  dgram.header.src = src;
+  dgram.header.dst = 0x0a000001;
+  dgram.header.id = id;
+  dgram.header.df = false;
+  dgram.header.len = static_cast<uint16_t>( IPv4Header::LENGTH + payload_length );
+  dgram.header.compute_checksum();
+  dgram.payload.emplace_back( payload_length, 'x' );
+  return dgram;
+}
+
+vector<InternetDatagram> fragments_of( const InternetDatagram& dgram, size_t mtu )
+{
+  vector<InternetDatagram> ret;
+  fragment( dgram, mtu, [&]( const InternetDatagram& piece ) { ret.push_back( piece ); } );
+  return ret;
+}
+
+void program_body()
+{
+  constexpr size_t mtu = 1500;
+  mt19937 rng { 144 }; // NOLINT(*-msc32-c, *-msc51-cpp)
+
+  // fragment: 64 KiB datagrams into 1500-byte fragments
+  {
+    const InternetDatagram big = make_datagram( 0x0b000001, 1, 65000 );
+    size_t fragments = 0;
+    const auto count = [&]( const InternetDatagram& ) { fragments++; };
+    const size_t per_datagram = fragments_of( big, mtu ).size();
+    speed_test( "fragment (64 KiB datagrams, 1500 MTU)", 200'000, [&]( size_t i ) {
+      if ( i % per_datagram == 0 ) {
+        fragment( big, mtu, count );
+      }
+    } );
+    if ( fragments == 0 ) {
+      throw runtime_error( "nothing fragmented" );
+    }
+  }
+
+  // the fragments of 4096 distinct 9000-byte datagrams (seven fragments each)
+  vector<InternetDatagram> honest;
+  for ( uint16_t id = 0; id < 4096; id++ ) {
+    for ( auto& piece : fragments_of( make_datagram( 0x0b000001, id, 9000 ), mtu ) ) {
+      honest.push_back( move( piece ) );
+    }
+  }
+  const size_t honest_datagrams = 4096;
+
+  IPv4Reassembler reassembler;
+  const auto push = [&]( const InternetDatagram& piece ) {
+    Parser payload { piece.payload };
+    return reassembler.push( piece.header, payload ).has_value();
+  };
+
+  // in order: each datagram's fragments one after another
+  {
+    size_t completed = 0;
+    speed_test( "reassemble (in order)", honest.size() * 10, [&]( size_t i ) {
+      completed += push( honest[i % honest.size()] );
+    } );
+    if ( completed != honest_datagrams * 10 ) {
+      throw runtime_error( "in-order datagrams not all reassembled" );
+    }
+  }
+
+  // interleaved: 32 datagrams at a time, their fragments shuffled together
+  {
+    vector<InternetDatagram> interleaved = honest;
+    const size_t window = 32 * honest.size() / honest_datagrams;
+    for ( size_t start = 0; start < interleaved.size(); start += window ) {
+      shuffle( interleaved.begin() + static_cast<ptrdiff_t>( start ),
+               interleaved.begin() + static_cast<ptrdiff_t>( min( start + window, interleaved.size() ) ),
+               rng );
+    }
+    size_t completed = 0;
+    speed_test( "reassemble (32 at a time, shuffled)", interleaved.size() * 10, [&]( size_t i ) {
+      completed += push( interleaved[i % interleaved.size()] );
+    } );
+    if ( completed != honest_datagrams * 10 ) {
+      throw runtime_error( "interleaved datagrams not all reassembled" );
+    }
+  }
+
+  // storms: nine bogus fragments for every honest one
+  const auto storm = [&]( const string& mode, auto&& bogus ) {
+    reassembler = IPv4Reassembler {};
+    size_t completed = 0;
+    size_t max_bytes = 0;
+    const size_t rounds = honest.size() * 10;
+    speed_test( mode, rounds, [&]( size_t i ) {
+      if ( i % 10 == 0 ) {
+        completed += push( honest[i / 10 % honest.size()] );
+      } else {
+        push( bogus( i ) );
+      }
+      max_bytes = max( max_bytes, reassembler.bytes_pending() );
+    } );
+    const auto& stats = reassembler.stats();
+    cout << "    (" << completed << " of " << honest_datagrams << " honest datagrams completed; " << stats.evicted
+         << " evicted, " << stats.malformed << " malformed; at most " << max_bytes / 1024 << " KiB held)\n";
+  };
+
+  // first fragments of datagrams that never complete, from many sources
+  vector<InternetDatagram> never;
+  for ( uint16_t id = 0; id < 1024; id++ ) {
+    never.push_back( fragments_of( make_datagram( 0x0c000000 + id, id, 9000 ), mtu ).front() );
+  }
+  storm( "storm of never-completing fragments", [&]( size_t i ) -> const InternetDatagram& {
+    return never[i % never.size()];
+  } );
+
+  // fragments that overlap their datagram's first fragment (the second of each pair gets it dropped)
+  vector<InternetDatagram> overlapping;
+  for ( uint16_t id = 0; id < 1024; id++ ) {
+    auto pieces = fragments_of( make_datagram( 0x0d000000 + id, id, 9000 ), mtu );
+    overlapping.push_back( pieces[0] );
+    pieces[1].header.offset = static_cast<uint16_t>( pieces[1].header.offset - 1 );
+    pieces[1].header.compute_checksum();
+    overlapping.push_back( pieces[1] );
+  }
+  storm( "storm of overlapping fragments", [&]( size_t i ) -> const InternetDatagram& {
+    return overlapping[i % overlapping.size()];
+  } );
+}
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,90 @@
+#include "common.hh"
+#include "exception.hh"
+#include "loopback_adapter.hh"
+#include "socket_transfer.hh"
+#include "tcp_minnow_socket.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <poll.h>
+#include <string>
+#include <utility>
+
+using namespace std;
+
+bool readable( FileDescriptor& fd )
+{
+  pollfd pfd { fd.fd_num(), POLLIN, 0 };
+  return CheckSystemCall( "poll", ::poll( &pfd, 1, 0 ) ) == 1;
+}
+
+TCPMessage make_message( uint32_t seqno, string payload )
+{
+  TCPMessage msg;
+  msg.sender.seqno = Wrap32 { seqno };
+  msg.sender.payload = move( payload );
+  return msg;
+}
+
+// Messages go across in order, each way, and the wakeup fd is readable exactly while some are waiting
+void check_adapters()
+{
+  auto [a, b] = LoopbackAdapter::make_pair();
+  check( not a.read().has_value() and not b.read().has_value(), "nothing to read at first" );
+
+  a.write( make_message( 1, "one" ) );
+  a.write( make_message( 2, "two" ) );
+  b.write( make_message( 3, "three" ) );
+  const auto first = b.read();
+  check( first.has_value() and first->sender.seqno == Wrap32 { 1 } and first->sender.payload == "one",
+         "b gets a's first message" );
+  const auto second = b.read();
+  check( second.has_value() and second->sender.payload == "two", "then a's second" );
+  check( not b.read().has_value(), "and nothing more" );
+  const auto third = a.read();
+  check( third.has_value() and third->sender.payload == "three", "a gets b's message" );
+
+  // the fd, once asked for, is readable while there are messages (including any sent before it was made)
+  a.write( make_message( 4, "four" ) );
+  FileDescriptor& fd = b.fd();
+  check( readable( fd ), "readable for a message sent before the fd was made" );
+  a.write( make_message( 5, "five" ) );
+  const auto reads_before = fd.read_count();
+  check( b.read().has_value() and readable( fd ), "still readable with a message left" );
+  check( b.read().has_value() and not readable( fd ), "not readable once the queue is empty" );
+  check( fd.read_count() == reads_before + 2, "every message read counts as a read" );
+  check( not b.read().has_value() and fd.read_count() == reads_before + 2, "and nothing else does" );
+  a.write( make_message( 6, "six" ) );
+  check( readable( fd ), "readable again for the next message" );
+}
+
+// A whole connection between two TCPMinnowSockets, with lossy adapters for good measure
+void check_connection()
+{
+  auto [client_side, server_side] = LoopbackAdapter::make_pair();
+  TCPMinnowSocket<LossyFdAdapter<LoopbackAdapter>> client { LossyFdAdapter { move( client_side ) } };
+  TCPMinnowSocket<LossyFdAdapter<LoopbackAdapter>> server { LossyFdAdapter { move( server_side ) } };
+
+  TCPConfig tcp_config;
+  tcp_config.rt_timeout = 10;
+
+  FdAdapterConfig adapter_config;
+  adapter_config.loss_rate_up = adapter_config.loss_rate_dn = 1000; // (out of 65536)
+
+  check_transfer( client, server, tcp_config, 1'000'000, adapter_config );
+}
+
+int main()
+{
+  try {
+    check_adapters();
+    check_connection();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,242 @@
+#include "common.hh"
+#include "loopback_adapter.hh"
+#include "netem_adapter.hh"
+#include "socket_transfer.hh"
+#include "tcp_minnow_socket.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// Keeps every segment passed on to it, with the time it was passed on
+class Recorder
+{
+public:
+  struct Sent
+  {
+    uint64_t ms;
+    uint32_t seqno;
+  };
+
+  vector<Sent> sent {};
+  uint64_t now_ms {};
+
+  void write( const TCPMessage& seg )
+  {
+    sent.push_back( { now_ms, static_cast<uint32_t>( seg.sender.seqno.unwrap( Wrap32 { 0 }, 0 ) ) } );
+  }
+  optional<TCPMessage> read() { return {}; }
+  void tick( size_t ms ) { now_ms += ms; }
+};
+
+TCPMessage make_segment( uint32_t seqno, size_t payload_length = 0 )
+{
+  TCPMessage msg;
+  msg.sender.seqno = Wrap32 { seqno };
+  msg.sender.payload = string( payload_length, 'x' );
+  return msg;
+}
+
+NetemAdapter<Recorder> make_adapter( NetemConfig config )
+{
+  config.seed = config.seed.value_or( 144 );
+  return NetemAdapter<Recorder> { Recorder {}, config };
+}
+
+// Write `count` segments (numbered from 0), one per `interval_ms`, then wait until the link is empty
+vector<Recorder::Sent> run( NetemAdapter<Recorder>& link, size_t count, size_t interval_ms = 0 )
+{
+  Recorder& recorder = link.inner();
+  for ( uint32_t i = 0; i < count; i++ ) {
+    link.write( make_segment( i ) );
+    link.tick( interval_ms );
+  }
+  while ( const auto deadline = link.time_until_deadline() ) {
+    link.tick( deadline.value() );
+  }
+  return recorder.sent;
+}
+
+void check_delay()
+{
+  auto unimpaired = make_adapter( {} );
+  unimpaired.write( make_segment( 0 ) );
+  check( unimpaired.inner().sent.size() == 1 and not unimpaired.time_until_deadline(), "no link, no delay" );
+
+  NetemConfig config;
+  config.delay_ms = 50;
+  auto link = make_adapter( config );
+  link.write( make_segment( 0 ) );
+  check( link.inner().sent.empty() and link.time_until_deadline() == 50, "held for the delay" );
+  link.tick( 49 );
+  check( link.inner().sent.empty() and link.time_until_deadline() == 1, "still held a ms early" );
+  link.tick( 1 );
+  check( link.inner().sent.size() == 1 and not link.time_until_deadline(), "passed on after the delay" );
+
+  // with jitter, each delay is within the bounds, and segments close together can change places
+  config.jitter_ms = 10;
+  auto jittery = make_adapter( config );
+  const auto sent = run( jittery, 1000, 1 );
+  bool reordered = false;
+  for ( size_t i = 0; i < sent.size(); i++ ) {
+    const uint64_t delay = sent[i].ms - sent[i].seqno;
+    check( delay >= 40 and delay <= 60, "jittered delay within bounds" );
+    reordered |= i > 0 and sent[i].seqno < sent[i - 1].seqno;
+  }
+  check( sent.size() == 1000 and reordered, "jitter reorders some segments" );
+
+  // reordering: picked segments skip the delay
+  config.jitter_ms = 0;
+  config.reorder = 0.25;
+  auto reordering = make_adapter( config );
+  const auto reordered_sent = run( reordering, 10'000, 1 );
+  size_t skipped = 0;
+  for ( const auto& x : reordered_sent ) {
+    skipped += x.ms == x.seqno;
+  }
+  check( skipped == reordering.stats().reordered and skipped > 2200 and skipped < 2800,
+         "a quarter of segments skip the delay" );
+}
+
+void check_rate()
+{
+  // at 8 Mbit/s, one byte per microsecond: a segment with a 960-byte payload takes exactly 1 ms
+  NetemConfig config;
+  config.rate_bps = 8'000'000;
+  config.queue_limit = 5;
+  auto link = make_adapter( config );
+  for ( uint32_t i = 0; i < 10; i++ ) {
+    link.write( make_segment( i, 960 ) );
+  }
+  check( link.inner().sent.size() == 1, "the first segment goes out at once (the bucket starts full)" );
+  check( link.queue_occupancy() == 5 and link.stats().queue_drops == 4, "five wait, and the rest are dropped" );
+  check( link.stats().queue_wait_us == 15'000, "for 1 to 5 ms" );
+  for ( uint64_t ms = 1; ms <= 5; ms++ ) {
+    link.tick( 1 );
+    check( link.inner().sent.size() == ms + 1 and link.queue_occupancy() == 5 - ms, "one more each ms" );
+  }
+  check( link.stats().max_queue == 5 and link.segments_held() == 0, "queue drained" );
+
+  // a bucket of three segments lets three go out at once, then one per ms
+  config.burst_bytes = 3000;
+  config.queue_limit = 1000;
+  auto bursty = make_adapter( config );
+  for ( uint32_t i = 0; i < 6; i++ ) {
+    bursty.write( make_segment( i, 960 ) );
+  }
+  check( bursty.inner().sent.size() == 3, "a burst goes out at once" );
+  bursty.tick( 1 );
+  check( bursty.inner().sent.size() == 4, "and then one per ms" );
+  bursty.tick( 1 );
+  check( bursty.inner().sent.size() == 5, "and another" );
+}
+
+void check_loss_and_duplication()
+{
+  constexpr size_t count = 100'000;
+
+  NetemConfig config;
+  config.duplicate = 1;
+  auto duplicating = make_adapter( config );
+  check( run( duplicating, 10 ).size() == 20, "every segment sent twice" );
+
+  config.duplicate = 0;
+  config.loss_good = 0.1;
+  auto lossy = make_adapter( config );
+  const double loss = 1 - static_cast<double>( run( lossy, count ).size() ) / count;
+  check( abs( loss - 0.1 ) < 0.01, "plain loss rate" );
+
+  // Gilbert-Elliott: a loss in the bad state only, which lasts 10 segments on average, and is entered 1% of
+  // the time (so p / (p + r) = 1/11 of segments are lost, in bursts of 10)
+  config.loss_good = 0;
+  config.gilbert_p = 0.01;
+  config.gilbert_r = 0.1;
+  auto bursty = make_adapter( config );
+  const auto sent = run( bursty, count );
+  size_t bursts = 0;
+  for ( size_t i = 1; i < sent.size(); i++ ) {
+    bursts += sent[i].seqno != sent[i - 1].seqno + 1;
+  }
+  const double burst_loss = 1 - static_cast<double>( sent.size() ) / count;
+  const double mean_burst = static_cast<double>( count - sent.size() ) / static_cast<double>( bursts );
+  check( abs( burst_loss - 1.0 / 11 ) < 0.02, "Gilbert-Elliott loss rate" );
+  check( mean_burst > 8 and mean_burst < 12, "Gilbert-Elliott burst length" );
+
+  // the same seed makes the same choices
+  auto again = make_adapter( config );
+  const auto sent_again = run( again, count );
+  check( sent_again.size() == sent.size()
+           and equal( sent.begin(), sent.end(), sent_again.begin(),
+                      []( const auto& a, const auto& b ) { return a.seqno == b.seqno and a.ms == b.ms; } ),
+         "seeded runs are identical" );
+}
+
+// A probability outside [0, 1] is refused
+void check_config()
+{
+  for ( double NetemConfig::*field : { &NetemConfig::reorder,
+                                       &NetemConfig::duplicate,
+                                       &NetemConfig::gilbert_p,
+                                       &NetemConfig::gilbert_r,
+                                       &NetemConfig::loss_good,
+                                       &NetemConfig::loss_bad } ) {
+    for ( const double probability : { -0.1, 1.5, numeric_limits<double>::quiet_NaN() } ) {
+      NetemConfig config;
+      config.*field = probability;
+      bool refused = false;
+      try {
+        make_adapter( config );
+      } catch ( const runtime_error& ) {
+        refused = true;
+      }
+      check( refused, "a probability of " + to_string( probability ) + " is refused" );
+    }
+  }
+}
+
+// A connection between two TCPMinnowSockets, each sending through its own emulated link
+void check_connection()
+{
+  NetemConfig link;
+  link.delay_ms = 5;
+  link.jitter_ms = 2;
+  link.rate_bps = 100'000'000;
+  link.loss_good = 0.01;
+  link.duplicate = 0.01;
+
+  auto [client_side, server_side] = LoopbackAdapter::make_pair();
+  TCPMinnowSocket<NetemAdapter<LoopbackAdapter>> client { NetemAdapter { move( client_side ), link } };
+  TCPMinnowSocket<NetemAdapter<LoopbackAdapter>> server { NetemAdapter { move( server_side ), link } };
+
+  TCPConfig tcp_config;
+  tcp_config.rt_timeout = 50;
+
+  check_transfer( client, server, tcp_config, 200'000 );
+}
+
+int main()
+{
+  try {
+    check_delay();
+    check_rate();
+    check_loss_and_duplication();
+    check_config();
+    check_connection();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -1,8 +1,13 @@
 #pragma once
 
 #include <compare>
+#include <memory>
+#include <numeric>
 #include <optional>
+#include <queue>
+#include <string>
 #include <utility>
+#include <vector>
 
 #include "arp_message.hh"
 #include "common.hh"
@@ -15,6 +20,34 @@ public:
   void transmit( const NetworkInterface& n [[maybe_unused]], const EthernetFrame& x ) override { frames.push( x ); }
 };
 
+inline ARPMessage make_arp( const uint16_t opcode,
+                            const EthernetAddress sender_ethernet_address,
+                            const std::string& sender_ip_address,
+                            const EthernetAddress target_ethernet_address,
+                            const std::string& target_ip_address )
+{
+  ARPMessage arp;
+  arp.opcode = opcode;
+  arp.sender_ethernet_address = sender_ethernet_address;
+  arp.sender_ip_address = Address( sender_ip_address, 0 ).ipv4_numeric();
+  arp.target_ethernet_address = target_ethernet_address;
+  arp.target_ip_address = Address( target_ip_address, 0 ).ipv4_numeric();
+  return arp;
+}
+
+inline EthernetFrame make_frame( const EthernetAddress& src,
+                                 const EthernetAddress& dst,
+                                 const uint16_t type,
+                                 std::vector<std::string> payload )
+{
+  EthernetFrame frame;
+  frame.header.src = src;
+  frame.header.dst = dst;
+  frame.header.type = type;
+  frame.payload = std::move( payload );
+  return frame;
+}
+
 using Output = std::shared_ptr<FramesOut>;
 using InterfaceAndOutput = std::pair<NetworkInterface, Output>;
 
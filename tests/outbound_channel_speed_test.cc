@@ -0,0 +1,126 @@
+#include "loopback_adapter.hh"
+#include "socket_transfer.hh"
+#include "tcp_config.hh"
+#include "tcp_minnow_socket.hh"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/socket.h>
+#include <utility>
+
+using namespace std;
+using namespace std::chrono;
+
+// A bulk transfer between two TCPMinnowSockets over a LoopbackAdapter pair, with the client's bytes reaching its
+// TCPPeer thread either through the socketpair (write, then shutdown) or through the shared outbound ring
+// (write_outbound_all, then close_outbound). Everything else on the path is the same, so the difference is what
+// the ring saves on the way in.
+
+using LoopbackSocket = TCPMinnowSocket<LoopbackAdapter>;
+
+// Send `data` from one TCPMinnowSocket to another, `write_size` bytes per call, returning what the other read
+string transfer( const string& data, size_t write_size, bool use_ring )
+{
+  auto [client_side, server_side] = LoopbackAdapter::make_pair();
+  LoopbackSocket client { move( client_side ) };
+  LoopbackSocket server { move( server_side ) };
+  if ( use_ring ) {
+    client.enable_outbound_ring();
+  }
+
+  string received;
+  run_connection(
+    client,
+    server,
+    socket_pair_tcp_config(),
+    [&]( LoopbackSocket& socket ) { received = read_all( socket ); },
+    [&]( LoopbackSocket& socket ) {
+      for ( size_t i = 0; i < data.size(); ) {
+        const auto piece = string_view { data }.substr( i, write_size );
+        if ( use_ring ) {
+          socket.write_outbound_all( piece );
+          i += piece.size();
+        } else {
+          i += socket.write( piece );
+        }
+      }
+      if ( use_ring ) {
+        socket.close_outbound();
+      } else {
+        socket.shutdown( SHUT_WR );
+      }
+      read_all( socket ); // (until the server has closed its side)
+    } );
+  return received;
+}
+
+double speed_test( const string& data, size_t write_size, bool use_ring )
+{
+  const string mode = use_ring ? "shared ring" : "socketpair";
+  const auto start_time = steady_clock::now();
+  const string received = transfer( data, write_size, use_ring );
+  const auto stop_time = steady_clock::now();
+
+  if ( received != data ) {
+    throw runtime_error( "Mismatch between data written and read over " + mode );
+  }
+
+  auto test_duration = duration_cast<duration<double>>( stop_time - start_time );
+  auto gigabits_per_second = 8 * static_cast<double>( data.size() ) / test_duration.count() / 1e9;
+
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  cout << "TCPMinnowSocket outbound over " << mode << " with write_size=" << write_size << " reached " << fixed
+       << setprecision( 2 ) << gigabits_per_second << " Gbit/s.\n";
+
+  debug_output << "             Outbound " << mode << " throughput: " << fixed << setprecision( 2 )
+               << gigabits_per_second << " Gbit/s\n";
+
+  if ( gigabits_per_second < 0.1 ) {
+    throw runtime_error( "Outbound " + mode + " did not meet minimum speed of 0.1 Gbit/s." );
+  }
+
+  return gigabits_per_second;
+}
+
+void program_body()
+{
+  const string data = [] {
+    default_random_engine rd { 26 };
+    uniform_int_distribution<char> ud;
+    string ret;
+    ret.resize( 5e7 );
+    for ( auto& c : ret ) {
+      c = ud( rd );
+    }
+    return ret;
+  }();
+
+  for ( const size_t write_size : { 1500, 16384 } ) {
+    const double socketpair = speed_test( data, write_size, false );
+    const double ring = speed_test( data, write_size, true );
+    cout << "  shared ring / socketpair = " << fixed << setprecision( 2 ) << ring / socketpair << "x\n";
+  }
+}
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
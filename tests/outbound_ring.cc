@@ -0,0 +1,96 @@
+#include "common.hh"
+#include "loopback_adapter.hh"
+#include "socket_transfer.hh"
+#include "tcp_minnow_socket.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+
+using namespace std;
+
+using LoopbackSocket = TCPMinnowSocket<LoopbackAdapter>;
+
+// The ring's calls need the ring, and the ring has to come before the connection
+void check_misuse()
+{
+  auto [client_side, server_side] = LoopbackAdapter::make_pair();
+  LoopbackSocket socket { move( client_side ) };
+
+  const auto throws = [&]( auto&& call ) {
+    try {
+      call();
+    } catch ( const runtime_error& ) {
+      return true;
+    }
+    return false;
+  };
+  check( throws( [&] { socket.write_outbound( "x" ); } ), "write_outbound without a ring throws" );
+  check( throws( [&] { socket.write_outbound_all( "x" ); } ), "write_outbound_all without a ring throws" );
+  check( throws( [&] { socket.close_outbound(); } ), "close_outbound without a ring throws" );
+}
+
+// Both TCPMinnowSockets send through their rings: the client a few MB in pieces of every size (through a ring
+// much smaller than the stream, so that it fills and wraps around), the server a reply with write_outbound's
+// partial writes. Each side's close_outbound is the other's EOF.
+void check_ring_transfer()
+{
+  auto [client_side, server_side] = LoopbackAdapter::make_pair();
+  LoopbackSocket client { move( client_side ) };
+  LoopbackSocket server { move( server_side ) };
+  client.enable_outbound_ring( 10'000 );
+  server.enable_outbound_ring();
+
+  const string request = random_bytes( 4'000'000 );
+  const string response = random_bytes( 1'000'000 );
+  string received;
+  string reply;
+
+  run_connection(
+    client,
+    server,
+    socket_pair_tcp_config(),
+    [&]( LoopbackSocket& socket ) {
+      received = read_all( socket );
+      for ( string_view rest = response; not rest.empty(); ) {
+        const size_t accepted = socket.write_outbound( rest.substr( 0, 100'000 ) );
+        rest.remove_prefix( accepted );
+        if ( accepted == 0 ) {
+          this_thread::yield();
+        }
+      }
+      socket.close_outbound();
+    },
+    [&]( LoopbackSocket& socket ) {
+      size_t length = 1;
+      for ( string_view rest = request; not rest.empty(); length = length * 3 % 30'011 ) {
+        const auto piece = rest.substr( 0, length );
+        socket.write_outbound_all( piece );
+        rest.remove_prefix( piece.size() );
+      }
+      socket.close_outbound();
+      reply = read_all( socket );
+    } );
+
+  check( received.size() == request.size(), "server received as many bytes as the client sent" );
+  check( received == request, "server received the client's bytes in order" );
+  check( reply == response, "client received the server's bytes in order" );
+}
+
+int main()
+{
+  try {
+    check_misuse();
+    check_ring_transfer();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
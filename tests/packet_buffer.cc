@@ -0,0 +1,152 @@
+#include "alloc_counter.hh"
+#include "exception.hh"
+#include "file_descriptor.hh"
+#include "packet_buffer.hh"
+#include "parser.hh"
+#include "tcp_over_ip.hh"
+
+#include <array>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/socket.h>
+
+using namespace std;
+
+template<typename Func>
+void expect_exception( const string& test_name, Func&& func )
+{
+  try {
+    func();
+  } catch ( const runtime_error& ) {
+    return;
+  }
+  throw runtime_error( test_name + ": expected an exception" );
+}
+
+// Assemble a datagram in a PacketBuffer (payload first, then each header in front of it), and check that it
+// matches the vector-mode serialization byte for byte and that, once warmed up, it allocates nothing.
+void check_datagram( const string& test_name, const TCPMessage& msg )
+{
+  TCPOverIPv4Adapter adapter;
+  adapter.config_mut().source = Address { "169.254.144.9", 9000 };
+  adapter.config_mut().destination = Address { "169.254.144.1", 1234 };
+
+  TCPOverIPv4Adapter reference_adapter;
+  reference_adapter.config_mut() = adapter.config();
+  const string expected = [&] {
+    string ret;
+    for ( const auto& buf : serialize( reference_adapter.wrap_tcp_in_ip( msg ) ) ) {
+      ret += buf;
+    }
+    return ret;
+  }();
+
+  PacketBuffer packet { 65536, 64 };
+  bool all_match = true;
+  const size_t allocations = count_allocations( [&] {
+    packet.clear();
+    packet.append( msg.sender.payload );
+    const auto [ip_header, tcp_header] = adapter.wrap_headers( msg );
+    Serializer tcp_serializer { packet.prepend( 20 ) };
+    tcp_header.serialize( tcp_serializer );
+    Serializer ip_serializer { packet.prepend( IPv4Header::LENGTH ) };
+    ip_header.serialize( ip_serializer );
+    all_match &= packet.contents() == expected;
+  } );
+
+  if ( not all_match ) {
+    throw runtime_error( test_name + ": datagram assembled in place differs from serialize()" );
+  }
+  if ( packet.headroom() != 64 - 40 ) {
+    throw runtime_error( test_name + ": headers were not prepended in the headroom" );
+  }
+  if ( allocations != 0 ) {
+    throw runtime_error( test_name + ": expected no allocations, saw " + to_string( allocations ) );
+  }
+}
+
+void check_write_allocations()
+{
+  array<int, 2> fds {};
+  CheckSystemCall( "socketpair", ::socketpair( AF_UNIX, SOCK_DGRAM, 0, fds.data() ) );
+  FileDescriptor writer { fds[0] };
+  FileDescriptor reader { fds[1] };
+
+  const string headers( 40, 'h' );
+  const string payload( 1000, 'p' );
+  const array<string_view, 2> buffers { headers, payload };
+  array<char, 2048> received {};
+
+  bool sizes_match = true;
+  const size_t allocations = count_allocations( [&] {
+    writer.write( buffers );
+    writer.write( string_view { headers } );
+    without_counting_allocations( [&] {
+      sizes_match &= reader.read( span { received } ) == 1040 and reader.read( span { received } ) == 40;
+    } );
+  } );
+
+  if ( not sizes_match ) {
+    throw runtime_error( "FileDescriptor::write: wrong datagram sizes" );
+  }
+  if ( allocations != 0 ) {
+    throw runtime_error( "FileDescriptor::write: expected no allocations, saw " + to_string( allocations ) );
+  }
+}
+
+int main()
+{
+  try {
+    TCPMessage ack;
+    ack.sender.seqno = Wrap32 { 1000 };
+    ack.receiver.ackno = Wrap32 { 5000 };
+    ack.receiver.window_size = 4096;
+    check_datagram( "pure ACK", ack );
+
+    TCPMessage data = ack;
+    data.sender.payload = string( 1000, 'x' );
+    check_datagram( "1000-byte segment", data );
+
+    check_write_allocations();
+
+    // running out of room is an error, not an overrun
+    PacketBuffer small { 16, 8 };
+    small.append( "12345678" );
+    expect_exception( "append past capacity", [&] { small.append( "9" ); } );
+    small.prepend( 8 );
+    expect_exception( "prepend past headroom", [&] { small.prepend( 1 ); } );
+    if ( small.size() != 16 ) {
+      throw runtime_error( "PacketBuffer: wrong size after filling" );
+    }
+
+    // a copy is a packet of its own
+    PacketBuffer copy = small;
+    copy.clear();
+    copy.append( "x" );
+    if ( small.size() != 16 or copy.contents() != "x" or copy.headroom() != 8 ) {
+      throw runtime_error( "PacketBuffer: copy shares the original's buffer" );
+    }
+    copy = small;
+    if ( copy.contents() != small.contents() or copy.contents().data() == small.contents().data() ) {
+      throw runtime_error( "PacketBuffer: copy assignment didn't copy the packet" );
+    }
+
+    array<char, 3> three {};
+    Serializer span_serializer { span { three } };
+    span_serializer.integer( uint16_t { 0x0102 } );
+    expect_exception( "serialize past end of span", [&] { span_serializer.integer( uint16_t { 0x0304 } ); } );
+    expect_exception( "output() in span mode", [&] { span_serializer.output(); } );
+    if ( span_serializer.bytes_written() != 2 or three[0] != 1 or three[1] != 2 ) {
+      throw runtime_error( "Serializer: span mode wrote the wrong bytes" );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,108 @@
+#include "ipv4_header.hh"
+#include "parser.hh"
+#include "tcp_over_ip.hh"
+#include "tcp_segment.hh"
+
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+// Parse the IPv4 and TCP headers of the same datagram over and over, the way the adapter does for every
+// datagram it reads, and report how many datagrams per second that comes to. (The TCP checksum is skipped,
+// as it is for a device with checksum offload, so that the header parsing dominates.)
+
+string make_datagram( const TCPMessage& msg )
+{
+  TCPOverIPv4Adapter adapter;
+  adapter.config_mut().source = Address { "169.254.144.9", 9000 };
+  adapter.config_mut().destination = Address { "169.254.144.1", 1234 };
+
+  string ret;
+  for ( const auto& buf : serialize( adapter.wrap_tcp_in_ip( msg ) ) ) {
+    ret += buf;
+  }
+  return ret;
+}
+
+template<typename MakeParserT>
+double speed_test( const string& mode, const TCPMessage& expected, MakeParserT&& make_parser )
+{
+  constexpr size_t rounds = 2'000'000;
+  uint64_t sink = 0; // keep the compiler from skipping the work
+
+  const auto start_time = steady_clock::now();
+  for ( size_t i = 0; i < rounds; i++ ) {
+    Parser parser = make_parser();
+    IPv4Header header;
+    header.parse( parser );
+    TCPSegment segment;
+    segment.parse( parser, header.pseudo_checksum(), false );
+    if ( parser.has_error() or segment.message.receiver.ackno != expected.receiver.ackno
+         or segment.message.sender.payload.size() != expected.sender.payload.size() ) {
+      throw runtime_error( mode + ": datagram did not parse" );
+    }
+    sink += header.id + segment.message.receiver.window_size;
+  }
+  const auto stop_time = steady_clock::now();
+
+  auto test_duration = duration_cast<duration<double>>( stop_time - start_time );
+  auto mpps = static_cast<double>( rounds ) / test_duration.count() / 1e6;
+
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  cout << "Parsing " << mode << " reached " << fixed << setprecision( 2 ) << mpps << " million datagrams/s"
+       << ( sink ? "." : "" ) << "\n";
+
+  debug_output << "             Parse " << mode << ": " << fixed << setprecision( 2 ) << mpps << " Mpps\n";
+
+  if ( mpps < 0.1 ) {
+    throw runtime_error( "Parsing " + mode + " did not meet minimum speed of 0.1 million datagrams/s." );
+  }
+
+  return mpps;
+}
+
+void program_body()
+{
+  TCPMessage ack;
+  ack.sender.seqno = Wrap32 { 1000 };
+  ack.receiver.ackno = Wrap32 { 5000 };
+  ack.receiver.window_size = 4096;
+
+  TCPMessage data = ack;
+  data.sender.payload = string( 1000, 'x' );
+
+  for ( const auto& [name, msg] : { pair { "pure ACK", ack }, pair { "1000-byte segment", data } } ) {
+    const string datagram = make_datagram( msg );
+
+    // one buffer, as read from the tun device
+    speed_test( string { name } + " (one buffer)", msg, [&] { return Parser { string_view { datagram } }; } );
+
+    // split so that both headers straddle buffers (every field read goes byte by byte)
+    const vector<string> pieces { datagram.substr( 0, 7 ), datagram.substr( 7, 21 ), datagram.substr( 28 ) };
+    speed_test( string { name } + " (split buffers)", msg, [&] { return Parser { pieces }; } );
+  }
+}
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,91 @@
+#include "ipv4_header.hh"
+#include "parser.hh"
+#include "tcp_over_ip.hh"
+#include "tcp_segment.hh"
+
+#include <array>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+// Is `view` inside `buffer` (i.e. does it alias it rather than a copy)?
+bool aliases( string_view view, string_view buffer )
+{
+  return less_equal<> {}( buffer.data(), view.data() )
+         and less_equal<> {}( view.data() + view.size(), buffer.data() + buffer.size() );
+}
+
+int main()
+{
+  try {
+    TCPOverIPv4Adapter adapter;
+    adapter.config_mut().source = Address { "169.254.144.9", 9000 };
+    adapter.config_mut().destination = Address { "169.254.144.1", 1234 };
+
+    TCPMessage msg;
+    msg.sender.seqno = Wrap32 { 1000 };
+    msg.sender.payload = "a payload that the application should see, split over three buffers";
+    msg.receiver.ackno = Wrap32 { 5000 };
+    msg.receiver.window_size = 4096;
+
+    string datagram;
+    for ( const auto& buf : serialize( adapter.wrap_tcp_in_ip( msg ) ) ) {
+      datagram += buf;
+    }
+
+    // split the datagram in two at every point (every field straddles a boundary at some split), and check
+    // that it parses the same from the views as from one buffer
+    for ( size_t split = 0; split <= datagram.size(); split++ ) {
+      const array<string_view, 2> views { string_view { datagram }.substr( 0, split ),
+                                          string_view { datagram }.substr( split ) };
+      Parser parser { span<const string_view> { views } };
+      IPv4Header header;
+      header.parse( parser );
+      TCPSegment segment;
+      segment.parse( parser, header.pseudo_checksum() );
+      if ( parser.has_error() or segment.message.sender.payload != msg.sender.payload
+           or segment.message.receiver.ackno != msg.receiver.ackno
+           or segment.message.sender.seqno != msg.sender.seqno ) {
+        throw runtime_error( "datagram split at " + to_string( split ) + " did not parse" );
+      }
+    }
+
+    // the payload as views: they alias the input buffers, and concatenate to the payload
+    const array<string_view, 3> views { string_view { datagram }.substr( 0, 50 ),
+                                        string_view { datagram }.substr( 50, 20 ),
+                                        string_view { datagram }.substr( 70 ) };
+    Parser parser { span<const string_view> { views } };
+    IPv4Header header;
+    header.parse( parser );
+    parser.remove_prefix( 20 ); // TCP header
+    vector<string_view> payload;
+    parser.all_remaining( payload );
+
+    string joined;
+    for ( const auto view : payload ) {
+      if ( not aliases( view, datagram ) ) {
+        throw runtime_error( "all_remaining returned a view that doesn't alias the input" );
+      }
+      joined += view;
+    }
+    if ( parser.has_error() or payload.size() != 3 or joined != msg.sender.payload ) {
+      throw runtime_error( "all_remaining returned the wrong views" );
+    }
+    if ( parser.input().size() != 0 ) {
+      throw runtime_error( "all_remaining did not consume the input" );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,207 @@
+#include "common.hh"
+#include "random.hh"
+#include "shared_route_table.hh"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+uint32_t mask( uint8_t length )
+{
+  return length == 0 ? 0 : ~uint32_t {} << ( 32 - length );
+}
+
+using Reference = map<pair<uint32_t, uint8_t>, uint32_t>; // (masked prefix, length) => value
+
+optional<uint32_t> reference_lookup( const Reference& reference, uint32_t address )
+{
+  optional<uint32_t> best;
+  int best_length = -1;
+  for ( const auto& [prefix, value] : reference ) {
+    if ( ( address & mask( prefix.second ) ) == prefix.first and prefix.second > best_length ) {
+      best = value;
+      best_length = prefix.second;
+    }
+  }
+  return best;
+}
+
+// Add and remove random prefixes (overlapping at every level, removed in any order), and after every batch of
+// changes compare a snapshot with a linear scan of the prefixes that are left
+void check_against_reference()
+{
+  auto rng = get_random_engine();
+  uniform_int_distribution<uint32_t> random_u32;
+  uniform_int_distribution<int> random_length { 0, 32 };
+
+  SharedRouteTable table { 1 };
+  Reference reference;
+
+  for ( uint32_t step = 0; step < 1500; step++ ) {
+    if ( random_u32( rng ) % 5 < 3 or reference.empty() ) {
+      const auto length = static_cast<uint8_t>( random_length( rng ) );
+      const uint32_t prefix = ( random_u32( rng ) % 4 ) << 24 | ( random_u32( rng ) & 0x00ffffff );
+      table.insert( prefix, length, step );
+      reference[{ prefix & mask( length ), length }] = step;
+    } else {
+      auto victim = reference.begin();
+      advance( victim, random_u32( rng ) % reference.size() );
+      const auto [prefix, length] = victim->first;
+      reference.erase( victim );
+      check( table.remove( prefix | ( random_u32( rng ) & ~mask( length ) ), length ), "removed a prefix" );
+      check( not table.remove( prefix, length ), "a prefix can't be removed twice" );
+    }
+
+    if ( step % 100 == 99 ) {
+      table.publish();
+      const auto snapshot = table.read( 0 );
+      for ( int i = 0; i < 200; i++ ) {
+        const uint32_t address = ( random_u32( rng ) % 5 ) << 24 | ( random_u32( rng ) & 0x00ffffff );
+        check( snapshot.lookup( address ) == reference_lookup( reference, address ),
+               "snapshot matches a linear scan after adds and removes" );
+      }
+      for ( const auto& [prefix, value] : reference ) {
+        for ( const uint32_t address : { prefix.first, prefix.first | ~mask( prefix.second ) } ) {
+          check( snapshot.lookup( address ) == reference_lookup( reference, address ),
+                 "snapshot matches a linear scan at edges" );
+        }
+      }
+    }
+  }
+
+  table.reclaim();
+  check( table.retired_count() == 0, "every retired table freed once no reader has a snapshot" );
+}
+
+// Readers look up addresses as fast as they can while the writer churns pairs of prefixes: each publish adds or
+// removes both prefixes of a few pairs, so in any one snapshot a pair's two addresses must both find their pair's
+// prefixes, or both find what the permanent routes give them.
+void check_concurrent_churn()
+{
+  constexpr size_t reader_count = 3;
+  constexpr size_t pair_count = 64;
+  constexpr uint32_t churn_value = 1'000'000;
+  constexpr uint64_t lookups_per_reader = 100'000;
+
+  auto rng = get_random_engine();
+  uniform_int_distribution<uint32_t> random_u32;
+
+  SharedRouteTable table { reader_count };
+
+  // permanent routes, all shorter than the churned prefixes (so they never hide them)
+  Reference permanent;
+  table.insert( 0, 0, 0 );
+  permanent[{ 0, 0 }] = 0;
+  for ( uint32_t value = 1; value < 200; value++ ) {
+    const auto length = static_cast<uint8_t>( 1 + random_u32( rng ) % 15 );
+    const uint32_t prefix = ( 10 + random_u32( rng ) % 2 ) << 24 | ( random_u32( rng ) & 0x00ffffff );
+    table.insert( prefix, length, value );
+    permanent[{ prefix & mask( length ), length }] = value;
+  }
+
+  // the pairs: pair k has a prefix of 16 to 32 bits in 10.k.0.0/16 and one in 11.k.0.0/16, and an address in each
+  struct Churned
+  {
+    uint32_t prefix;
+    uint8_t length;
+    uint32_t address;
+    uint32_t value;
+    optional<uint32_t> without;
+  };
+  vector<array<Churned, 2>> pairs;
+  for ( uint32_t k = 0; k < pair_count; k++ ) {
+    array<Churned, 2> both {};
+    for ( uint32_t side = 0; side < 2; side++ ) {
+      auto& churned = both.at( side );
+      churned.length = static_cast<uint8_t>( 16 + random_u32( rng ) % 17 );
+      churned.prefix = ( 10 + side ) << 24 | k << 16 | ( random_u32( rng ) & 0xffff );
+      churned.address
+        = ( churned.prefix & mask( churned.length ) ) | ( random_u32( rng ) & ~mask( churned.length ) );
+      churned.value = churn_value + 2 * k + side;
+      churned.without = reference_lookup( permanent, churned.address );
+    }
+    pairs.push_back( both );
+  }
+  table.publish();
+
+  atomic<size_t> readers_done { 0 };
+  atomic<uint64_t> inconsistent { 0 };
+  array<atomic<uint64_t>, 2> seen { 0, 0 }; // lookups that found a pair without, and with, its prefixes
+
+  vector<thread> readers;
+  for ( size_t reader = 0; reader < reader_count; reader++ ) {
+    readers.emplace_back( [&, reader] {
+      uint64_t state = reader + 1;
+      for ( uint64_t i = 0; i < lookups_per_reader; i++ ) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL; // LCG
+        const auto& [first, second] = pairs[( state >> 33 ) % pairs.size()];
+
+        const auto snapshot = table.read( reader );
+        const auto found_first = snapshot.lookup( first.address );
+        const auto found_second = snapshot.lookup( second.address );
+        if ( found_first == first.value and found_second == second.value ) {
+          seen[1]++;
+        } else if ( found_first == first.without and found_second == second.without ) {
+          seen[0]++;
+        } else {
+          inconsistent++;
+        }
+        if ( i % 1000 == 0 ) {
+          this_thread::yield(); // (let the writer publish, even on one CPU)
+        }
+      }
+      readers_done++;
+    } );
+  }
+
+  vector<bool> present( pair_count );
+  while ( readers_done < reader_count ) {
+    for ( int change = 0; change < 4; change++ ) {
+      const size_t k = random_u32( rng ) % pair_count;
+      for ( const auto& churned : pairs[k] ) {
+        if ( present[k] ) {
+          check( table.remove( churned.prefix, churned.length ), "removed a churned prefix" );
+        } else {
+          table.insert( churned.prefix, churned.length, churned.value );
+        }
+      }
+      present[k] = not present[k];
+    }
+    table.publish();
+  }
+
+  for ( auto& reader : readers ) {
+    reader.join();
+  }
+
+  check( inconsistent == 0, to_string( inconsistent ) + " lookups saw half a publish, or a freed table" );
+  check( seen[0] > 0 and seen[1] > 0, "readers saw pairs both with and without their prefixes" );
+  table.reclaim();
+  check( table.retired_count() == 0, "every retired table freed once the readers are done" );
+}
+
+int main()
+{
+  try {
+    check_against_reference();
+    check_concurrent_churn();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
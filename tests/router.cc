@@ -0,0 +1,236 @@
+#include "arp_message.hh"
+#include "network_interface.hh"
+#include "network_interface_test_harness.hh"
+#include "parser.hh"
+#include "random.hh"
+#include "route_table.hh"
+#include "router.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+uint32_t ip( const string& address )
+{
+  return Address( address, 0 ).ipv4_numeric();
+}
+
+// Compare the RouteTable with a linear scan of every prefix, for random prefixes inserted in random order
+// (overlapping at every level of the table, and some more than once) and random addresses
+void check_route_table()
+{
+  auto rng = get_random_engine();
+  uniform_int_distribution<uint32_t> random_u32;
+  uniform_int_distribution<int> random_length { 0, 32 };
+
+  RouteTable table;
+  map<pair<uint32_t, uint8_t>, uint32_t> reference; // (masked prefix, length) => value
+  vector<uint32_t> interesting_addresses;
+
+  const auto mask = []( uint8_t length ) { return length == 0 ? 0 : ~uint32_t {} << ( 32 - length ); };
+  const auto reference_lookup = [&]( uint32_t address ) -> optional<uint32_t> {
+    optional<uint32_t> best;
+    int best_length = -1;
+    for ( const auto& [prefix, value] : reference ) {
+      if ( ( address & mask( prefix.second ) ) == prefix.first and prefix.second > best_length ) {
+        best = value;
+        best_length = prefix.second;
+      }
+    }
+    return best;
+  };
+
+  for ( uint32_t value = 0; value < 2000; value++ ) {
+    // cluster the prefixes under a few /8s, so that they overlap
+    auto length = static_cast<uint8_t>( random_length( rng ) );
+    uint32_t prefix = ( random_u32( rng ) % 4 ) << 24 | ( random_u32( rng ) & 0x00ffffff );
+    if ( value % 10 == 9 and not reference.empty() ) {
+      // the same prefix again, with a new value
+      const auto& again = reference.begin()->first;
+      prefix = again.first;
+      length = again.second;
+    }
+    table.insert( prefix, length, value );
+    reference[{ prefix & mask( length ), length }] = value;
+    interesting_addresses.push_back( prefix );
+    interesting_addresses.push_back( prefix | ~mask( length ) );
+
+    if ( value % 100 == 0 ) {
+      for ( int i = 0; i < 100; i++ ) {
+        const uint32_t address = ( random_u32( rng ) % 5 ) << 24 | ( random_u32( rng ) & 0x00ffffff );
+        check( table.lookup( address ) == reference_lookup( address ), "RouteTable matches a linear scan" );
+      }
+    }
+  }
+
+  for ( const auto address : interesting_addresses ) {
+    check( table.lookup( address ) == reference_lookup( address ), "RouteTable matches a linear scan at edges" );
+  }
+
+  // a batch lookup (of more addresses than it takes at a time) finds what one-at-a-time lookups do
+  vector<optional<uint32_t>> results( interesting_addresses.size() );
+  table.lookup_batch( interesting_addresses, results );
+  for ( size_t i = 0; i < interesting_addresses.size(); i++ ) {
+    check( results[i] == table.lookup( interesting_addresses[i] ), "batch lookup matches one-at-a-time lookup" );
+  }
+}
+
+struct Host
+{
+  string ip;
+  EthernetAddress eth;
+};
+
+EthernetFrame arp_reply( const Host& from, const EthernetAddress& to_eth, const string& to_ip )
+{
+  ARPMessage arp;
+  arp.opcode = ARPMessage::OPCODE_REPLY;
+  arp.sender_ethernet_address = from.eth;
+  arp.sender_ip_address = ip( from.ip );
+  arp.target_ethernet_address = to_eth;
+  arp.target_ip_address = ip( to_ip );
+  return { .header { .dst = to_eth, .src = from.eth, .type = EthernetHeader::TYPE_ARP },
+           .payload = serialize( arp ) };
+}
+
+InternetDatagram make_datagram( const string& src, const string& dst, uint8_t ttl )
+{
+  InternetDatagram dgram;
+  dgram.header.src = ip( src );
+  dgram.header.dst = ip( dst );
+  dgram.header.ttl = ttl;
+  dgram.payload.emplace_back( "payload" );
+  dgram.header.len = IPv4Header::LENGTH + dgram.payload.front().size();
+  dgram.header.compute_checksum();
+  return dgram;
+}
+
+void check_router()
+{
+  // three interfaces, each with a neighbor it has already learned the Ethernet address of
+  const vector<Host> ifaces { { "10.0.0.1", { 2, 0, 0, 0, 0, 1 } },
+                              { "192.168.1.1", { 2, 0, 0, 0, 1, 1 } },
+                              { "172.16.0.1", { 2, 0, 0, 0, 2, 1 } } };
+  const Host gateway { "10.0.0.2", { 2, 0, 0, 0, 0, 2 } };
+  const Host lan_host { "192.168.1.7", { 2, 0, 0, 0, 1, 7 } };
+  const Host odd_host { "172.16.5.9", { 2, 0, 0, 0, 1, 9 } };
+  const Host campus_router { "172.16.0.2", { 2, 0, 0, 0, 2, 2 } };
+
+  Router router;
+  vector<shared_ptr<FramesOut>> ports;
+  for ( const auto& iface : ifaces ) {
+    ports.push_back( make_shared<FramesOut>() );
+    router.add_interface( make_shared<NetworkInterface>( iface.ip, ports.back(), iface.eth, Address( iface.ip ) ) );
+  }
+  router.interface( 0 )->recv_frame( arp_reply( gateway, ifaces[0].eth, ifaces[0].ip ) );
+  router.interface( 1 )->recv_frame( arp_reply( lan_host, ifaces[1].eth, ifaces[1].ip ) );
+  router.interface( 1 )->recv_frame( arp_reply( odd_host, ifaces[1].eth, ifaces[1].ip ) );
+  router.interface( 2 )->recv_frame( arp_reply( campus_router, ifaces[2].eth, ifaces[2].ip ) );
+
+  router.add_route( ip( "0.0.0.0" ), 0, Address( gateway.ip ), 0 );
+  router.add_route( ip( "192.168.1.0" ), 24, {}, 1 );
+  router.add_route( ip( "172.16.0.0" ), 12, Address( campus_router.ip ), 2 );
+  router.add_route( ip( "172.16.5.0" ), 24, {}, 1 ); // more specific than the /12, and on another interface
+
+  // send a datagram into the router on interface `in`, and check where it comes out (if anywhere)
+  const auto expect_route = [&]( size_t in, const InternetDatagram& dgram, optional<pair<size_t, Host>> out ) {
+    router.interface( in )->recv_frame(
+      { .header { .dst = ifaces.at( in ).eth, .src = { 2, 9, 9, 9, 9, 9 }, .type = EthernetHeader::TYPE_IPv4 },
+        .payload = serialize( dgram ) } );
+    router.route();
+
+    for ( size_t i = 0; i < ports.size(); i++ ) {
+      auto& frames = ports.at( i )->frames;
+      if ( not out.has_value() or out->first != i ) {
+        check( frames.empty(), "no frame on interface " + to_string( i ) );
+        continue;
+      }
+      check( frames.size() == 1, "one frame on interface " + to_string( i ) );
+      const EthernetFrame frame = frames.front();
+      frames.pop();
+      check( frame.header.dst == out->second.eth and frame.header.type == EthernetHeader::TYPE_IPv4,
+             "frame addressed to " + out->second.ip );
+
+      InternetDatagram forwarded;
+      check( parse( forwarded, frame.payload ), "forwarded datagram parses" );
+      check( forwarded.header.ttl == dgram.header.ttl - 1, "TTL decremented" );
+      IPv4Header recomputed = forwarded.header;
+      recomputed.compute_checksum();
+      check( forwarded.header.cksum == recomputed.cksum, "checksum updated" );
+      check( forwarded.header.dst == dgram.header.dst and forwarded.payload == dgram.payload, "datagram intact" );
+    }
+  };
+
+  expect_route( 1, make_datagram( "192.168.1.7", "8.8.8.8", 64 ), pair { 0, gateway } );
+  expect_route( 0, make_datagram( "8.8.8.8", "192.168.1.7", 64 ), pair { 1, lan_host } );
+  expect_route( 0, make_datagram( "8.8.8.8", "172.16.200.1", 64 ), pair { 2, campus_router } );
+  expect_route( 0, make_datagram( "8.8.8.8", "172.16.5.9", 64 ), pair { 1, odd_host } );
+  expect_route( 0, make_datagram( "8.8.8.8", "192.168.1.7", 2 ), pair { 1, lan_host } );
+  expect_route( 0, make_datagram( "8.8.8.8", "192.168.1.7", 1 ), nullopt ); // TTL would reach zero
+  expect_route( 0, make_datagram( "8.8.8.8", "192.168.1.7", 0 ), nullopt );
+
+  // many datagrams at once, on every interface: each goes out where it would have alone, in the order it came
+  const vector<pair<string, size_t>> destinations {
+    { "8.8.8.8", 0 }, { "192.168.1.7", 1 }, { "172.16.200.1", 2 }, { "172.16.5.9", 1 } };
+  for ( size_t in = 0; in < ifaces.size(); in++ ) {
+    for ( uint16_t id = 0; id < 3 * Router::ROUTE_BATCH + 5; id++ ) {
+      InternetDatagram dgram = make_datagram( "1.2.3.4", destinations[id % destinations.size()].first, 64 );
+      dgram.header.id = static_cast<uint16_t>( in << 8 | id );
+      dgram.header.ttl = id % 7 == 0 ? 1 : 64; // and some of them are dropped
+      dgram.header.compute_checksum();
+      router.interface( in )->datagrams_received().push( dgram );
+    }
+  }
+  router.route();
+  for ( size_t out = 0; out < ports.size(); out++ ) {
+    vector<uint16_t> expected;
+    for ( size_t in = 0; in < ifaces.size(); in++ ) {
+      for ( uint16_t id = 0; id < 3 * Router::ROUTE_BATCH + 5; id++ ) {
+        if ( id % 7 != 0 and destinations[id % destinations.size()].second == out ) {
+          expected.push_back( static_cast<uint16_t>( in << 8 | id ) );
+        }
+      }
+    }
+    vector<uint16_t> sent;
+    for ( auto& frames = ports.at( out )->frames; not frames.empty(); frames.pop() ) {
+      InternetDatagram forwarded;
+      check( parse( forwarded, frames.front().payload ), "forwarded datagram parses" );
+      sent.push_back( forwarded.header.id );
+    }
+    check( sent == expected, "batch of datagrams routed in order on interface " + to_string( out ) );
+  }
+
+  // without a default route, an unmatched destination is dropped
+  Router no_default;
+  const auto port = make_shared<FramesOut>();
+  no_default.add_interface( make_shared<NetworkInterface>( "eth0", port, ifaces[0].eth, Address( ifaces[0].ip ) ) );
+  no_default.add_route( ip( "10.0.0.0" ), 8, {}, 0 );
+  no_default.interface( 0 )->recv_frame(
+    { .header { .dst = ifaces[0].eth, .src = gateway.eth, .type = EthernetHeader::TYPE_IPv4 },
+      .payload = serialize( make_datagram( "10.0.0.2", "11.0.0.1", 64 ) ) } );
+  no_default.route();
+  check( port->frames.empty(), "datagram without a route dropped" );
+}
+
+int main()
+{
+  try {
+    check_route_table();
+    check_router();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
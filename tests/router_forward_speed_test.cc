@@ -0,0 +1,149 @@
+#include "arp_message.hh"
+#include "network_interface.hh"
+#include "parser.hh"
+#include "router.hh"
+
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+// Forward datagrams through a Router with eight interfaces, each with a neighbor it has learned the Ethernet
+// address of, and a hundred thousand random routes spread over them (plus a default route). Every round, each
+// interface receives a burst of datagrams to random destinations, and one call to route() forwards them all.
+
+class CountingPort : public NetworkInterface::OutputPort
+{
+public:
+  uint64_t frames {};
+  void transmit( const NetworkInterface& n [[maybe_unused]], const EthernetFrame& x [[maybe_unused]] ) override
+  {
+    frames++;
+  }
+  void transmit_serialized( const NetworkInterface& n [[maybe_unused]],
+                            span<const string_view> frame [[maybe_unused]] ) override
+  {
+    frames++;
+  }
+};
+
+void speed_test( const string& mode, uint64_t datagrams, const steady_clock::duration& elapsed )
+{
+  auto test_duration = duration_cast<duration<double>>( elapsed );
+  auto millions_per_second = static_cast<double>( datagrams ) / test_duration.count() / 1e6;
+
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  cout << "  " << left << setw( 40 ) << mode << right << fixed << setprecision( 2 ) << setw( 8 )
+       << millions_per_second << " million datagrams/s\n";
+
+  debug_output << "             " << mode << ": " << fixed << setprecision( 2 ) << millions_per_second
+               << " million datagrams/s\n";
+
+  if ( millions_per_second < 0.01 ) {
+    throw runtime_error( mode + " did not meet minimum speed of 0.01 million datagrams/s." );
+  }
+}
+
+void benchmark( size_t burst )
+{
+  constexpr size_t interface_count = 8;
+  constexpr size_t route_count = 100'000;
+  constexpr uint64_t datagram_count = 4'000'000;
+
+  mt19937 rng { 144 }; // NOLINT(*-msc32-c, *-msc51-cpp)
+  uniform_int_distribution<uint32_t> random_u32;
+  uniform_int_distribution<int> random_length { 12, 24 };
+
+  Router router;
+  const auto port = make_shared<CountingPort>();
+  for ( size_t i = 0; i < interface_count; i++ ) {
+    const EthernetAddress local_eth { 2, 0, 0, 0, static_cast<uint8_t>( i ), 1 };
+    const uint32_t local_ip = 0x0a000001 | static_cast<uint32_t>( i ) << 8; // 10.0.i.1
+    router.add_interface( make_shared<NetworkInterface>(
+      "eth" + to_string( i ), port, local_eth, Address::from_ipv4_numeric( local_ip ) ) );
+
+    // learn the neighbor (10.0.i.2) from an ARP reply
+    ARPMessage arp;
+    arp.opcode = ARPMessage::OPCODE_REPLY;
+    arp.sender_ethernet_address = { 2, 0, 0, 0, static_cast<uint8_t>( i ), 2 };
+    arp.sender_ip_address = local_ip + 1;
+    arp.target_ethernet_address = local_eth;
+    arp.target_ip_address = local_ip;
+    router.interface( i )->recv_frame(
+      { .header { .dst = local_eth, .src = arp.sender_ethernet_address, .type = EthernetHeader::TYPE_ARP },
+        .payload = serialize( arp ) } );
+  }
+
+  const auto neighbor = [&]( size_t i ) { return Address::from_ipv4_numeric( 0x0a000002 | i << 8 ); };
+  router.add_route( 0, 0, neighbor( 0 ), 0 );
+  for ( size_t i = 0; i < route_count; i++ ) {
+    const size_t interface_num = random_u32( rng ) % interface_count;
+    router.add_route(
+      random_u32( rng ), static_cast<uint8_t>( random_length( rng ) ), neighbor( interface_num ), interface_num );
+  }
+
+  // a pool of datagrams (headers only) to random destinations, to copy from
+  vector<InternetDatagram> pool( 4096 );
+  for ( auto& dgram : pool ) {
+    dgram.header.src = 0x0b000001;
+    dgram.header.dst = random_u32( rng );
+    dgram.header.len = IPv4Header::LENGTH;
+    dgram.header.compute_checksum();
+  }
+
+  const uint64_t frames_before = port->frames;
+  steady_clock::duration elapsed {};
+  size_t next = 0;
+  for ( uint64_t sent = 0; sent < datagram_count; sent += burst * interface_count ) {
+    for ( size_t i = 0; i < interface_count; i++ ) {
+      auto& received = router.interface( i )->datagrams_received();
+      for ( size_t j = 0; j < burst; j++ ) {
+        received.push( pool[next++ % pool.size()] );
+      }
+    }
+    const auto start_time = steady_clock::now();
+    router.route();
+    elapsed += steady_clock::now() - start_time;
+  }
+
+  if ( port->frames - frames_before < datagram_count ) {
+    throw runtime_error( "not every datagram was forwarded" );
+  }
+
+  speed_test( "route() (" + to_string( interface_count ) + " interfaces, bursts of " + to_string( burst ) + ")",
+              port->frames - frames_before,
+              elapsed );
+}
+
+void program_body()
+{
+  for ( const size_t burst : { 1, 32, 256 } ) {
+    benchmark( burst );
+  }
+}
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
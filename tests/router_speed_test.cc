@@ -0,0 +1,116 @@
+#include "route_table.hh"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+// Build a RouteTable with a million random prefixes (with lengths distributed roughly like a full BGP table's:
+// mostly /24s, then /22s and /23s, a few shorter, and a few longer than /24), then look up random addresses:
+// independent lookups (throughput), the same in batches (in which each level's loads are prefetched together),
+// and a chain of lookups that each depend on the previous one (latency).
+
+template<typename OperationT>
+double speed_test( const string& mode, size_t rounds, OperationT&& operation )
+{
+  uint64_t sink = 0; // keep the compiler from skipping the work
+
+  const auto start_time = steady_clock::now();
+  for ( size_t i = 0; i < rounds; i++ ) {
+    sink += operation( i, sink );
+  }
+  const auto stop_time = steady_clock::now();
+
+  auto test_duration = duration_cast<duration<double>>( stop_time - start_time );
+  auto millions_per_second = static_cast<double>( rounds ) / test_duration.count() / 1e6;
+
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  cout << "  " << left << setw( 36 ) << mode << right << fixed << setprecision( 2 ) << setw( 8 )
+       << millions_per_second << " million/s" << ( sink ? "" : " " ) << "\n";
+
+  debug_output << "             " << mode << ": " << fixed << setprecision( 2 ) << millions_per_second
+               << " million/s\n";
+
+  if ( millions_per_second < 0.1 ) {
+    throw runtime_error( mode + " did not meet minimum speed of 0.1 million/s." );
+  }
+
+  return millions_per_second;
+}
+
+void program_body()
+{
+  constexpr size_t prefix_count = 1'000'000;
+  constexpr size_t lookups = 10'000'000;
+
+  mt19937 rng { 144 }; // NOLINT(*-msc32-c, *-msc51-cpp)
+  // weights for prefix lengths 8 through 32
+  const array<double, 25> length_weights {
+    0.1, 0.1, 0.1, 0.1, 0.2, 0.2, 0.3, 0.4, 2, 1.5, 2, 3, 5, 5, 12, 8, 58, 0.5, 0.5, 0.3, 0.3, 0.2, 0.2, 0.1, 0.3 };
+  discrete_distribution<int> random_length { length_weights.begin(), length_weights.end() };
+  uniform_int_distribution<uint32_t> random_u32;
+
+  vector<pair<uint32_t, uint8_t>> prefixes;
+  prefixes.reserve( prefix_count );
+  for ( size_t i = 0; i < prefix_count; i++ ) {
+    prefixes.emplace_back( random_u32( rng ), static_cast<uint8_t>( 8 + random_length( rng ) ) );
+  }
+
+  vector<uint32_t> addresses;
+  addresses.reserve( lookups );
+  for ( size_t i = 0; i < lookups; i++ ) {
+    addresses.push_back( random_u32( rng ) );
+  }
+
+  RouteTable table;
+  table.insert( 0, 0, 0 ); // a default route, so that every lookup finds something
+  speed_test( "insert (1M prefixes)", prefix_count, [&]( size_t i, uint64_t ) {
+    table.insert( prefixes[i].first, prefixes[i].second, static_cast<uint32_t>( i + 1 ) );
+    return 1;
+  } );
+  cout << "  (" << table.group_count() << " groups of 256 entries below the top level, "
+       << table.group_count() / 1024 << " MiB)\n";
+
+  speed_test( "lookup (random addresses)", lookups, [&]( size_t i, uint64_t ) {
+    return table.lookup( addresses[i] ).value();
+  } );
+
+  vector<optional<uint32_t>> results( 64 );
+  speed_test( "lookup_batch (random, 64 at a time)", lookups, [&]( size_t i, uint64_t ) {
+    if ( i % 64 == 0 ) {
+      table.lookup_batch( span { addresses }.subspan( i, 64 ), results );
+    }
+    return results[i % 64].value();
+  } );
+
+  speed_test( "lookup (each after the previous)", lookups, [&]( size_t i, uint64_t sink ) {
+    return table.lookup( addresses[i] ^ static_cast<uint32_t>( sink & 1 ) ).value();
+  } );
+}
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,112 @@
+#include "alloc_counter.hh"
+#include "packet_buffer.hh"
+#include "parser.hh"
+#include "tcp_config.hh"
+#include "tcp_over_ip.hh"
+#include "tcp_peer.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// The send path as TCPMinnowSocket runs it: the TCPPeer's segments are copied into kept slots of a batch, then
+// each one's headers are serialized into a PacketBuffer (as the TUN adapter does). Once warmed up, sending
+// data, receiving ACKs, and ticking should allocate nothing.
+int main()
+{
+  try {
+    TCPOverIPv4Adapter adapter;
+    adapter.config_mut().source = Address { "169.254.144.9", 9000 };
+    adapter.config_mut().destination = Address { "169.254.144.1", 1234 };
+    PacketBuffer headers { 40, 40 };
+
+    vector<TCPMessage> batch;
+    size_t batch_size = 0;
+    const auto send_to_batch = [&]( const TCPMessage& msg ) {
+      if ( batch_size < batch.size() ) {
+        batch[batch_size] = msg;
+      } else {
+        batch.push_back( msg );
+      }
+      batch_size++;
+    };
+    uint64_t wire_bytes = 0;
+    const auto flush = [&] {
+      for ( size_t i = 0; i < batch_size; i++ ) {
+        const auto [ip_header, tcp_header] = adapter.wrap_headers( batch[i] );
+        headers.clear();
+        Serializer tcp_serializer { headers.prepend( 20 ) };
+        tcp_header.serialize( tcp_serializer );
+        Serializer ip_serializer { headers.prepend( IPv4Header::LENGTH ) };
+        ip_header.serialize( ip_serializer );
+        wire_bytes += headers.size() + batch[i].sender.payload.size();
+      }
+    };
+
+    TCPConfig server_config;
+    server_config.recv_capacity = 2 * server_config.send_capacity;
+    TCPPeer client { TCPConfig {} };
+    TCPPeer server { server_config };
+    vector<TCPMessage> acks;
+    const auto send_to_client = [&]( const TCPMessage& msg ) { acks.push_back( msg ); };
+
+    // the server gets the client's segments (and replies) outside the counted section
+    const auto deliver_to_server = [&] {
+      for ( size_t i = 0; i < batch_size; i++ ) {
+        server.receive( batch[i], send_to_client );
+        server.inbound_reader().pop( server.inbound_reader().bytes_buffered() );
+      }
+      batch_size = 0;
+    };
+
+    client.push( send_to_batch );
+    flush();
+    deliver_to_server();
+    client.receive( acks.front(), send_to_batch );
+    acks.clear();
+    flush();
+    deliver_to_server();
+
+    const string data( TCPConfig::DEFAULT_CAPACITY, 'x' );
+    constexpr size_t rounds = 20;
+    const size_t allocations = count_allocations(
+      [&] {
+        without_counting_allocations( [&] { client.outbound_writer().push( data ); } );
+        client.push( send_to_batch );
+        flush();
+        without_counting_allocations( deliver_to_server );
+
+        for ( auto& ack : acks ) {
+          client.receive( move( ack ), send_to_batch );
+        }
+        client.tick( 1, send_to_batch );
+        flush();
+        without_counting_allocations( [&] {
+          acks.clear();
+          deliver_to_server();
+        } );
+      },
+      rounds );
+
+    if ( server.inbound_reader().bytes_popped() != rounds * 2 * data.size()
+         or client.sender().sequence_numbers_in_flight() != 0 ) {
+      throw runtime_error( "the stream was not delivered" );
+    }
+    if ( wire_bytes == 0 ) {
+      throw runtime_error( "nothing was sent" );
+    }
+    if ( allocations != 0 ) {
+      throw runtime_error( "expected no allocations on the send path, saw " + to_string( allocations ) );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
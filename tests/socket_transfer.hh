@@ -0,0 +1,118 @@
+#pragma once
+
+#include "common.hh"
+#include "random.hh"
+#include "tcp_config.hh"
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <sys/socket.h>
+#include <thread>
+
+// A TCPConfig for two sockets in one process. A closed window costs the sender a retransmission timeout (the
+// receiver drops the byte it probes the window with), so the timeout is short, and the receive buffer is much
+// larger than the window it can advertise: the application reads on another thread, and shouldn't let the
+// window close just by being scheduled late.
+inline TCPConfig socket_pair_tcp_config()
+{
+  TCPConfig config;
+  config.rt_timeout = 10;
+  config.recv_capacity = 1 << 20;
+  return config;
+}
+
+inline std::string random_bytes( size_t length )
+{
+  auto rng = get_random_engine();
+  std::string ret( length, 0 );
+  for ( auto& ch : ret ) {
+    ch = static_cast<char>( rng() );
+  }
+  return ret;
+}
+
+template<class SocketT>
+void write_all( SocketT& socket, std::string_view data )
+{
+  while ( not data.empty() ) {
+    data.remove_prefix( socket.write( data ) );
+  }
+}
+
+// Read until EOF
+template<class SocketT>
+std::string read_all( SocketT& socket )
+{
+  std::string ret;
+  std::string buffer;
+  while ( not socket.eof() ) {
+    buffer.clear(); // (so that read() fills as much as it can)
+    socket.read( buffer );
+    ret += buffer;
+  }
+  return ret;
+}
+
+// Connect `client` to `server` (10.0.0.1:9000 to 10.0.0.2:1234, with the rest of `adapter_config` for both),
+// run `server_body` on the server in a thread and `client_body` on the client, and wait for both to close.
+// Both sockets are blocking by then; each body should read to EOF, or the connection won't close.
+template<class SocketT, class ServerT, class ClientT>
+void run_connection( SocketT& client,
+                     SocketT& server,
+                     const TCPConfig& tcp_config,
+                     ServerT&& server_body,
+                     ClientT&& client_body,
+                     const FdAdapterConfig& adapter_config = {} )
+{
+  FdAdapterConfig server_config = adapter_config;
+  server_config.source = Address { "10.0.0.2", 1234 };
+  FdAdapterConfig client_config = adapter_config;
+  client_config.source = Address { "10.0.0.1", 9000 };
+  client_config.destination = server_config.source;
+
+  std::thread server_thread { [&] {
+    server.listen_and_accept( tcp_config, server_config );
+    server.set_blocking( true );
+    server_body( server );
+    server.wait_until_closed();
+  } };
+
+  client.connect( tcp_config, client_config );
+  client.set_blocking( true );
+  client_body( client );
+  client.wait_until_closed();
+  server_thread.join();
+}
+
+// The client sends `bytes` random bytes and closes its side, the server reads them all and answers "thanks":
+// check that each got the other's stream, intact
+template<class SocketT>
+void check_transfer( SocketT& client,
+                     SocketT& server,
+                     const TCPConfig& tcp_config,
+                     size_t bytes,
+                     const FdAdapterConfig& adapter_config = {} )
+{
+  const std::string data = random_bytes( bytes );
+  std::string received;
+  std::string response;
+
+  run_connection(
+    client,
+    server,
+    tcp_config,
+    [&]( SocketT& socket ) {
+      received = read_all( socket );
+      write_all( socket, "thanks" );
+    },
+    [&]( SocketT& socket ) {
+      write_all( socket, data );
+      socket.shutdown( SHUT_WR );
+      response = read_all( socket );
+    },
+    adapter_config );
+
+  check( received == data, "server received the client's data" );
+  check( response == "thanks", "client received the server's data" );
+}
@@ -0,0 +1,116 @@
+#include "common.hh"
+#include "tcp_config.hh"
+#include "tcp_peer.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <span>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+string read_all( Reader& reader )
+{
+  string ret;
+  while ( reader.bytes_buffered() ) {
+    ret += reader.peek();
+    reader.pop( reader.peek().size() );
+  }
+  return ret;
+}
+
+int main()
+{
+  try {
+    TCPConfig client_config;
+    client_config.isn = Wrap32 { UINT32_MAX - 5000 }; // the acknowledgments of the client's data wrap around
+    TCPConfig server_config;
+    server_config.isn = Wrap32 { 1000 };
+
+    TCPPeer client { client_config };
+    TCPPeer server { server_config };
+
+    vector<TCPMessage> to_server;
+    vector<TCPMessage> to_client;
+    const TCPPeer::TransmitFunction send_to_server = [&]( TCPMessage msg ) { to_server.push_back( move( msg ) ); };
+    const TCPPeer::TransmitFunction send_to_client = [&]( TCPMessage msg ) { to_client.push_back( move( msg ) ); };
+
+    // handshake: each batch reply is a single segment (the server's SYN carries its ACK)
+    client.push( send_to_server );
+    check( to_server.size() == 1 and to_server.front().sender.SYN, "client sends SYN" );
+
+    server.receive_batch( to_server, send_to_client );
+    to_server.clear();
+    check( to_client.size() == 1 and to_client.front().sender.SYN and to_client.front().receiver.ackno.has_value(),
+           "server replies with one SYN/ACK" );
+
+    client.receive_batch( to_client, send_to_server );
+    to_client.clear();
+    check( to_server.size() == 1 and to_server.front().sender.sequence_length() == 0, "client ACKs the SYN" );
+    check( not client.time_until_deadline().has_value(), "client has no deadline while its streams are open" );
+
+    // the client sends ten segments of data (and the ACK of the server's SYN is still queued in front)
+    const string data = [] {
+      string ret;
+      for ( size_t i = 0; i < 10 * TCPConfig::MAX_PAYLOAD_SIZE; i++ ) {
+        ret.push_back( static_cast<char>( 'a' + i % 26 ) );
+      }
+      return ret;
+    }();
+    client.outbound_writer().push( data );
+    client.push( send_to_server );
+    check( to_server.size() == 11, "client sends ten data segments" );
+
+    // the first half one at a time: the server ACKs each one
+    for ( size_t i = 0; i < 6; i++ ) {
+      server.receive( move( to_server.at( i ) ), send_to_client );
+    }
+    check( to_client.size() == 5, "server ACKs each data segment received alone" );
+
+    // the second half as a batch: all of it is delivered, with one ACK for the lot
+    server.receive_batch( span { to_server }.subspan( 6 ), send_to_client );
+    to_server.clear();
+    check( to_client.size() == 6, "server sends one ACK for a batch" );
+    check( read_all( server.inbound_reader() ) == data, "server received all the data" );
+
+    // the client gets all six ACKs, newest first: the newest one still counts
+    reverse( to_client.begin(), to_client.end() );
+    client.receive_batch( to_client, send_to_server );
+    to_client.clear();
+    check( client.sender().sequence_numbers_in_flight() == 0, "client's data is all acknowledged" );
+    check( to_server.empty(), "client doesn't reply to pure ACKs" );
+
+    // a batch with a FIN and new data from the server gets one reply from the client
+    server.outbound_writer().push( "reply" );
+    server.outbound_writer().close();
+    server.push( send_to_client );
+    check( to_client.size() == 1 and to_client.front().sender.FIN, "server sends its data and FIN together" );
+    client.outbound_writer().push( "more" );
+    client.receive_batch( to_client, send_to_server );
+    to_client.clear();
+    check( to_server.size() == 1 and to_server.front().sender.payload == "more"
+             and to_server.front().receiver.ackno == Wrap32 { 1000 } + 7,
+           "client's data carries the ACK of the server's data and FIN" );
+    check( read_all( client.inbound_reader() ) == "reply" and client.inbound_reader().is_finished(),
+           "client received the server's stream" );
+
+    // an ACK of something the client hasn't sent comes after a valid one: the valid one still counts
+    server.receive_batch( to_server, send_to_client );
+    to_server.clear();
+    check( to_client.size() == 1 and to_client.front().receiver.ackno.has_value(), "server ACKs the data" );
+    TCPMessage too_new = to_client.front();
+    too_new.receiver.ackno = too_new.receiver.ackno.value() + 1000;
+    to_client.push_back( too_new );
+    client.receive_batch( to_client, send_to_server );
+    to_client.clear();
+    check( client.sender().sequence_numbers_in_flight() == 0, "client's data is acknowledged by the valid ACK" );
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
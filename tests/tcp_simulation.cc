@@ -0,0 +1,157 @@
+#include "common.hh"
+#include "tcp_simulation.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+constexpr uint64_t BYTES = 1'000'000;
+
+TCPSimulation::FlowReport run_one( const TCPSimulation::FlowConfig& config, uint64_t seed = 0 )
+{
+  TCPSimulation sim { seed };
+  sim.add_flow( config );
+  sim.run_for( 1'000'000 );
+  const auto report = sim.report( 0 );
+  check( sim.finished() and report.finished, "connection finished" );
+  check( report.bytes_delivered == config.bytes, "every byte delivered" );
+  return report;
+}
+
+// Over a link that does nothing, each way takes a ms
+void check_perfect_link()
+{
+  TCPSimulation::FlowConfig config;
+  config.bytes = BYTES;
+  const auto report = run_one( config );
+  check( report.rtt_samples() > 0 and report.rtt_quantile( 0 ) == 2 and report.rtt_quantile( 1 ) == 2,
+         "every RTT is 2 ms" );
+  check( report.retransmissions == 0 and report.segments_sent > BYTES / TCPConfig::MAX_PAYLOAD_SIZE,
+         "nothing retransmitted" );
+}
+
+// With a long delay, the window limits goodput: one window (the most the header can advertise) per RTT
+void check_window_limited()
+{
+  TCPSimulation::FlowConfig config;
+  config.bytes = BYTES;
+  config.tcp.recv_capacity = 1 << 20;
+  config.forward.delay_ms = config.reverse.delay_ms = 50;
+  const auto report = run_one( config );
+  check( report.rtt_quantile( 0 ) == 100 and report.rtt_quantile( 1 ) == 100, "every RTT is 100 ms" );
+  check( report.duration_ms >= 1500 and report.duration_ms <= 1700, "16 round trips" );
+  check( report.goodput_bps > 4.5e6 and report.goodput_bps < 65536 * 8 * 10, "a window per RTT" );
+}
+
+// With a bandwidth cap, the link limits goodput, and the window's worth of segments beyond the bandwidth-delay
+// product waits in the queue
+void check_bandwidth_limited()
+{
+  TCPSimulation::FlowConfig config;
+  config.bytes = BYTES;
+  config.forward.delay_ms = config.reverse.delay_ms = 10;
+  config.forward.rate_bps = 10'000'000;
+  config.forward.queue_limit = 100;
+  const auto report = run_one( config );
+  check( report.goodput_bps > 9e6 and report.goodput_bps < 10e6, "goodput close to the bandwidth cap" );
+  check( report.rtt_quantile( 0 ) >= 20 and report.rtt_quantile( 0.5 ) > 40, "queueing delays the RTT" );
+  check( report.mean_queue > 10 and report.max_queue < 100 and report.forward.queue_drops == 0,
+         "segments queue, none dropped" );
+  check( report.retransmissions == 0, "nothing retransmitted" );
+
+  // a shorter queue overflows, and the dropped segments are retransmitted
+  config.forward.queue_limit = 20;
+  config.tcp.rt_timeout = 100;
+  const auto overflowing = run_one( config );
+  check( overflowing.max_queue == 20 and overflowing.forward.queue_drops > 0, "the queue overflows" );
+  check( overflowing.retransmissions >= overflowing.forward.queue_drops, "drops are retransmitted" );
+}
+
+// Burst loss both ways: the same seed makes the same run, and another seed a different one
+void check_loss_and_determinism()
+{
+  TCPSimulation::FlowConfig config;
+  config.bytes = BYTES;
+  config.tcp.rt_timeout = 100;
+  for ( auto* link : { &config.forward, &config.reverse } ) {
+    link->delay_ms = 10;
+    link->jitter_ms = 2;
+    link->gilbert_p = 0.01;
+    link->gilbert_r = 0.3;
+  }
+
+  const auto report = run_one( config, 1 );
+  check( report.forward.lost > 0 and report.retransmissions > 0, "losses are retransmitted" );
+
+  const auto again = run_one( config, 1 );
+  check( again.duration_ms == report.duration_ms and again.rtt_histogram == report.rtt_histogram
+           and again.segments_sent == report.segments_sent and again.retransmissions == report.retransmissions
+           and again.forward.lost == report.forward.lost and again.reverse.lost == report.reverse.lost,
+         "the same seed makes the same run" );
+
+  const auto other = run_one( config, 2 );
+  check( other.duration_ms != report.duration_ms or other.forward.lost != report.forward.lost
+           or other.rtt_histogram != report.rtt_histogram,
+         "another seed makes another run" );
+}
+
+// Connections that start at different times run side by side
+void check_flows()
+{
+  TCPSimulation sim;
+  TCPSimulation::FlowConfig config;
+  config.bytes = BYTES / 2;
+  config.forward.delay_ms = config.reverse.delay_ms = 20;
+  for ( uint64_t start_ms : { 0, 500, 1000 } ) {
+    config.start_ms = start_ms;
+    sim.add_flow( config );
+  }
+
+  sim.run_for( 200 );
+  check( sim.report( 0 ).bytes_delivered > 0 and sim.report( 1 ).bytes_delivered == 0, "only the first started" );
+  check( not sim.finished() and sim.now_ms() == 200, "ran for the time asked" );
+
+  sim.run_for( 1'000'000 );
+  check( sim.finished() and sim.now_ms() < 1'000'000, "all finished early" );
+  for ( size_t i = 0; i < sim.flow_count(); i++ ) {
+    const auto report = sim.report( i );
+    check( report.finished and report.bytes_delivered == config.bytes, "each delivered its bytes" );
+    check( report.duration_ms == sim.report( 0 ).duration_ms, "and took as long as the others" );
+  }
+}
+
+// A connection that starts late and sends nothing: its stream ends as soon as it starts
+void check_empty_flow()
+{
+  TCPSimulation sim;
+  TCPSimulation::FlowConfig config;
+  config.bytes = 0;
+  config.start_ms = 500;
+  sim.add_flow( config );
+  sim.run_for( 1'000'000 );
+
+  const auto report = sim.report( 0 );
+  check( report.finished and report.bytes_delivered == 0, "an empty stream finishes" );
+  check( report.duration_ms < 10, "and takes no longer than the handshake and the FIN" );
+  check( report.goodput_bps == 0 and report.mean_queue == 0, "with nothing to measure" );
+}
+
+int main()
+{
+  try {
+    check_perfect_link();
+    check_window_limited();
+    check_bandwidth_limited();
+    check_loss_and_determinism();
+    check_flows();
+    check_empty_flow();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
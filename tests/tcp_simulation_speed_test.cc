@@ -0,0 +1,99 @@
+#include "tcp_simulation.hh"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+using namespace std::chrono;
+
+// TCPPeers in TCPSimulation's virtual time: for each link, bulk transfers run for SIMULATED_MS, then the
+// connections' goodput, RTTs, retransmissions and queue occupancy, and how much faster than real time it went.
+// (The work is in the bytes each TCPPeer handles, so the faster the links, the closer to real time it runs.)
+
+namespace {
+constexpr uint64_t SIMULATED_MS = 1'000'000;
+constexpr uint64_t MIN_SPEEDUP = 100;
+
+// A link with the same delay each way, and (if any) a bandwidth cap the client's way
+TCPSimulation::FlowConfig make_flow( uint64_t delay_ms, uint64_t rate_bps, double loss = 0 )
+{
+  TCPSimulation::FlowConfig config;
+  config.tcp.rt_timeout = 4 * delay_ms + 10;
+  for ( auto* link : { &config.forward, &config.reverse } ) {
+    link->delay_ms = delay_ms;
+    link->loss_good = loss;
+  }
+  config.forward.rate_bps = rate_bps;
+  config.forward.queue_limit = 100;
+  return config;
+}
+} // namespace
+
+void simulate( const string& mode, const TCPSimulation::FlowConfig& config, size_t flows = 1 )
+{
+  TCPSimulation sim;
+  for ( size_t i = 0; i < flows; i++ ) {
+    sim.add_flow( config );
+  }
+
+  const auto start_time = steady_clock::now();
+  sim.run_for( SIMULATED_MS );
+  const double seconds = duration_cast<duration<double>>( steady_clock::now() - start_time ).count();
+  const double speedup = static_cast<double>( sim.now_ms() ) / 1000 / seconds;
+
+  double goodput_bps = 0;
+  uint64_t retransmissions = 0;
+  double mean_queue = 0;
+  for ( size_t i = 0; i < flows; i++ ) {
+    const auto report = sim.report( i );
+    goodput_bps += report.goodput_bps;
+    retransmissions += report.retransmissions;
+    mean_queue += report.mean_queue / static_cast<double>( flows );
+  }
+  const auto first = sim.report( 0 );
+
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  cout << "  " << left << setw( 36 ) << mode << right << fixed << setprecision( 2 ) << setw( 7 )
+       << goodput_bps / 1e6 << " Mbit/s, RTT " << first.rtt_quantile( 0.5 ).value_or( 0 ) << "/"
+       << first.rtt_quantile( 0.99 ).value_or( 0 ) << " ms (median/99th), " << retransmissions
+       << " retransmissions, " << setprecision( 1 ) << mean_queue << " queued; " << setprecision( 0 ) << speedup
+       << "x real time\n";
+  debug_output << "             " << mode << ": " << fixed << setprecision( 0 ) << speedup << "x real time\n";
+
+  if ( first.bytes_delivered == 0 ) {
+    throw runtime_error( mode + ": nothing delivered." );
+  }
+  if ( speedup < static_cast<double>( MIN_SPEEDUP ) ) {
+    throw runtime_error( mode + " did not meet minimum speed of " + to_string( MIN_SPEEDUP ) + "x real time." );
+  }
+}
+
+void program_body()
+{
+  simulate( "10 Mbit/s, 20 ms RTT", make_flow( 10, 10'000'000 ) );
+  simulate( "1 Mbit/s, 400 ms RTT", make_flow( 200, 1'000'000 ) );
+  simulate( "100 ms RTT (window-limited)", make_flow( 50, 0 ) );
+  simulate( "40 ms RTT, 1% loss", make_flow( 20, 0, 0.01 ) );
+  simulate( "4 connections, 2.5 Mbit/s, 20 ms RTT", make_flow( 10, 2'500'000 ), 4 );
+}
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,119 @@
+#include "tcp_config.hh"
+#include "tcp_over_ip.hh"
+#include "tcp_peer.hh"
+
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+// Send a stream from one TCPPeer to another (and the ACKs back), handing every segment to a TCPOverIPv4Adapter
+// for its headers, and report how many segments per second go from sender to adapter. The transmit function
+// is either a lambda (inlined into the peer) or a stored TCPPeer::TransmitFunction (a std::function).
+
+template<typename MakeTransmitT>
+double speed_test( const string& mode, MakeTransmitT&& make_transmit )
+{
+  constexpr size_t rounds = 4000;
+
+  TCPOverIPv4Adapter adapter;
+  adapter.config_mut().source = Address { "169.254.144.9", 9000 };
+  adapter.config_mut().destination = Address { "169.254.144.1", 1234 };
+
+  vector<TCPMessage> to_server;
+  vector<TCPMessage> to_client;
+  uint64_t segments = 0;
+  uint64_t wire_bytes = 0;
+  const auto to_adapter = [&]( vector<TCPMessage>& queue ) {
+    return [&]( TCPMessage msg ) {
+      const auto [ip_header, tcp_header] = adapter.wrap_headers( msg );
+      wire_bytes += ip_header.len;
+      segments++;
+      queue.push_back( move( msg ) );
+    };
+  };
+  const auto send_to_server = make_transmit( to_adapter( to_server ) );
+  const auto send_to_client = make_transmit( to_adapter( to_client ) );
+
+  // the server's window stays open wider than the client has data to send, so each round sends all of it
+  TCPConfig server_config;
+  server_config.recv_capacity = 2 * server_config.send_capacity;
+  TCPPeer client { TCPConfig {} };
+  TCPPeer server { server_config };
+
+  const auto deliver = [&]( TCPPeer& peer, vector<TCPMessage>& queue, const auto& reply ) {
+    for ( auto& msg : queue ) {
+      peer.receive( move( msg ), reply );
+      peer.inbound_reader().pop( peer.inbound_reader().bytes_buffered() );
+    }
+    queue.clear();
+  };
+
+  client.push( send_to_server );
+  deliver( server, to_server, send_to_client );
+  deliver( client, to_client, send_to_server );
+
+  const string data( client.outbound_writer().available_capacity(), 'x' );
+
+  const auto start_time = steady_clock::now();
+  for ( size_t i = 0; i < rounds; i++ ) {
+    client.outbound_writer().push( data );
+    client.push( send_to_server );
+    deliver( server, to_server, send_to_client );
+    deliver( client, to_client, send_to_server );
+  }
+  const auto stop_time = steady_clock::now();
+
+  if ( server.inbound_reader().bytes_popped() != rounds * data.size() ) {
+    throw runtime_error( mode + ": stream was not delivered" );
+  }
+
+  auto test_duration = duration_cast<duration<double>>( stop_time - start_time );
+  auto millions_per_second = static_cast<double>( segments ) / test_duration.count() / 1e6;
+  auto gigabits_per_second = static_cast<double>( wire_bytes ) * 8 / test_duration.count() / 1e9;
+
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  cout << "  " << left << setw( 36 ) << mode << right << fixed << setprecision( 2 ) << setw( 8 )
+       << millions_per_second << " million segments/s, " << gigabits_per_second << " Gbit/s\n";
+
+  debug_output << "             " << mode << ": " << fixed << setprecision( 2 ) << millions_per_second
+               << " million segments/s\n";
+
+  if ( millions_per_second < 0.01 ) {
+    throw runtime_error( mode + " did not meet minimum speed of 0.01 million segments/s." );
+  }
+
+  return millions_per_second;
+}
+
+void program_body()
+{
+  const double inlined = speed_test( "lambda (inlined)", []( auto transmit ) { return transmit; } );
+  const double type_erased = speed_test( "std::function", []( auto transmit ) {
+    return TCPPeer::TransmitFunction { transmit };
+  } );
+
+  cout << "  inlined / std::function: " << fixed << setprecision( 2 ) << inlined / type_erased << "x\n";
+}
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -126,6 +126,25 @@ pair<string, uint16_t> Address::ip_port() const
   return { ip.data(), stoi( port.data() ) };
 }
 
+uint16_t Address::port() const
+{
+  // read the port straight out of the sockaddr (cheaper than getnameinfo, and called per segment)
+  switch ( _address.storage.ss_family ) {
+    case AF_INET: {
+      sockaddr_in ipv4_addr {};
+      memcpy( &ipv4_addr, &_address.storage, sizeof( ipv4_addr ) );
+      return be16toh( ipv4_addr.sin_port );
+    }
+    case AF_INET6: {
+      sockaddr_in6 ipv6_addr {};
+      memcpy( &ipv6_addr, &_address.storage, sizeof( ipv6_addr ) );
+      return be16toh( ipv6_addr.sin6_port );
+    }
+    default:
+      throw runtime_error( "Address::port() called on non-Internet address" );
+  }
+}
+
 string Address::to_string() const
 {
   if ( _address.storage.ss_family == AF_INET or _address.storage.ss_family == AF_INET6 ) {
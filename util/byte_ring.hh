@@ -0,0 +1,103 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
+
+//! Lock-free single-producer/single-consumer byte ring shared between two threads of one process
+//! \details The producer thread calls push() and close(); the consumer thread calls peek() and pop().
+//! Positions are free-running 64-bit counters, so the ring never needs a "full vs. empty" sentinel.
+class SPSCByteRing
+{
+  // Keep the two positions on separate cache lines so producer and consumer don't false-share
+  static constexpr size_t CACHE_LINE = 64;
+
+  size_t capacity_;
+  size_t mask_;
+  std::unique_ptr<char[]> storage_;
+
+  alignas( CACHE_LINE ) std::atomic<uint64_t> head_ { 0 }; // total bytes pushed (written by producer)
+  alignas( CACHE_LINE ) std::atomic<uint64_t> tail_ { 0 }; // total bytes popped (written by consumer)
+  alignas( CACHE_LINE ) std::atomic<bool> closed_ { false };
+
+public:
+  //! \param[in] capacity is rounded up to a power of two
+  explicit SPSCByteRing( size_t capacity )
+    : capacity_( std::bit_ceil( std::max<size_t>( capacity, 1 ) ) )
+    , mask_( capacity_ - 1 )
+    , storage_( std::make_unique<char[]>( capacity_ ) ) // NOLINT(*-avoid-c-arrays)
+  {}
+
+  //! \name Producer interface
+  //!@{
+
+  //! Copy as much of `data` as fits into the ring.
+  //! \returns the number of bytes accepted; `was_empty` is set if the consumer had drained the ring
+  //! completely before this push was published (i.e., the consumer may be asleep and needs a wakeup).
+  size_t push( std::string_view data, bool& was_empty )
+  {
+    const uint64_t head = head_.load( std::memory_order_relaxed );
+    const uint64_t tail = tail_.load( std::memory_order_acquire );
+    const size_t len = std::min<uint64_t>( data.size(), capacity_ - ( head - tail ) );
+
+    const size_t offset = head & mask_;
+    const size_t first = std::min( len, capacity_ - offset );
+    memcpy( storage_.get() + offset, data.data(), first );
+    memcpy( storage_.get(), data.data() + first, len - first );
+
+    // Dekker handshake with the consumer: a seq_cst store, then a seq_cst load of the other side's position.
+    // The consumer does the same in pop() and its re-check of bytes_buffered(), so either we see its final
+    // pop, or it sees our push. (The re-checks of both sides, bytes_buffered() and available_capacity(), load
+    // the other side's position seq_cst for this reason: an acquire load could be reordered before the store.)
+    head_.store( head + len );
+    was_empty = len and ( tail_.load() == head );
+    return len;
+  }
+
+  //! Signal that nothing more will be pushed
+  void close() { closed_.store( true ); }
+
+  //! How many bytes could be pushed right now? (The consumer's position is loaded seq_cst, so this can serve as
+  //! the re-check after a seq_cst store that announces the producer is about to sleep.)
+  size_t available_capacity() const
+  {
+    return capacity_ - ( head_.load( std::memory_order_relaxed ) - tail_.load() );
+  }
+  //!@}
+
+  //! \name Consumer interface
+  //!@{
+
+  //! The longest contiguous run of buffered bytes (may be shorter than bytes_buffered() at the wraparound)
+  std::string_view peek() const
+  {
+    const uint64_t tail = tail_.load( std::memory_order_relaxed );
+    const uint64_t head = head_.load( std::memory_order_acquire );
+    const size_t offset = tail & mask_;
+    return { storage_.get() + offset, std::min<uint64_t>( head - tail, capacity_ - offset ) };
+  }
+
+  //! Release `len` bytes back to the producer
+  void pop( size_t len )
+  {
+    const uint64_t tail = tail_.load( std::memory_order_relaxed );
+    if ( len > head_.load( std::memory_order_acquire ) - tail ) {
+      throw std::out_of_range( "SPSCByteRing::pop() past end of buffered data" );
+    }
+    tail_.store( tail + len );
+  }
+
+  //! Has the producer closed the ring, and has the consumer drained it?
+  bool is_finished() const { return closed_.load( std::memory_order_acquire ) and bytes_buffered() == 0; }
+  //!@}
+
+  size_t capacity() const { return capacity_; }
+  size_t bytes_buffered() const { return head_.load() - tail_.load(); }
+  bool is_closed() const { return closed_.load( std::memory_order_acquire ); }
+};
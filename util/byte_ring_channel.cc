@@ -0,0 +1,62 @@
+#include "byte_ring_channel.hh"
+#include "exception.hh"
+
+#include <poll.h>
+#include <stdexcept>
+
+using namespace std;
+
+size_t ByteRingChannel::write( const string_view data )
+{
+  bool was_empty {};
+  const size_t accepted = ring_.push( data, was_empty );
+  if ( was_empty ) {
+    ready_.notify(); // later pushes ride on this wakeup until the consumer has drained the ring
+  }
+  return accepted;
+}
+
+void ByteRingChannel::write_all( string_view data )
+{
+  while ( true ) {
+    data.remove_prefix( write( data ) );
+    if ( data.empty() ) {
+      return;
+    }
+
+    // announce that we're waiting *before* re-checking for space, so the consumer can't miss us (a seq_cst store,
+    // then available_capacity()'s seq_cst load of the tail; pop() stores the tail, then loads this flag, both
+    // seq_cst, so either we see the space it made or it sees us waiting)
+    producer_waiting_ = true;
+    if ( ring_.available_capacity() == 0 and not consumer_done_ ) {
+      pollfd pfd { space_.fd_num(), POLLIN, 0 };
+      CheckSystemCall( "poll", ::poll( &pfd, 1, -1 ) );
+    }
+    producer_waiting_ = false;
+    space_.drain();
+
+    if ( consumer_done_ ) {
+      throw runtime_error( "ByteRingChannel::write_all(): consumer is no longer draining" );
+    }
+  }
+}
+
+void ByteRingChannel::close()
+{
+  ring_.close();
+  ready_.notify();
+}
+
+void ByteRingChannel::pop( const size_t len )
+{
+  ring_.pop( len );
+  if ( producer_waiting_ ) {
+    space_.notify();
+  }
+}
+
+void ByteRingChannel::set_consumer_done()
+{
+  consumer_done_ = true;
+  space_.notify();
+}
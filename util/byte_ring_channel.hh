@@ -0,0 +1,51 @@
+#pragma once
+
+#include "byte_ring.hh"
+#include "eventfd.hh"
+
+#include <atomic>
+#include <cstddef>
+#include <string_view>
+
+//! An in-process byte pipe between two threads: a SPSCByteRing plus eventfd wakeups in each direction
+//! \details Wakeups are coalesced: the producer only signals `ready()` when the ring goes from empty to
+//! non-empty (or is closed), and the consumer only signals the producer when it is blocked on a full ring.
+class ByteRingChannel
+{
+  SPSCByteRing ring_;
+  EventFD ready_ {};                     // wakes the consumer
+  EventFD space_ {};                     // wakes a producer blocked in write_all()
+  std::atomic_bool producer_waiting_ {}; // is the producer blocked in write_all()?
+  std::atomic_bool consumer_done_ {};    // has the consumer stopped draining?
+
+public:
+  explicit ByteRingChannel( size_t capacity ) : ring_( capacity ) {}
+
+  //! \name Producer interface
+  //!@{
+
+  //! Copy as much of `data` as currently fits; returns the number of bytes accepted
+  size_t write( std::string_view data );
+
+  //! Copy all of `data`, blocking while the ring is full
+  void write_all( std::string_view data );
+
+  //! End the stream
+  void close();
+  //!@}
+
+  //! \name Consumer interface
+  //!@{
+
+  //! Readable when the producer has something new for the consumer
+  EventFD& ready() { return ready_; }
+
+  std::string_view peek() const { return ring_.peek(); }
+  void pop( size_t len );
+  size_t bytes_buffered() const { return ring_.bytes_buffered(); }
+  bool is_finished() const { return ring_.is_finished(); }
+
+  //! The consumer will not drain any more; releases a blocked producer
+  void set_consumer_done();
+  //!@}
+};
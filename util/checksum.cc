@@ -0,0 +1,229 @@
+#include "checksum.hh"
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstring>
+
+#if defined( __x86_64__ )
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+// The one's-complement sum doesn't depend on byte order (RFC 1071 section 2(B)): summing native-endian
+// words and swapping the bytes of the folded result gives the same answer as summing big-endian words.
+// The kernels below add `len` bytes (a multiple of 8) as native-endian 32-bit words into a 64-bit sum,
+// which cannot overflow for any buffer shorter than 16 GiB.
+
+namespace {
+
+using SumFunction = uint64_t ( * )( const char* data, size_t len );
+using CopySumFunction = uint64_t ( * )( char* dest, const char* src, size_t len );
+
+uint64_t fold( uint64_t sum )
+{
+  while ( sum >> 16 ) {
+    sum = ( sum & 0xffff ) + ( sum >> 16 );
+  }
+  return sum;
+}
+
+uint16_t to_big_endian_sum( uint16_t native_sum )
+{
+  if constexpr ( endian::native == endian::little ) {
+    return static_cast<uint16_t>( ( native_sum >> 8 ) | ( native_sum << 8 ) );
+  }
+  return native_sum;
+}
+
+uint64_t sum_scalar( const char* data, size_t len )
+{
+  // four independent accumulators, so consecutive adds don't wait on each other
+  uint64_t sum0 = 0;
+  uint64_t sum1 = 0;
+  uint64_t sum2 = 0;
+  uint64_t sum3 = 0;
+
+  size_t i = 0;
+  for ( ; i + 32 <= len; i += 32 ) {
+    array<uint64_t, 4> words {};
+    memcpy( words.data(), data + i, sizeof( words ) );
+    sum0 += ( words[0] & 0xffffffff ) + ( words[0] >> 32 );
+    sum1 += ( words[1] & 0xffffffff ) + ( words[1] >> 32 );
+    sum2 += ( words[2] & 0xffffffff ) + ( words[2] >> 32 );
+    sum3 += ( words[3] & 0xffffffff ) + ( words[3] >> 32 );
+  }
+  for ( ; i < len; i += 8 ) {
+    uint64_t word {};
+    memcpy( &word, data + i, sizeof( word ) );
+    sum0 += ( word & 0xffffffff ) + ( word >> 32 );
+  }
+
+  return sum0 + sum1 + sum2 + sum3;
+}
+
+// Same, storing each word to `dest` as it is summed
+uint64_t copy_sum_scalar( char* dest, const char* src, size_t len )
+{
+  uint64_t sum0 = 0;
+  uint64_t sum1 = 0;
+  uint64_t sum2 = 0;
+  uint64_t sum3 = 0;
+
+  size_t i = 0;
+  for ( ; i + 32 <= len; i += 32 ) {
+    array<uint64_t, 4> words {};
+    memcpy( words.data(), src + i, sizeof( words ) );
+    memcpy( dest + i, words.data(), sizeof( words ) );
+    sum0 += ( words[0] & 0xffffffff ) + ( words[0] >> 32 );
+    sum1 += ( words[1] & 0xffffffff ) + ( words[1] >> 32 );
+    sum2 += ( words[2] & 0xffffffff ) + ( words[2] >> 32 );
+    sum3 += ( words[3] & 0xffffffff ) + ( words[3] >> 32 );
+  }
+  for ( ; i < len; i += 8 ) {
+    uint64_t word {};
+    memcpy( &word, src + i, sizeof( word ) );
+    memcpy( dest + i, &word, sizeof( word ) );
+    sum0 += ( word & 0xffffffff ) + ( word >> 32 );
+  }
+
+  return sum0 + sum1 + sum2 + sum3;
+}
+
+#if defined( __x86_64__ )
+__attribute__( ( target( "avx2" ) ) ) uint64_t sum_avx2( const char* data, size_t len )
+{
+  // widen each 32-bit word to 64 bits and add lane-wise; two accumulators per 32-byte load
+  __m256i sum_lo = _mm256_setzero_si256();
+  __m256i sum_hi = _mm256_setzero_si256();
+
+  size_t i = 0;
+  for ( ; i + 32 <= len; i += 32 ) {
+    const __m256i chunk = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( data + i ) ); // NOLINT
+    sum_lo = _mm256_add_epi64( sum_lo, _mm256_cvtepu32_epi64( _mm256_castsi256_si128( chunk ) ) );
+    sum_hi = _mm256_add_epi64( sum_hi, _mm256_cvtepu32_epi64( _mm256_extracti128_si256( chunk, 1 ) ) );
+  }
+
+  array<uint64_t, 4> lanes {};
+  const __m256i total = _mm256_add_epi64( sum_lo, sum_hi );
+  _mm256_storeu_si256( reinterpret_cast<__m256i*>( lanes.data() ), total ); // NOLINT
+  return lanes[0] + lanes[1] + lanes[2] + lanes[3] + sum_scalar( data + i, len - i );
+}
+
+
+__attribute__( ( target( "avx2" ) ) ) uint64_t copy_sum_avx2( char* dest, const char* src, size_t len )
+{
+  __m256i sum_lo = _mm256_setzero_si256();
+  __m256i sum_hi = _mm256_setzero_si256();
+
+  size_t i = 0;
+  for ( ; i + 32 <= len; i += 32 ) {
+    const __m256i chunk = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( src + i ) ); // NOLINT
+    _mm256_storeu_si256( reinterpret_cast<__m256i*>( dest + i ), chunk );                    // NOLINT
+    sum_lo = _mm256_add_epi64( sum_lo, _mm256_cvtepu32_epi64( _mm256_castsi256_si128( chunk ) ) );
+    sum_hi = _mm256_add_epi64( sum_hi, _mm256_cvtepu32_epi64( _mm256_extracti128_si256( chunk, 1 ) ) );
+  }
+
+  array<uint64_t, 4> lanes {};
+  const __m256i total = _mm256_add_epi64( sum_lo, sum_hi );
+  _mm256_storeu_si256( reinterpret_cast<__m256i*>( lanes.data() ), total ); // NOLINT
+  return lanes[0] + lanes[1] + lanes[2] + lanes[3] + copy_sum_scalar( dest + i, src + i, len - i );
+}
+#endif
+
+SumFunction pick_sum_function()
+{
+#if defined( __x86_64__ )
+  if ( __builtin_cpu_supports( "avx2" ) ) {
+    return sum_avx2;
+  }
+#endif
+  return sum_scalar;
+}
+
+CopySumFunction pick_copy_sum_function()
+{
+#if defined( __x86_64__ )
+  if ( __builtin_cpu_supports( "avx2" ) ) {
+    return copy_sum_avx2;
+  }
+#endif
+  return copy_sum_scalar;
+}
+
+} // namespace
+
+string_view InternetChecksum::finish_word( string_view data )
+{
+  if ( parity_ and not data.empty() ) {
+    sum_ += static_cast<uint8_t>( data.front() );
+    data.remove_prefix( 1 );
+    parity_ = false;
+  }
+  return data;
+}
+
+void InternetChecksum::add_words( string_view data )
+{
+  for ( ; data.size() >= 2; data.remove_prefix( 2 ) ) {
+    sum_ += ( static_cast<uint32_t>( static_cast<uint8_t>( data[0] ) ) << 8 ) | static_cast<uint8_t>( data[1] );
+  }
+
+  if ( not data.empty() ) {
+    sum_ += static_cast<uint32_t>( static_cast<uint8_t>( data.front() ) ) << 8;
+    parity_ = true;
+  }
+}
+
+void InternetChecksum::add( string_view data )
+{
+  static const SumFunction sum_native = pick_sum_function();
+
+  data = finish_word( data );
+
+  const size_t bulk = data.size() & ~size_t { 7 };
+  if ( bulk ) {
+    sum_ += to_big_endian_sum( fold( sum_native( data.data(), bulk ) ) );
+    data.remove_prefix( bulk );
+  }
+
+  add_words( data );
+}
+
+void InternetChecksum::copy_and_add( char* dest, string_view src )
+{
+  static const CopySumFunction copy_sum_native = pick_copy_sum_function();
+
+  if ( parity_ and not src.empty() ) {
+    *dest++ = src.front();
+  }
+  src = finish_word( src );
+
+  const size_t bulk = src.size() & ~size_t { 7 };
+  if ( bulk ) {
+    sum_ += to_big_endian_sum( fold( copy_sum_native( dest, src.data(), bulk ) ) );
+    src.remove_prefix( bulk );
+    dest += bulk;
+  }
+
+  memcpy( dest, src.data(), src.size() );
+  add_words( src );
+}
+
+uint16_t InternetChecksum::value() const
+{
+  return static_cast<uint16_t>( ~fold( sum_ ) );
+}
+
+uint16_t InternetChecksum::folded_sum() const
+{
+  return static_cast<uint16_t>( fold( sum_ ) );
+}
+
+uint16_t InternetChecksum::update( uint16_t checksum, uint16_t old_word, uint16_t new_word )
+{
+  // HC' = ~(~HC + ~m + m')
+  const uint64_t sum = static_cast<uint16_t>( ~checksum ) + static_cast<uint16_t>( ~old_word ) + new_word;
+  return static_cast<uint16_t>( ~fold( sum ) );
+}
@@ -2,39 +2,42 @@
 
 #include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 
 //! The internet checksum algorithm
+//! \details Data may be added in fragments of any length (including odd lengths); each fragment continues
+//! where the previous one left off, as if they had been concatenated.
 class InternetChecksum
 {
 private:
-  uint32_t sum_;
-  bool parity_ {};
+  uint64_t sum_;
+  bool parity_ {}; // has an odd number of bytes been added so far?
+
+  // Finish the 16-bit word that the previous fragment left half-done; returns the rest of `data`
+  std::string_view finish_word( std::string_view data );
+
+  // Add a (short) tail a word at a time
+  void add_words( std::string_view data );
 
 public:
   explicit InternetChecksum( const uint32_t sum = 0 ) : sum_( sum ) {}
-  void add( std::string_view data )
-  {
-    for ( const uint8_t i : data ) {
-      uint16_t val = i;
-      if ( not parity_ ) {
-        val <<= 8;
-      }
-      sum_ += val;
-      parity_ = !parity_;
-    }
-  }
 
-  uint16_t value() const
-  {
-    uint32_t ret = sum_;
+  //! Sums eight bytes at a time (32 with AVX2, when the CPU supports it)
+  void add( std::string_view data );
 
-    while ( ret > 0xffff ) {
-      ret = ( ret >> 16 ) + static_cast<uint16_t>( ret );
-    }
+  //! Copy `src` to `dest` (which must have room for `src.size()` bytes) and add it, reading each byte once
+  void copy_and_add( char* dest, std::string_view src );
 
-    return ~ret;
-  }
+  uint16_t value() const;
+
+  //! The folded sum so far, before complementing: what a later checksum can start from in place of the data
+  //! (valid when the data started on a 16-bit boundary of what that checksum covers)
+  uint16_t folded_sum() const;
+
+  //! The new checksum after one 16-bit word of the checksummed data changes from `old_word` to `new_word`
+  //! (incremental update, RFC 1624 eqn. 3)
+  static uint16_t update( uint16_t checksum, uint16_t old_word, uint16_t new_word );
 
   void add( const std::vector<std::string>& data )
   {
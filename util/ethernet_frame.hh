@@ -3,6 +3,8 @@
 #include "ethernet_header.hh"
 #include "parser.hh"
 
+#include <string>
+#include <string_view>
 #include <vector>
 
 struct EthernetFrame
@@ -22,3 +24,17 @@ struct EthernetFrame
     serializer.buffer( payload );
   }
 };
+
+// An Ethernet frame parsed in place: the payload is a view into the buffer the frame was received into, which
+// must outlive it (and must be one buffer)
+struct EthernetFrameView
+{
+  EthernetHeader header {};
+  std::string_view payload {};
+
+  void parse( Parser& parser )
+  {
+    header.parse( parser );
+    parser.all_remaining( payload );
+  }
+};
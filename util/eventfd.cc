@@ -0,0 +1,29 @@
+#include "eventfd.hh"
+#include "exception.hh"
+
+#include <cstring>
+#include <string_view>
+#include <sys/eventfd.h>
+
+using namespace std;
+
+EventFD::EventFD() : FileDescriptor( ::CheckSystemCall( "eventfd", eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC ) ) ) {}
+
+void EventFD::notify()
+{
+  const uint64_t one = 1;
+  write( string_view { reinterpret_cast<const char*>( &one ), sizeof( one ) } ); // NOLINT(*-reinterpret-cast)
+}
+
+uint64_t EventFD::drain()
+{
+  string counter( sizeof( uint64_t ), 0 );
+  read( counter );
+  if ( counter.size() != sizeof( uint64_t ) ) {
+    return 0; // nothing to drain (EAGAIN)
+  }
+
+  uint64_t ret {};
+  memcpy( &ret, counter.data(), sizeof( ret ) );
+  return ret;
+}
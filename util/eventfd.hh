@@ -0,0 +1,20 @@
+#pragma once
+
+#include "file_descriptor.hh"
+
+#include <cstdint>
+
+//! A FileDescriptor to a Linux [eventfd](\ref man2::eventfd) counter, used to wake up another thread's EventLoop
+class EventFD : public FileDescriptor
+{
+public:
+  //! Create a non-blocking eventfd with its counter at zero
+  EventFD();
+
+  //! Add one to the counter, making the fd readable
+  void notify();
+
+  //! Reset the counter to zero
+  //! \returns the number of notifications coalesced since the last drain (0 if there were none)
+  uint64_t drain();
+};
@@ -39,4 +39,8 @@ public:
 
   //! Called periodically when time elapses
   void tick( const size_t unused [[maybe_unused]] ) {}
+
+  //! Largest TCP payload that write() accepts in one TCPMessage. An adapter with segmentation offload accepts
+  //! more, as long as it is a run of TCPConfig::MAX_PAYLOAD_SIZE-byte segments (the last may be shorter).
+  size_t max_payload_size() const { return TCPConfig::MAX_PAYLOAD_SIZE; }
 };
@@ -3,6 +3,8 @@
 #include "exception.hh"
 
 #include <algorithm>
+#include <array>
+#include <span>
 #include <fcntl.h>
 #include <iostream>
 #include <stdexcept>
@@ -86,11 +88,15 @@ void FileDescriptor::read( string& buffer )
     buffer.resize( kReadBufferSize );
   }
 
+  buffer.resize( read( span { buffer } ) );
+}
+
+size_t FileDescriptor::read( span<char> buffer )
+{
   const ssize_t bytes_read = ::read( fd_num(), buffer.data(), buffer.size() );
   if ( bytes_read < 0 ) {
     if ( internal_fd_->non_blocking_ and ( errno == EAGAIN or errno == EINPROGRESS ) ) {
-      buffer.clear();
-      return;
+      return 0;
     }
     throw unix_error { "read" };
   }
@@ -105,7 +111,7 @@ void FileDescriptor::read( string& buffer )
     throw runtime_error( "read() read more than requested" );
   }
 
-  buffer.resize( bytes_read );
+  return bytes_read;
 }
 
 void FileDescriptor::read( vector<string>& buffers )
@@ -153,7 +159,7 @@ void FileDescriptor::read( vector<string>& buffers )
 
 size_t FileDescriptor::write( string_view buffer )
 {
-  return write( vector<string_view> { buffer } );
+  return write( span { &buffer, 1 } );
 }
 
 size_t FileDescriptor::write( const vector<std::string>& buffers )
@@ -166,14 +172,22 @@ size_t FileDescriptor::write( const vector<std::string>& buffers )
   return write( views );
 }
 
-size_t FileDescriptor::write( const vector<string_view>& buffers )
+size_t FileDescriptor::write( span<const string_view> buffers )
 {
-  vector<iovec> iovecs;
-  iovecs.reserve( buffers.size() );
+  // gather lists as short as a datagram's (headers, payload) stay on the stack
+  constexpr size_t max_stack_iovecs = 8;
+  array<iovec, max_stack_iovecs> stack_iovecs {};
+  vector<iovec> heap_iovecs;
+  span<iovec> iovecs { stack_iovecs.data(), min( buffers.size(), max_stack_iovecs ) };
+  if ( buffers.size() > max_stack_iovecs ) {
+    heap_iovecs.resize( buffers.size() );
+    iovecs = heap_iovecs;
+  }
+
   size_t total_size = 0;
-  for ( const auto x : buffers ) {
-    iovecs.push_back( { const_cast<char*>( x.data() ), x.size() } ); // NOLINT(*-const-cast)
-    total_size += x.size();
+  for ( size_t i = 0; i < buffers.size(); i++ ) {
+    iovecs[i] = { const_cast<char*>( buffers[i].data() ), buffers[i].size() }; // NOLINT(*-const-cast)
+    total_size += buffers[i].size();
   }
 
   const ssize_t bytes_written
@@ -3,6 +3,8 @@
 #include <cstddef>
 #include <limits>
 #include <memory>
+#include <span>
+#include <string>
 #include <vector>
 
 // A reference-counted handle to a file descriptor
@@ -65,10 +67,14 @@ public:
   void read( std::string& buffer );
   void read( std::vector<std::string>& buffers );
 
+  // Read into a caller-owned buffer without resizing or allocating
+  // returns number of bytes read (0 at EOF, or if non-blocking and nothing was ready)
+  size_t read( std::span<char> buffer );
+
   // Attempt to write a buffer
   // returns number of bytes written
   size_t write( std::string_view buffer );
-  size_t write( const std::vector<std::string_view>& buffers );
+  size_t write( std::span<const std::string_view> buffers ); // (allocates nothing for a handful of buffers)
   size_t write( const std::vector<std::string>& buffers );
 
   // Close the underlying file descriptor
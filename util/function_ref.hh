@@ -0,0 +1,36 @@
+#pragma once
+
+#include <concepts>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+template<class Signature>
+class FunctionRef;
+
+//! \brief A non-owning reference to a callable, for passing callbacks through an interface that can't be a
+//! template (e.g. because its code lives in a .cc file).
+//!
+//! Unlike std::function, a FunctionRef never allocates and calls through one plain function pointer. It does
+//! not extend the life of what it refers to, so it should only be used as a function parameter, bound to a
+//! callable (often a temporary lambda) that outlives the call.
+template<class R, class... Args>
+class FunctionRef<R( Args... )>
+{
+  void* object_;
+  R ( *call_ )( void*, Args... );
+
+public:
+  //! Refer to `f`, which must outlive this FunctionRef
+  template<class F>
+    requires( not std::is_same_v<std::remove_cvref_t<F>, FunctionRef> and std::is_invocable_r_v<R, F&, Args...> )
+  FunctionRef( F&& f ) // NOLINT(*-explicit-*, *-forwarding-reference-overload)
+    : object_( const_cast<void*>( static_cast<const void*>( std::addressof( f ) ) ) )
+    , call_( []( void* object, Args... args ) -> R {
+      return std::invoke( *static_cast<std::remove_reference_t<F>*>( object ), std::forward<Args>( args )... );
+    } )
+  {}
+
+  R operator()( Args... args ) const { return call_( object_, std::forward<Args>( args )... ); }
+};
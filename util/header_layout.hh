@@ -0,0 +1,210 @@
+#pragma once
+
+#include "parser.hh"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+// Compile-time descriptions of fixed-layout headers, with parse and serialize generated from them.
+//
+// A HeaderLayout lists a header's fields in wire order, each with its width in bits (network byte order,
+// most significant bit first). Because every field's offset and width are template arguments, parsing or
+// serializing a header compiles to straight-line loads and stores over a buffer of exactly `size` bytes:
+//
+//   using Layout = HeaderLayout<Field<&IPv4Header::ver, 4>, Field<&IPv4Header::hlen, 4>, ...>;
+//   Layout::parse( header, std::span<const char, Layout::size> { ... } );
+//   Layout::serialize( header, std::span<char, Layout::size> { ... } );
+
+namespace header_layout {
+
+template<size_t Bits>
+using uint_of_width = std::conditional_t<
+  Bits == 8,
+  uint8_t,
+  std::conditional_t<Bits == 16, uint16_t, std::conditional_t<Bits == 32, uint32_t, uint64_t>>>;
+
+// Can a field this wide at this offset be loaded or stored as one whole integer?
+template<size_t Offset, size_t Bits>
+constexpr bool whole_integer = Offset % 8 == 0 and ( Bits == 8 or Bits == 16 or Bits == 32 or Bits == 64 );
+
+template<size_t Bits>
+constexpr uint64_t mask = Bits == 64 ? ~uint64_t {} : ( uint64_t { 1 } << Bits ) - 1;
+
+// Read the `Bits`-bit field that starts `Offset` bits into `data`
+template<size_t Offset, size_t Bits>
+uint64_t read_bits( const char* data )
+{
+  constexpr size_t first = Offset / 8;
+  constexpr size_t lead = Offset % 8;
+  constexpr size_t length = ( lead + Bits + 7 ) / 8;
+  static_assert( Bits > 0 and ( whole_integer<Offset, Bits> or length <= 8 ), "field too wide" );
+
+  if constexpr ( whole_integer<Offset, Bits> ) {
+    return load_big_endian<uint_of_width<Bits>>( data + first );
+  } else {
+    uint64_t value = 0;
+    for ( size_t i = 0; i < length; i++ ) {
+      value = ( value << 8 ) | static_cast<uint8_t>( data[first + i] );
+    }
+    return ( value >> ( length * 8 - lead - Bits ) ) & mask<Bits>;
+  }
+}
+
+// Write the `Bits`-bit field that starts `Offset` bits into `data` (which must be zero there beforehand)
+template<size_t Offset, size_t Bits>
+void write_bits( char* data, uint64_t value )
+{
+  constexpr size_t first = Offset / 8;
+  constexpr size_t lead = Offset % 8;
+  constexpr size_t length = ( lead + Bits + 7 ) / 8;
+  static_assert( Bits > 0 and ( whole_integer<Offset, Bits> or length <= 8 ), "field too wide" );
+
+  if constexpr ( whole_integer<Offset, Bits> ) {
+    store_big_endian( data + first, static_cast<uint_of_width<Bits>>( value ) );
+  } else {
+    const uint64_t shifted = ( value & mask<Bits> ) << ( length * 8 - lead - Bits );
+    for ( size_t i = 0; i < length; i++ ) {
+      const auto byte = static_cast<uint8_t>( shifted >> ( ( length - 1 - i ) * 8 ) );
+      data[first + i] = static_cast<char>( static_cast<uint8_t>( data[first + i] ) | byte );
+    }
+  }
+}
+
+template<class T>
+struct member_pointer;
+
+template<class H, class T>
+struct member_pointer<T H::*>
+{
+  using header = H;
+  using type = T;
+};
+
+template<class T>
+constexpr bool is_byte_array = std::is_same_v<T, std::array<uint8_t, sizeof( T )>>;
+
+} // namespace header_layout
+
+// A field kept in a data member of the header: an unsigned integer, a bool (one bit, usually), or an array of
+// bytes (e.g. an EthernetAddress). An integer member may be wider than its field (e.g. a 4-bit field in a uint8_t).
+template<auto Member, size_t Bits = 8 * sizeof( typename header_layout::member_pointer<decltype( Member )>::type )>
+struct Field
+{
+  using Header = typename header_layout::member_pointer<decltype( Member )>::header;
+  using Type = typename header_layout::member_pointer<decltype( Member )>::type;
+
+  static constexpr size_t bits = Bits;
+
+  template<size_t Offset>
+  static void parse( Header& header, const char* data )
+  {
+    if constexpr ( header_layout::is_byte_array<Type> ) {
+      static_assert( Offset % 8 == 0 and Bits == 8 * sizeof( Type ), "byte arrays must be whole and aligned" );
+      memcpy( ( header.*Member ).data(), data + Offset / 8, sizeof( Type ) );
+    } else if constexpr ( std::is_same_v<Type, bool> ) {
+      header.*Member = header_layout::read_bits<Offset, Bits>( data ) != 0;
+    } else {
+      static_assert( std::unsigned_integral<Type> and Bits <= 8 * sizeof( Type ), "field doesn't fit member" );
+      header.*Member = static_cast<Type>( header_layout::read_bits<Offset, Bits>( data ) );
+    }
+  }
+
+  template<size_t Offset>
+  static void serialize( const Header& header, char* data )
+  {
+    if constexpr ( header_layout::is_byte_array<Type> ) {
+      memcpy( data + Offset / 8, ( header.*Member ).data(), sizeof( Type ) );
+    } else {
+      header_layout::write_bits<Offset, Bits>( data, header.*Member );
+    }
+  }
+};
+
+// Bits that are serialized as `Value` and skipped when parsing (reserved or unsupported fields)
+template<size_t Bits, uint64_t Value = 0>
+struct Constant
+{
+  static constexpr size_t bits = Bits;
+
+  template<size_t Offset, class Header>
+  static void parse( Header& /* header */, const char* /* data */ )
+  {}
+
+  template<size_t Offset, class Header>
+  static void serialize( const Header& /* header */, char* data )
+  {
+    if constexpr ( Value != 0 ) {
+      header_layout::write_bits<Offset, Bits>( data, Value );
+    }
+  }
+};
+
+template<class... Fields>
+class HeaderLayout
+{
+  // each field's offset in bits from the start of the header
+  static constexpr std::array<size_t, sizeof...( Fields )> offsets_ = [] {
+    std::array<size_t, sizeof...( Fields )> ret {};
+    size_t offset = 0;
+    size_t i = 0;
+    ( ( ret.at( i++ ) = offset, offset += Fields::bits ), ... );
+    return ret;
+  }();
+
+  template<class Header, size_t... I>
+  static void parse_fields( Header& header, const char* data, std::index_sequence<I...> /* indices */ )
+  {
+    ( Fields::template parse<offsets_[I]>( header, data ), ... );
+  }
+
+  template<class Header, size_t... I>
+  static void serialize_fields( const Header& header, char* data, std::index_sequence<I...> /* indices */ )
+  {
+    ( Fields::template serialize<offsets_[I]>( header, data ), ... );
+  }
+
+public:
+  static constexpr size_t bits = ( Fields::bits + ... );
+  static_assert( bits % 8 == 0, "a header must be a whole number of bytes" );
+
+  static constexpr size_t size = bits / 8;
+
+  template<class Header>
+  static void parse( Header& header, std::span<const char, size> in )
+  {
+    parse_fields( header, in.data(), std::index_sequence_for<Fields...> {} );
+  }
+
+  template<class Header>
+  static void serialize( const Header& header, std::span<char, size> out )
+  {
+    std::ranges::fill( out, 0 );
+    serialize_fields( header, out.data(), std::index_sequence_for<Fields...> {} );
+  }
+
+  // Parse from a Parser (without copying, if the header is all in the Parser's current buffer)
+  template<class Header>
+  static void parse( Header& header, Parser& parser )
+  {
+    std::array<char, size> scratch; // NOLINT(*-member-init)
+    if ( const auto in = parser.fixed( scratch ) ) {
+      parse( header, *in );
+    }
+  }
+
+  template<class Header>
+  static void serialize( const Header& header, Serializer& serializer )
+  {
+    std::array<char, size> out; // NOLINT(*-member-init)
+    serialize( header, std::span<char, size> { out } );
+    serializer.bytes( { out.data(), out.size() } );
+  }
+};
@@ -5,6 +5,7 @@
 
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
 //! \brief [IPv4](\ref rfc::rfc791) Internet datagram
@@ -29,3 +30,22 @@ struct IPv4Datagram
 };
 
 using InternetDatagram = IPv4Datagram;
+
+//! An IPv4 datagram parsed in place: the payload is a view into the buffer the datagram was received in (e.g.
+//! an Ethernet frame's), which must outlive it
+struct IPv4DatagramView
+{
+  IPv4Header header {};
+  std::string_view payload {}; //!< (without any padding after the datagram, e.g. to a frame's minimum length)
+
+  void parse( Parser& parser )
+  {
+    header.parse( parser );
+    parser.all_remaining( payload );
+    if ( parser.has_error() or payload.size() < header.payload_length() ) {
+      parser.set_error();
+      return;
+    }
+    payload = payload.substr( 0, header.payload_length() );
+  }
+};
@@ -0,0 +1,229 @@
+#include "ipv4_fragments.hh"
+
+#include <algorithm>
+#include <span>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+// Largest payload an IPv4 datagram can have (with a header without options)
+constexpr size_t MAX_PAYLOAD = 65535 - IPv4Header::LENGTH;
+
+// Where the last hole ends until the final fragment says where the datagram does
+constexpr size_t OPEN = numeric_limits<size_t>::max();
+} // namespace
+
+bool fragment( const InternetDatagram& dgram, size_t mtu, FunctionRef<void( const InternetDatagram& )> emit )
+{
+  if ( dgram.header.len <= mtu ) {
+    emit( dgram );
+    return true;
+  }
+  if ( dgram.header.df ) {
+    return false;
+  }
+  if ( mtu < IPv4Header::LENGTH + 8 ) {
+    throw runtime_error( "fragment: MTU too small to carry any payload" );
+  }
+
+  // every fragment but the last carries a multiple of 8 bytes (the unit of the offset field)
+  const size_t max_piece = ( mtu - IPv4Header::LENGTH ) / 8 * 8;
+  size_t total = 0;
+  for ( const auto& buffer : dgram.payload ) {
+    total += buffer.size();
+  }
+
+  InternetDatagram piece { .header = dgram.header, .payload { string {} } };
+  piece.header.hlen = IPv4Header::LENGTH / 4; // (options aren't supported)
+  string& data = piece.payload.front();
+  size_t buffer = 0;       // where the next piece starts: in which of the datagram's buffers,
+  size_t buffer_start = 0; // and where in it
+  for ( size_t start = 0; start < total; ) {
+    const size_t length = min( max_piece, total - start );
+    data.clear();
+    while ( data.size() < length ) {
+      const string_view from = string_view { dgram.payload[buffer] }.substr( buffer_start, length - data.size() );
+      data.append( from );
+      buffer_start += from.size();
+      if ( buffer_start == dgram.payload[buffer].size() ) {
+        buffer++;
+        buffer_start = 0;
+      }
+    }
+
+    piece.header.offset = static_cast<uint16_t>( dgram.header.offset + start / 8 );
+    piece.header.mf = start + length < total or dgram.header.mf;
+    piece.header.len = static_cast<uint16_t>( IPv4Header::LENGTH + length );
+    piece.header.compute_checksum();
+    emit( piece );
+    start += length;
+  }
+  return true;
+}
+
+IPv4Reassembler::IPv4Reassembler( const IPv4ReassemblyLimits& limits ) : limits_( limits )
+{
+  if ( limits_.max_datagrams == 0 or limits_.max_datagrams >= NONE ) {
+    throw runtime_error( "IPv4Reassembler: max_datagrams must be positive (and fit in 32 bits)" );
+  }
+  index_.reserve( limits_.max_datagrams );
+}
+
+optional<pair<IPv4Header, string_view>> IPv4Reassembler::push( const IPv4Header& header, Parser& payload )
+{
+  // (the buffer may be longer than the fragment, e.g. with an Ethernet frame's padding, but not shorter)
+  if ( header.len < header.hlen * 4 or payload.input().size() < header.payload_length() ) {
+    return {};
+  }
+
+  const Key key { header.src, header.dst, header.id, header.proto };
+  const auto it = index_.find( key );
+  const uint32_t slot_index = it == index_.end() ? open( key ) : it->second;
+  Slot& slot = slots_[slot_index];
+
+  const size_t first = header.offset * size_t { 8 };
+  const size_t length = header.payload_length();
+  const size_t end = first + length;
+  const bool final = not header.mf;
+  const size_t known_end = slot.holes.empty() or slot.holes.back().last != OPEN ? slot.data.size() : OPEN;
+
+  const auto malformed = [&] {
+    drop( slot_index );
+    stats_.malformed++;
+    return nullopt;
+  };
+
+  if ( length == 0 or ( not final and length % 8 != 0 ) or end > MAX_PAYLOAD ) {
+    return malformed();
+  }
+  if ( known_end != OPEN ? ( end > known_end or ( final and end != known_end ) )
+                         : ( final and slot.data.size() > end ) ) {
+    return malformed(); // the fragments disagree about where the datagram ends
+  }
+
+  // the fragment should fit in one hole; if it doesn't, either it has all been received before (a duplicate,
+  // which changes nothing), or it overlaps data received before
+  const auto hole = find_if( slot.holes.begin(), slot.holes.end(), [&]( const Hole& h ) {
+    return h.first <= first and end - 1 <= h.last;
+  } );
+  if ( hole == slot.holes.end() ) {
+    if ( any_of( slot.holes.begin(), slot.holes.end(), [&]( const Hole& h ) {
+           return h.first <= end - 1 and first <= h.last;
+         } ) ) {
+      return malformed();
+    }
+    return {};
+  }
+
+  // fill the hole, leaving what's left of it on either side (and nothing past the end, if this is the end)
+  const Hole filled = *hole;
+  const auto next = slot.holes.erase( hole );
+  array<Hole, 2> remaining {};
+  size_t remaining_count = 0;
+  if ( filled.first < first ) {
+    remaining.at( remaining_count++ ) = { filled.first, first - 1 };
+  }
+  if ( end - 1 < filled.last and not final ) {
+    remaining.at( remaining_count++ ) = { end, filled.last };
+  }
+  slot.holes.insert( next, remaining.begin(), remaining.begin() + static_cast<ptrdiff_t>( remaining_count ) );
+
+  if ( slot.data.size() < end ) {
+    bytes_pending_ += end - slot.data.size();
+    slot.data.resize( end );
+  }
+  payload.string( span { slot.data }.subspan( first, length ) );
+  if ( first == 0 ) {
+    slot.header = header;
+  }
+
+  // stay within the memory limit (even if that means dropping this datagram)
+  while ( bytes_pending_ > limits_.max_bytes ) {
+    const uint32_t victim = oldest_;
+    drop( victim );
+    stats_.evicted++;
+    if ( victim == slot_index ) {
+      return {};
+    }
+  }
+
+  if ( not slot.holes.empty() ) {
+    return {};
+  }
+
+  IPv4Header whole = slot.header.value();
+  whole.hlen = IPv4Header::LENGTH / 4;
+  whole.mf = false;
+  whole.offset = 0;
+  whole.len = static_cast<uint16_t>( IPv4Header::LENGTH + slot.data.size() );
+  whole.compute_checksum();
+
+  // hand over the slot's buffer (and give it the last completed datagram's buffer to reuse)
+  bytes_pending_ -= slot.data.size();
+  slot.data.swap( completed_ );
+  slot.data.clear();
+  drop( slot_index );
+  stats_.reassembled++;
+  return pair { whole, string_view { completed_ } };
+}
+
+void IPv4Reassembler::tick( uint64_t ms_since_last_tick )
+{
+  now_ += ms_since_last_tick;
+  while ( oldest_ != NONE and slots_[oldest_].deadline <= now_ ) {
+    drop( oldest_ );
+    stats_.timed_out++;
+  }
+}
+
+uint32_t IPv4Reassembler::open( const Key& key )
+{
+  if ( free_slots_.empty() ) {
+    if ( slots_.size() < limits_.max_datagrams ) {
+      slots_.emplace_back();
+      free_slots_.push_back( static_cast<uint32_t>( slots_.size() - 1 ) );
+    } else {
+      drop( oldest_ );
+      stats_.evicted++;
+    }
+  }
+
+  const uint32_t slot_index = free_slots_.back();
+  free_slots_.pop_back();
+  Slot& slot = slots_[slot_index];
+  slot.key = key;
+  slot.holes.push_back( { 0, OPEN } );
+  slot.header.reset();
+  slot.deadline = now_ + limits_.timeout_ms;
+
+  // the newest datagram
+  slot.older = newest_;
+  slot.newer = NONE;
+  ( newest_ == NONE ? oldest_ : slots_[newest_].newer ) = slot_index;
+  newest_ = slot_index;
+
+  if ( spare_nodes_.empty() ) {
+    index_.emplace( key, slot_index );
+  } else {
+    auto node = move( spare_nodes_.back() );
+    spare_nodes_.pop_back();
+    node.key() = key;
+    node.mapped() = slot_index;
+    index_.insert( move( node ) );
+  }
+  return slot_index;
+}
+
+void IPv4Reassembler::drop( uint32_t slot_index )
+{
+  Slot& slot = slots_[slot_index];
+  ( slot.older == NONE ? oldest_ : slots_[slot.older].newer ) = slot.newer;
+  ( slot.newer == NONE ? newest_ : slots_[slot.newer].older ) = slot.older;
+
+  spare_nodes_.push_back( index_.extract( slot.key ) );
+  bytes_pending_ -= slot.data.size();
+  slot.data.clear();
+  slot.holes.clear();
+  free_slots_.push_back( slot_index );
+}
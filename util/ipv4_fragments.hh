@@ -0,0 +1,129 @@
+#pragma once
+
+#include "function_ref.hh"
+#include "ipv4_datagram.hh"
+#include "ipv4_header.hh"
+#include "parser.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+//! Cut `dgram` into fragments whose total length (header included) is at most `mtu`, and pass each to `emit`
+//! (the same InternetDatagram object each time, so `emit` should copy what it keeps). A datagram that fits is
+//! passed on whole.
+//! \returns `false` (emitting nothing) if the datagram needs fragmenting but says not to ("don't fragment")
+bool fragment( const InternetDatagram& dgram, size_t mtu, FunctionRef<void( const InternetDatagram& )> emit );
+
+//! How much an IPv4Reassembler may hold on to
+struct IPv4ReassemblyLimits
+{
+  size_t max_datagrams = 64;     //!< datagrams being reassembled at once (beyond this, the oldest is dropped)
+  size_t max_bytes = 1 << 20;    //!< bytes buffered for them all together (likewise)
+  uint64_t timeout_ms = 30'000;  //!< how long a datagram has for all of its fragments to arrive
+};
+
+//! Puts fragmented IPv4 datagrams back together ([RFC 791](\ref rfc::rfc791) section 3.2), in bounded memory
+//! \details Each datagram being reassembled (identified by its source, destination, protocol and id) has a
+//! buffer its fragments are copied into at their offsets, and a list of the holes still to be filled, as in
+//! [RFC 815](\ref rfc::rfc815): a fragment is checked against the holes, not against the other fragments.
+//! A fragment that overlaps data already received (other than an exact or contained duplicate, which is
+//! ignored), or that disagrees about where the datagram ends, gets the whole datagram dropped, as Linux does:
+//! overlaps are how fragments are used to slip past filters, and no honest sender makes them.
+//! Datagram state lives in a fixed number of slots that keep their buffers, so once they have grown, taking in
+//! fragments doesn't allocate. Every datagram has the same timeout, so the slots are kept in a list by age: the
+//! oldest is the next to time out, and the one dropped to make room.
+class IPv4Reassembler
+{
+public:
+  explicit IPv4Reassembler( const IPv4ReassemblyLimits& limits = IPv4ReassemblyLimits {} );
+
+  //! Whether a datagram with this header is a fragment (rather than a whole datagram)
+  static bool is_fragment( const IPv4Header& header ) { return header.mf or header.offset != 0; }
+
+  //! Take in a fragment, whose payload is the rest of `payload`. If it completes its datagram, returns that
+  //! datagram: its header (from the first fragment, with the fragment fields and length made whole) and its
+  //! payload, which stays valid until the next call.
+  std::optional<std::pair<IPv4Header, std::string_view>> push( const IPv4Header& header, Parser& payload );
+
+  //! Called periodically when time elapses (and drops the datagrams that have run out of time)
+  void tick( uint64_t ms_since_last_tick );
+
+  size_t datagrams_pending() const { return index_.size(); }
+  size_t bytes_pending() const { return bytes_pending_; }
+
+  //! What has happened to the datagrams taken in so far
+  struct Stats
+  {
+    uint64_t reassembled {}; //!< datagrams completed
+    uint64_t timed_out {};   //!< datagrams dropped because their time ran out
+    uint64_t evicted {};     //!< datagrams dropped to make room for others
+    uint64_t malformed {};   //!< datagrams dropped for overlaps, inconsistent ends, or too much length
+  };
+  const Stats& stats() const { return stats_; }
+
+private:
+  static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+  struct Key
+  {
+    uint32_t src;
+    uint32_t dst;
+    uint16_t id;
+    uint8_t proto;
+    bool operator==( const Key& other ) const = default;
+  };
+
+  struct KeyHash
+  {
+    size_t operator()( const Key& key ) const
+    {
+      const uint64_t addresses = static_cast<uint64_t>( key.src ) << 32 | key.dst;
+      return std::hash<uint64_t> {}( addresses * 0x9e3779b97f4a7c15ULL ^ ( key.id << 8 | key.proto ) );
+    }
+  };
+
+  //! A range of payload bytes not yet received, first to last inclusive (as in RFC 815)
+  struct Hole
+  {
+    size_t first;
+    size_t last;
+  };
+
+  struct Slot
+  {
+    Key key {};
+    std::string data {};          //!< the payload so far, each fragment at its offset
+    std::vector<Hole> holes {};   //!< in order; the last one is open-ended until the final fragment arrives
+    std::optional<IPv4Header> header {}; //!< the first fragment's, once it has arrived
+    uint64_t deadline {};
+    uint32_t older { NONE };
+    uint32_t newer { NONE };
+  };
+
+  IPv4ReassemblyLimits limits_;
+  uint64_t now_ {};
+
+  std::vector<Slot> slots_ {};
+  std::vector<uint32_t> free_slots_ {};
+  uint32_t oldest_ { NONE };
+  uint32_t newest_ { NONE };
+
+  //! The slot of each datagram being reassembled (and spare nodes, so that the index doesn't allocate either)
+  using Index = std::unordered_map<Key, uint32_t, KeyHash>;
+  Index index_ {};
+  std::vector<Index::node_type> spare_nodes_ {};
+
+  size_t bytes_pending_ {};
+  std::string completed_ {}; //!< the last datagram completed
+  Stats stats_ {};
+
+  uint32_t open( const Key& key );
+  void drop( uint32_t slot );
+};
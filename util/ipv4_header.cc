@@ -1,5 +1,6 @@
 #include "ipv4_header.hh"
 #include "checksum.hh"
+#include "header_layout.hh"
 
 #include <arpa/inet.h>
 #include <array>
@@ -8,28 +9,28 @@
 
 using namespace std;
 
+namespace {
+using IPv4HeaderLayout = HeaderLayout<Field<&IPv4Header::ver, 4>,
+                                      Field<&IPv4Header::hlen, 4>,
+                                      Field<&IPv4Header::tos>,
+                                      Field<&IPv4Header::len>,
+                                      Field<&IPv4Header::id>,
+                                      Constant<1>, // reserved flag
+                                      Field<&IPv4Header::df, 1>,
+                                      Field<&IPv4Header::mf, 1>,
+                                      Field<&IPv4Header::offset, 13>,
+                                      Field<&IPv4Header::ttl>,
+                                      Field<&IPv4Header::proto>,
+                                      Field<&IPv4Header::cksum>,
+                                      Field<&IPv4Header::src>,
+                                      Field<&IPv4Header::dst>>;
+static_assert( IPv4HeaderLayout::size == IPv4Header::LENGTH );
+} // namespace
+
 // Parse from string.
 void IPv4Header::parse( Parser& parser )
 {
-  uint8_t first_byte {};
-  parser.integer( first_byte );
-  ver = first_byte >> 4;    // version
-  hlen = first_byte & 0x0f; // header length
-  parser.integer( tos );    // type of service
-  parser.integer( len );
-  parser.integer( id );
-
-  uint16_t fo_val {};
-  parser.integer( fo_val );
-  df = static_cast<bool>( fo_val & 0x4000 ); // don't fragment
-  mf = static_cast<bool>( fo_val & 0x2000 ); // more fragments
-  offset = fo_val & 0x1fff;                  // offset
-
-  parser.integer( ttl );
-  parser.integer( proto );
-  parser.integer( cksum );
-  parser.integer( src );
-  parser.integer( dst );
+  IPv4HeaderLayout::parse( *this, parser );
 
   if ( ver != 4 ) {
     parser.set_error();
@@ -61,22 +62,7 @@ void IPv4Header::serialize( Serializer& serializer ) const
     throw runtime_error( "wrong IP version" );
   }
 
-  const uint8_t first_byte = ( static_cast<uint32_t>( ver ) << 4 ) | ( hlen & 0xfU );
-  serializer.integer( first_byte ); // version and header length
-  serializer.integer( tos );
-  serializer.integer( len );
-  serializer.integer( id );
-
-  const uint16_t fo_val = ( df ? 0x4000U : 0 ) | ( mf ? 0x2000U : 0 ) | ( offset & 0x1fffU );
-  serializer.integer( fo_val );
-
-  serializer.integer( ttl );
-  serializer.integer( proto );
-
-  serializer.integer( cksum );
-
-  serializer.integer( src );
-  serializer.integer( dst );
+  IPv4HeaderLayout::serialize( *this, serializer );
 }
 
 uint16_t IPv4Header::payload_length() const
@@ -106,13 +92,18 @@ uint32_t IPv4Header::pseudo_checksum() const
 
 void IPv4Header::compute_checksum()
 {
-  cksum = 0;
-  Serializer s;
-  serialize( s );
-
-  // calculate checksum -- taken over header only
-  InternetChecksum check;
-  check.add( s.output() );
+  // calculate checksum -- taken over header only, summed as 16-bit words straight from the fields
+  // (so that verifying every received datagram doesn't have to serialize it again)
+  const uint16_t fo_val = ( df ? 0x4000U : 0 ) | ( mf ? 0x2000U : 0 ) | ( offset & 0x1fffU );
+  uint32_t sum = ( static_cast<uint32_t>( ver ) << 12 ) | ( ( hlen & 0xfU ) << 8 ) | tos;
+  sum += len;
+  sum += id;
+  sum += fo_val;
+  sum += ( static_cast<uint32_t>( ttl ) << 8 ) | proto;
+  sum += ( src >> 16 ) + static_cast<uint16_t>( src );
+  sum += ( dst >> 16 ) + static_cast<uint16_t>( dst );
+
+  const InternetChecksum check { sum };
   cksum = check.value();
 }
 
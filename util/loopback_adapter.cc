@@ -0,0 +1,54 @@
+#include "loopback_adapter.hh"
+
+using namespace std;
+
+pair<LoopbackAdapter, LoopbackAdapter> LoopbackAdapter::make_pair()
+{
+  auto a_to_b = make_shared<Queue>();
+  auto b_to_a = make_shared<Queue>();
+  return { LoopbackAdapter { b_to_a, a_to_b }, LoopbackAdapter { a_to_b, b_to_a } };
+}
+
+optional<TCPMessage> LoopbackAdapter::read()
+{
+  const lock_guard lock { inbound_->mutex };
+  auto& messages = inbound_->messages;
+  if ( messages.empty() ) {
+    return {};
+  }
+
+  // (moved out, so the slot's payload buffer goes with it: the copy into the slot is what allocates)
+  optional<TCPMessage> ret { move( messages.front() ) };
+  messages.pop();
+  if ( inbound_->wakeup.has_value() ) {
+    if ( messages.empty() ) {
+      inbound_->wakeup->drain(); // (a read of the fd, so it counts as this one)
+    } else {
+      inbound_->wakeup->count_read();
+    }
+  }
+  return ret;
+}
+
+void LoopbackAdapter::write( const TCPMessage& seg )
+{
+  const lock_guard lock { outbound_->mutex };
+  auto& messages = outbound_->messages;
+  messages.next_slot() = seg;
+  messages.push_next();
+  if ( messages.size() == 1 and outbound_->wakeup.has_value() ) {
+    outbound_->wakeup->notify(); // later messages ride on this wakeup until the reader has emptied the queue
+  }
+}
+
+FileDescriptor& LoopbackAdapter::fd()
+{
+  const lock_guard lock { inbound_->mutex };
+  if ( not inbound_->wakeup.has_value() ) {
+    inbound_->wakeup.emplace();
+    if ( not inbound_->messages.empty() ) {
+      inbound_->wakeup->notify();
+    }
+  }
+  return inbound_->wakeup.value();
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "eventfd.hh"
+#include "fd_adapter.hh"
+#include "recycling_queue.hh"
+#include "tcp_segment.hh"
+#include "tuntap_adapter.hh"
+
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+//! \brief One end of an in-process link between two TCP stacks, with no device and no privileges needed.
+//!
+//! Each direction is a queue of TCPMessages in memory: write() copies the message onto the peer's queue and
+//! read() takes the next one off this end's queue, so nothing is serialized or checksummed, and there are no
+//! system calls. The two ends may be driven by one thread (e.g. two TCPPeers in a benchmark's loop) or by two
+//! (e.g. two TCPMinnowSockets). For an EventLoop, fd() is an eventfd that is readable while messages are
+//! waiting; it is only made (and only signalled) once someone asks for it.
+class LoopbackAdapter : public FdAdapterBase
+{
+public:
+  //! Make the two ends of a link
+  static std::pair<LoopbackAdapter, LoopbackAdapter> make_pair();
+
+  //! Take the next message sent by the other end, if there is one
+  std::optional<TCPMessage> read();
+
+  //! Send a message to the other end
+  void write( const TCPMessage& seg );
+
+  //! Readable while read() has something to return (one read() counts as a read of this FileDescriptor)
+  FileDescriptor& fd();
+
+private:
+  //! Counts the adapter's reads as its own, so TCPMinnowSocket can tell when it has drained the queue
+  class WakeupFD : public EventFD
+  {
+  public:
+    void count_read() { register_read(); }
+  };
+
+  //! The messages going one way
+  struct Queue
+  {
+    std::mutex mutex {};
+    RecyclingQueue<TCPMessage> messages {};
+    std::optional<WakeupFD> wakeup {}; //!< readable while `messages` is not empty (once made)
+  };
+
+  LoopbackAdapter( std::shared_ptr<Queue> inbound, std::shared_ptr<Queue> outbound )
+    : inbound_( std::move( inbound ) ), outbound_( std::move( outbound ) )
+  {}
+
+  std::shared_ptr<Queue> inbound_;
+  std::shared_ptr<Queue> outbound_;
+};
+
+static_assert( TCPDatagramAdapter<LoopbackAdapter> );
+static_assert( TCPDatagramAdapter<LossyFdAdapter<LoopbackAdapter>> );
@@ -66,4 +66,10 @@ public:
   const FdAdapterConfig& config() const { return _adapter.config(); } //!< FdAdapterBase::config passthrough
   FdAdapterConfig& config_mut() { return _adapter.config_mut(); }     //!< FdAdapterBase::config_mut passthrough
   void tick( const size_t ms_since_last_tick ) { _adapter.tick( ms_since_last_tick ); }
+
+  //! FdAdapterBase::max_payload_size passthrough (unless emulating uplink loss, which must stay per-segment)
+  size_t max_payload_size() const
+  {
+    return _adapter.config().loss_rate_up ? TCPConfig::MAX_PAYLOAD_SIZE : _adapter.max_payload_size();
+  }
 };
@@ -0,0 +1,250 @@
+#pragma once
+
+#include "file_descriptor.hh"
+#include "random.hh"
+#include "tcp_config.hh"
+#include "tcp_segment.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+//! What a NetemAdapter has done to the segments written to it
+struct NetemStats
+{
+  uint64_t written {};       //!< Segments written to the NetemAdapter
+  uint64_t sent {};          //!< Segments it has passed on (duplicates included)
+  uint64_t lost {};          //!< Segments dropped by the Gilbert-Elliott loss
+  uint64_t queue_drops {};   //!< Segments dropped because the bandwidth cap's queue was full
+  uint64_t duplicated {};    //!< Segments sent twice
+  uint64_t reordered {};     //!< Segments that skipped the delay
+  size_t max_queue {};       //!< Most segments ever waiting for the bandwidth cap
+  uint64_t queue_wait_us {}; //!< Time segments have spent waiting for it, all told (by Little's law, the
+                             //!< queue's mean occupancy over a period is how much this grew, over the period)
+};
+
+//! \brief An adapter class that emulates a network link on the segments written to an FD adapter, as Linux's
+//! netem does on a device's outgoing packets.
+//!
+//! Each segment written is, in turn: lost (Gilbert-Elliott), duplicated, queued for a token-bucket bandwidth
+//! cap (dropped if the queue is full), and delayed (a fixed delay with jitter, unless it is picked to skip the
+//! delay and be reordered). Time is whatever tick() says it is, so the emulation runs as well in virtual time
+//! as in real time, and with a seed, it makes the same choices every run. Segments read are not touched: to
+//! emulate both directions of a link, each end writes through its own NetemAdapter.
+template<typename AdapterT>
+class NetemAdapter
+{
+private:
+  //! A segment waiting to be passed on, and when (the order breaks ties, so equal times keep their order)
+  struct Held
+  {
+    uint64_t release_us;
+    uint64_t order;
+    TCPMessage msg;
+
+    bool operator>( const Held& other ) const
+    {
+      return std::pair { release_us, order } > std::pair { other.release_us, other.order };
+    }
+  };
+
+  //! Bytes a segment occupies on the link: its payload, and the IPv4 and TCP headers (without options)
+  static constexpr size_t HEADERS_SIZE = 40;
+
+  //! The underlying FD adapter
+  AdapterT _adapter;
+
+  NetemConfig _cfg;
+  std::default_random_engine _rand;
+  NetemStats _stats {};
+
+  uint64_t _now_us {}; //!< Time, as told by tick()
+
+  bool _bad_state {}; //!< Is the Gilbert-Elliott chain in the bad state?
+
+  //! When each segment now in the bandwidth cap's queue leaves it (in order), and the token bucket's state
+  std::deque<uint64_t> _departures {};
+  double _tokens { std::numeric_limits<double>::infinity() }; // (the bucket starts full)
+  uint64_t _tokens_time_us {};
+
+  std::vector<Held> _held {}; //!< The segments not yet passed on: a min-heap, by when they will be
+  uint64_t _held_count {};    //!< Segments ever held (for their order)
+
+  bool _chance( double probability )
+  {
+    return probability > 0 and std::bernoulli_distribution { probability }( _rand );
+  }
+
+  //! Is the segment lost? (The chain moves first, then the segment sees the state it is in.)
+  bool _lost()
+  {
+    _bad_state = _bad_state ? not _chance( _cfg.gilbert_r ) : _chance( _cfg.gilbert_p );
+    return _chance( _bad_state ? _cfg.loss_bad : _cfg.loss_good );
+  }
+
+  //! When a segment of `size` bytes, arriving now, gets through the bandwidth cap (or nothing if it's dropped)
+  std::optional<uint64_t> _shape( size_t size )
+  {
+    while ( not _departures.empty() and _departures.front() <= _now_us ) {
+      _departures.pop_front();
+    }
+    if ( not _cfg.rate_bps ) {
+      return _now_us;
+    }
+    if ( _departures.size() >= _cfg.queue_limit ) {
+      _stats.queue_drops++;
+      return {};
+    }
+
+    // the segment starts when the one before it has left, and leaves once the bucket has enough tokens for it
+    const double bytes_per_us = static_cast<double>( _cfg.rate_bps ) / 8e6;
+    const double bucket = static_cast<double>( std::max<uint64_t>( _cfg.burst_bytes, size ) );
+    const uint64_t start = _departures.empty() ? _now_us : std::max( _now_us, _departures.back() );
+    _tokens = std::min( bucket, _tokens + static_cast<double>( start - _tokens_time_us ) * bytes_per_us );
+    uint64_t departure = start;
+    if ( _tokens < static_cast<double>( size ) ) {
+      departure += static_cast<uint64_t>( std::ceil( ( static_cast<double>( size ) - _tokens ) / bytes_per_us ) );
+      _tokens = static_cast<double>( size );
+    }
+    _tokens -= static_cast<double>( size );
+    _tokens_time_us = departure;
+
+    if ( departure > _now_us ) {
+      _stats.queue_wait_us += departure - _now_us;
+      _departures.push_back( departure );
+      _stats.max_queue = std::max( _stats.max_queue, _departures.size() );
+    }
+    return departure;
+  }
+
+  //! When a segment that got through the bandwidth cap at `departure` reaches the other end
+  uint64_t _delay( uint64_t departure )
+  {
+    if ( not _cfg.delay_ms and not _cfg.jitter_ms ) {
+      return departure;
+    }
+    if ( _chance( _cfg.reorder ) ) {
+      _stats.reordered++;
+      return departure;
+    }
+    const auto jitter = static_cast<int64_t>( _cfg.jitter_ms );
+    const int64_t delay_ms = static_cast<int64_t>( _cfg.delay_ms )
+                             + ( jitter ? std::uniform_int_distribution<int64_t> { -jitter, jitter }( _rand ) : 0 );
+    return departure + static_cast<uint64_t>( std::max<int64_t>( delay_ms, 0 ) ) * 1000;
+  }
+
+  void _send( const TCPMessage& seg )
+  {
+    const auto departure = _shape( seg.sender.payload.size() + HEADERS_SIZE );
+    if ( not departure.has_value() ) {
+      return;
+    }
+    const uint64_t release = _delay( departure.value() );
+    if ( release <= _now_us ) {
+      _stats.sent++;
+      _adapter.write( seg );
+      return;
+    }
+    _held.push_back( { release, _held_count++, seg } );
+    std::ranges::push_heap( _held, std::greater {} );
+  }
+
+public:
+  //! Construct from an adapter, and the link to emulate (whose probabilities must each be between 0 and 1)
+  NetemAdapter( AdapterT&& adapter, const NetemConfig& config )
+    : _adapter( std::move( adapter ) )
+    , _cfg( config )
+    , _rand( config.seed.has_value() ? std::default_random_engine( config.seed.value() ) : get_random_engine() )
+  {
+    for ( const double probability :
+          { _cfg.reorder, _cfg.duplicate, _cfg.gilbert_p, _cfg.gilbert_r, _cfg.loss_good, _cfg.loss_bad } ) {
+      if ( not( probability >= 0 and probability <= 1 ) ) { // (NaN included)
+        throw std::runtime_error( "NetemAdapter: probabilities must be between 0 and 1" );
+      }
+    }
+  }
+
+  //! Access the underlying AdapterT
+  AdapterT& inner() { return _adapter; }
+
+  //! Conversion to a FileDescriptor by returning the underlying AdapterT
+  FileDescriptor& fd() { return _adapter.fd(); }
+
+  //! Read from the underlying AdapterT instance (reads are not emulated)
+  std::optional<TCPMessage> read() { return _adapter.read(); }
+
+  //! Send a segment over the emulated link: now, later (once tick() says its time has come), or never
+  void write( const TCPMessage& seg )
+  {
+    _stats.written++;
+    if ( not _cfg.impaired() ) {
+      _stats.sent++;
+      return _adapter.write( seg );
+    }
+    if ( _lost() ) {
+      _stats.lost++;
+      return;
+    }
+    if ( _chance( _cfg.duplicate ) ) {
+      _stats.duplicated++;
+      _send( seg );
+    }
+    _send( seg );
+  }
+
+  //! Advance time, passing on every segment whose time has come (in the order they arrive at the other end)
+  void tick( const size_t ms_since_last_tick )
+  {
+    _adapter.tick( ms_since_last_tick );
+    _now_us += ms_since_last_tick * 1000;
+    while ( not _held.empty() and _held.front().release_us <= _now_us ) {
+      std::ranges::pop_heap( _held, std::greater {} );
+      _stats.sent++;
+      _adapter.write( _held.back().msg );
+      _held.pop_back();
+    }
+  }
+
+  //! How many ms until tick() would next pass a segment on (if any are waiting)?
+  std::optional<uint64_t> time_until_deadline() const
+  {
+    if ( _held.empty() ) {
+      return {};
+    }
+    return ( _held.front().release_us - _now_us + 999 ) / 1000;
+  }
+
+  //! Segments waiting for the bandwidth cap right now
+  size_t queue_occupancy() const
+  {
+    return static_cast<size_t>(
+      std::ranges::count_if( _departures, [&]( uint64_t departure ) { return departure > _now_us; } ) );
+  }
+
+  //! Segments written but not yet passed on (in the bandwidth cap's queue, or waiting out their delay)
+  size_t segments_held() const { return _held.size(); }
+
+  const NetemStats& stats() const { return _stats; }
+  const NetemConfig& netem_config() const { return _cfg; }
+
+  //! \name
+  //! Passthrough functions to the underlying AdapterT instance
+
+  void set_listening( const bool l ) { _adapter.set_listening( l ); } //!< FdAdapterBase::set_listening passthrough
+  const FdAdapterConfig& config() const { return _adapter.config(); } //!< FdAdapterBase::config passthrough
+  FdAdapterConfig& config_mut() { return _adapter.config_mut(); }     //!< FdAdapterBase::config_mut passthrough
+
+  //! FdAdapterBase::max_payload_size passthrough (unless emulating a link, whose packets are single segments)
+  size_t max_payload_size() const
+  {
+    return _cfg.impaired() ? TCPConfig::MAX_PAYLOAD_SIZE : _adapter.max_payload_size();
+  }
+};
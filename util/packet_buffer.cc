@@ -0,0 +1,60 @@
+#include "packet_buffer.hh"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+PacketBuffer::PacketBuffer( size_t capacity, size_t headroom )
+  : storage_( make_unique<char[]>( capacity ) ) // NOLINT(*-c-arrays)
+  , capacity_( capacity )
+  , headroom_( headroom )
+  , start_( headroom )
+  , end_( headroom )
+{
+  if ( headroom > capacity ) {
+    throw runtime_error( "PacketBuffer: headroom larger than capacity" );
+  }
+}
+
+PacketBuffer::PacketBuffer( const PacketBuffer& other )
+  : storage_( make_unique<char[]>( other.capacity_ ) ) // NOLINT(*-c-arrays)
+  , capacity_( other.capacity_ )
+  , headroom_( other.headroom_ )
+  , start_( other.start_ )
+  , end_( other.end_ )
+{
+  ranges::copy( other.contents(), storage_.get() + start_ );
+}
+
+PacketBuffer& PacketBuffer::operator=( const PacketBuffer& other )
+{
+  if ( this != &other ) {
+    *this = PacketBuffer { other };
+  }
+  return *this;
+}
+
+span<char> PacketBuffer::prepend( size_t len )
+{
+  if ( len > headroom() ) {
+    throw runtime_error( "PacketBuffer: not enough headroom to prepend " + to_string( len ) + " bytes" );
+  }
+  start_ -= len;
+  return { storage_.get() + start_, len };
+}
+
+span<char> PacketBuffer::append( size_t len )
+{
+  if ( len > tailroom() ) {
+    throw runtime_error( "PacketBuffer: not enough room to append " + to_string( len ) + " bytes" );
+  }
+  end_ += len;
+  return { storage_.get() + end_ - len, len };
+}
+
+void PacketBuffer::append( string_view data )
+{
+  ranges::copy( data, append( data.size() ).begin() );
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <string_view>
+
+//! A packet assembled in place in one fixed buffer
+//! \details An empty packet starts `headroom` bytes into the buffer. The payload is appended at the back, and
+//! then each layer prepends its header into the headroom in front of what is already there (innermost header
+//! first). The packet is always one contiguous region, and nothing is allocated after construction.
+class PacketBuffer
+{
+  std::unique_ptr<char[]> storage_; // NOLINT(*-c-arrays)
+  size_t capacity_;
+  size_t headroom_; // where an empty packet starts
+  size_t start_;    // where the packet starts now
+  size_t end_;      // where the packet ends
+
+public:
+  //! \param[in] capacity is the size of the whole buffer, headroom included
+  //! \param[in] headroom is room for the headers of every layer the packet will pass through
+  PacketBuffer( size_t capacity, size_t headroom );
+
+  //! A copy has a buffer of its own, with the same packet in the same place
+  PacketBuffer( const PacketBuffer& other );
+  PacketBuffer& operator=( const PacketBuffer& other );
+  PacketBuffer( PacketBuffer&& other ) = default;
+  PacketBuffer& operator=( PacketBuffer&& other ) = default;
+  ~PacketBuffer() = default;
+
+  //! Empty the packet, restoring all of the headroom
+  void clear() { start_ = end_ = headroom_; }
+
+  //! Grow the packet at the front by `len` bytes (e.g. for a header), and return them to be filled in
+  std::span<char> prepend( size_t len );
+
+  //! Grow the packet at the back by `len` bytes, and return them to be filled in
+  std::span<char> append( size_t len );
+
+  //! Copy `data` to the back of the packet
+  void append( std::string_view data );
+
+  //! The packet so far
+  std::string_view contents() const { return { storage_.get() + start_, end_ - start_ }; }
+
+  size_t size() const { return end_ - start_; }
+  size_t headroom() const { return start_; }
+  size_t tailroom() const { return capacity_ - end_; }
+};
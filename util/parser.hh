@@ -1,110 +1,181 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <bit>
 #include <concepts>
 #include <cstdint>
 #include <cstring>
-#include <deque>
 #include <numeric>
+#include <optional>
 #include <span>
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 
+// Load a big-endian (network byte order) integer from possibly unaligned memory
+template<std::unsigned_integral T>
+T load_big_endian( const char* data )
+{
+  T value {};
+  memcpy( &value, data, sizeof( T ) );
+  if constexpr ( std::endian::native == std::endian::little ) {
+    if constexpr ( sizeof( T ) == 2 ) {
+      value = __builtin_bswap16( value );
+    } else if constexpr ( sizeof( T ) == 4 ) {
+      value = __builtin_bswap32( value );
+    } else if constexpr ( sizeof( T ) == 8 ) {
+      value = __builtin_bswap64( value );
+    }
+  }
+  return value;
+}
+
+// Store an integer in big-endian (network byte order) to possibly unaligned memory
+template<std::unsigned_integral T>
+void store_big_endian( char* data, T value )
+{
+  if constexpr ( std::endian::native == std::endian::little ) {
+    if constexpr ( sizeof( T ) == 2 ) {
+      value = __builtin_bswap16( value );
+    } else if constexpr ( sizeof( T ) == 4 ) {
+      value = __builtin_bswap32( value );
+    } else if constexpr ( sizeof( T ) == 8 ) {
+      value = __builtin_bswap64( value );
+    }
+  }
+  memcpy( data, &value, sizeof( T ) );
+}
+
 class Parser
 {
+  // The unparsed input: views into the caller's buffers, which must outlive the Parser
   class BufferList
   {
     uint64_t size_ {};
-    std::deque<std::string> buffer_ {};
-    uint64_t skip_ {};
+    std::string_view front_ {};                // unparsed part of the current buffer (empty only if size_ == 0)
+    std::vector<std::string_view> owned_ {};    // views of the caller's strings (when given strings)
+    std::span<const std::string_view> rest_ {}; // buffers after the first (borrowed, or in owned_)
+    size_t next_ {};                            // index into rest_ of the buffer after front_
+
+    // move on to the next non-empty buffer once front_ is exhausted
+    void advance()
+    {
+      while ( front_.empty() and next_ < rest_.size() ) {
+        front_ = rest_[next_++];
+      }
+    }
+
+    void assign( std::span<const std::string_view> buffers )
+    {
+      if ( buffers.empty() ) {
+        return;
+      }
+      front_ = buffers.front();
+      rest_ = buffers.subspan( 1 );
+      size_ = front_.size();
+      for ( const auto buf : rest_ ) {
+        size_ += buf.size();
+      }
+      advance();
+    }
 
   public:
+    explicit BufferList( std::string_view buffer ) : size_( buffer.size() ), front_( buffer ) {}
+
+    // borrows the list itself too, so it must also outlive the Parser
+    explicit BufferList( std::span<const std::string_view> buffers ) { assign( buffers ); }
+
     explicit BufferList( const std::vector<std::string>& buffers )
+      : owned_( buffers.begin(), buffers.end() )
     {
-      for ( const auto& x : buffers ) {
-        append( x );
-      }
+      assign( owned_ );
     }
 
+    // (a temporary would be gone before the views into it are used)
+    explicit BufferList( std::string&& buffer ) = delete;
+    explicit BufferList( std::vector<std::string>&& buffers ) = delete;
+
+    // (a copy's rest_ would point into the original's owned_)
+    BufferList( const BufferList& other ) = delete;
+    BufferList& operator=( const BufferList& other ) = delete;
+    BufferList( BufferList&& other ) = default;
+    BufferList& operator=( BufferList&& other ) = default;
+    ~BufferList() = default;
+
     uint64_t size() const { return size_; }
     uint64_t serialized_length() const { return size(); }
     bool empty() const { return size_ == 0; }
 
     std::string_view peek() const
     {
-      if ( buffer_.empty() ) {
+      if ( empty() ) {
         throw std::runtime_error( "peek on empty BufferList" );
       }
-      return std::string_view { buffer_.front() }.substr( skip_ );
+      return front_;
     }
 
     void remove_prefix( uint64_t len )
     {
-      while ( len and not buffer_.empty() ) {
-        const uint64_t to_pop_now = std::min( len, peek().size() );
-        skip_ += to_pop_now;
+      while ( len and not empty() ) {
+        const uint64_t to_pop_now = std::min( len, front_.size() );
+        front_.remove_prefix( to_pop_now );
         len -= to_pop_now;
         size_ -= to_pop_now;
-        if ( skip_ == buffer_.front().size() ) {
-          buffer_.pop_front();
-          skip_ = 0;
-        }
+        advance();
       }
     }
 
-    void dump_all( std::vector<std::string>& out )
+    // Call `func` on each unparsed buffer in order (without allocating)
+    template<typename Func>
+    void for_each( Func&& func ) const
     {
-      out.clear();
       if ( empty() ) {
         return;
       }
-      std::string first_str = std::move( buffer_.front() );
-      if ( skip_ ) {
-        first_str = first_str.substr( skip_ );
-      }
-      out.emplace_back( std::move( first_str ) );
-      buffer_.pop_front();
-      for ( auto&& x : buffer_ ) {
-        out.emplace_back( std::move( x ) );
+      func( front_ );
+      for ( size_t i = next_; i < rest_.size(); i++ ) {
+        func( rest_[i] );
       }
     }
 
-    void dump_all( std::string& out )
+    void dump_all( std::vector<std::string>& out )
     {
-      std::vector<std::string> concat;
-      dump_all( concat );
-      if ( concat.size() == 1 ) {
-        out = std::move( concat.front() );
-        return;
-      }
+      out.clear();
+      for_each( [&]( std::string_view buf ) {
+        if ( not buf.empty() ) {
+          out.emplace_back( buf );
+        }
+      } );
+      remove_prefix( size_ );
+    }
 
+    void dump_all( std::vector<std::string_view>& out )
+    {
       out.clear();
-      for ( const auto& s : concat ) {
-        out.append( s );
-      }
+      for_each( [&]( std::string_view buf ) {
+        if ( not buf.empty() ) {
+          out.push_back( buf );
+        }
+      } );
+      remove_prefix( size_ );
     }
 
-    std::vector<std::string_view> buffer() const
+    void dump_all( std::string& out )
     {
-      if ( empty() ) {
-        return {};
-      }
-      std::vector<std::string_view> ret;
-      ret.reserve( buffer_.size() );
-      auto tmp_skip = skip_;
-      for ( const auto& x : buffer_ ) {
-        ret.push_back( std::string_view { x }.substr( tmp_skip ) );
-        tmp_skip = 0;
-      }
-      return ret;
+      out.clear();
+      out.reserve( size_ );
+      for_each( [&]( std::string_view buf ) { out.append( buf ); } );
+      remove_prefix( size_ );
     }
 
-    void append( std::string str )
+    std::vector<std::string_view> buffer() const
     {
-      size_ += str.size();
-      buffer_.push_back( std::move( str ) );
+      std::vector<std::string_view> ret;
+      for_each( [&]( std::string_view buf ) { ret.push_back( buf ); } );
+      return ret;
     }
   };
 
@@ -119,7 +190,15 @@ class Parser
   }
 
 public:
+  // The Parser borrows its input rather than copying it: the buffers must outlive the Parser, so temporaries
+  // aren't accepted
   explicit Parser( const std::vector<std::string>& input ) : input_( input ) {}
+  explicit Parser( std::string_view input ) : input_( input ) {}
+  // (the list of views is borrowed as well as the buffers, and must also outlive the Parser)
+  explicit Parser( std::span<const std::string_view> input ) : input_( input ) {}
+
+  explicit Parser( std::string&& input ) = delete;
+  explicit Parser( std::vector<std::string>&& input ) = delete;
 
   const BufferList& input() const { return input_; }
 
@@ -135,18 +214,41 @@ public:
       return;
     }
 
-    if constexpr ( sizeof( T ) == 1 ) {
-      out = static_cast<uint8_t>( input_.peek().front() );
-      input_.remove_prefix( 1 );
+    // fast path: the whole field is in the current buffer
+    const std::string_view front = input_.peek();
+    if ( front.size() >= sizeof( T ) ) {
+      out = load_big_endian<T>( front.data() );
+      input_.remove_prefix( sizeof( T ) );
       return;
-    } else {
-      out = static_cast<T>( 0 );
-      for ( size_t i = 0; i < sizeof( T ); i++ ) {
-        out <<= 8;
-        out |= static_cast<uint8_t>( input_.peek().front() );
-        input_.remove_prefix( 1 );
-      }
     }
+
+    // slow path: the field is split across buffers
+    out = static_cast<T>( 0 );
+    for ( size_t i = 0; i < sizeof( T ); i++ ) {
+      out <<= 8;
+      out |= static_cast<uint8_t>( input_.peek().front() );
+      input_.remove_prefix( 1 );
+    }
+  }
+
+  // The next N bytes (consumed) as one span of fixed size: a view into the current buffer if they are all
+  // there, otherwise a copy in `scratch`. Empty (and the error is set) if fewer than N bytes remain.
+  template<size_t N>
+  std::optional<std::span<const char, N>> fixed( std::array<char, N>& scratch )
+  {
+    check_size( N );
+    if ( has_error() ) {
+      return {};
+    }
+
+    const std::string_view front = input_.peek();
+    if ( front.size() >= N ) {
+      input_.remove_prefix( N );
+      return std::span<const char, N> { front.data(), N };
+    }
+
+    string( scratch );
+    return std::span<const char, N> { scratch };
   }
 
   void string( std::span<char> out )
@@ -166,7 +268,31 @@ public:
 
   void all_remaining( std::vector<std::string>& out ) { input_.dump_all( out ); }
   void all_remaining( std::string& out ) { input_.dump_all( out ); }
+  // Views of the rest of the input, aliasing the caller's buffers (nothing is copied)
+  void all_remaining( std::vector<std::string_view>& out ) { input_.dump_all( out ); }
+
+  // The rest of the input as one view (nothing is copied, or allocated); an error if it isn't in one buffer
+  void all_remaining( std::string_view& out )
+  {
+    out = {};
+    if ( input_.empty() ) {
+      return;
+    }
+    if ( input_.peek().size() != input_.size() ) {
+      set_error();
+      return;
+    }
+    out = input_.peek();
+    input_.remove_prefix( out.size() );
+  }
   std::vector<std::string_view> buffer() const { return input_.buffer(); }
+
+  // Call `func` on each unparsed buffer in order (without allocating)
+  template<typename Func>
+  void for_each_buffer( Func&& func ) const
+  {
+    input_.for_each( std::forward<Func>( func ) );
+  }
 };
 
 class Serializer
@@ -174,13 +300,35 @@ class Serializer
   std::vector<std::string> output_ {};
   std::string buffer_ {};
 
+  // In span mode, the caller's buffer (written front to back, in place of output_) and how much is written
+  std::optional<std::span<char>> out_ {};
+  size_t written_ {};
+
+  // Claim the next `len` bytes of the caller's buffer
+  std::span<char> claim( size_t len )
+  {
+    if ( len > out_->size() - written_ ) {
+      throw std::runtime_error( "Serializer: output buffer too small" );
+    }
+    written_ += len;
+    return out_->subspan( written_ - len, len );
+  }
+
 public:
   Serializer() = default;
   explicit Serializer( std::string&& buffer ) : buffer_( std::move( buffer ) ) {}
 
+  // Span mode: serialize straight into `out` (e.g. a header's place in a PacketBuffer), allocating nothing
+  explicit Serializer( std::span<char> out ) : out_( out ) {}
+
   template<std::unsigned_integral T>
   void integer( const T val )
   {
+    if ( out_ ) {
+      store_big_endian( claim( sizeof( T ) ).data(), val );
+      return;
+    }
+
     constexpr uint64_t len = sizeof( T );
 
     for ( uint64_t i = 0; i < len; ++i ) {
@@ -189,8 +337,23 @@ public:
     }
   }
 
+  // Append bytes already in wire format (e.g. a header serialized by a HeaderLayout)
+  void bytes( std::string_view data )
+  {
+    if ( out_ ) {
+      std::ranges::copy( data, claim( data.size() ).begin() );
+      return;
+    }
+    buffer_.append( data );
+  }
+
   void buffer( std::string buf )
   {
+    if ( out_ ) {
+      bytes( buf );
+      return;
+    }
+
     flush();
     if ( not buf.empty() ) {
       output_.push_back( std::move( buf ) );
@@ -214,9 +377,15 @@ public:
 
   const std::vector<std::string>& output()
   {
+    if ( out_ ) {
+      throw std::runtime_error( "Serializer: no output() in span mode (the output is the caller's buffer)" );
+    }
     flush();
     return output_;
   }
+
+  // In span mode, the number of bytes of the caller's buffer written so far
+  size_t bytes_written() const { return written_; }
 };
 
 // Helper to serialize any object (without constructing a Serializer of the caller's own)
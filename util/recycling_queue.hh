@@ -0,0 +1,68 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+//! \brief A FIFO queue that keeps popped elements around to be reused, instead of destroying them.
+//!
+//! New elements are built in place in a recycled slot (next_slot(), then push_next()), so whatever the element
+//! owns (e.g. the capacity of a std::string payload) is reused too: once the queue has grown as long as it
+//! ever needs to be, pushing and popping allocate nothing.
+template<class T>
+class RecyclingQueue
+{
+  std::vector<T> slots_ {}; // a ring: the queue is `size_` slots starting at `head_`; the rest are free
+  size_t head_ {};
+  size_t size_ {};
+
+public:
+  bool empty() const { return size_ == 0; }
+  size_t size() const { return size_; }
+
+  T& front()
+  {
+    if ( empty() ) {
+      throw std::runtime_error( "RecyclingQueue::front(): queue is empty" );
+    }
+    return slots_[head_];
+  }
+
+  const T& front() const
+  {
+    if ( empty() ) {
+      throw std::runtime_error( "RecyclingQueue::front(): queue is empty" );
+    }
+    return slots_[head_];
+  }
+
+  //! The slot that push_next() will add to the back of the queue. It holds whatever was last popped from it
+  //! (or a default-constructed T), for the caller to overwrite.
+  T& next_slot()
+  {
+    if ( size_ == slots_.size() ) {
+      std::rotate( slots_.begin(), slots_.begin() + static_cast<std::ptrdiff_t>( head_ ), slots_.end() );
+      head_ = 0;
+      slots_.emplace_back();
+    }
+    return slots_[( head_ + size_ ) % slots_.size()];
+  }
+
+  //! Add next_slot() to the back of the queue
+  void push_next()
+  {
+    next_slot();
+    size_++;
+  }
+
+  //! Remove the front element (which stays in its slot, to be reused)
+  void pop()
+  {
+    if ( empty() ) {
+      throw std::runtime_error( "RecyclingQueue::pop(): queue is empty" );
+    }
+    head_ = ( head_ + 1 ) % slots_.size();
+    size_--;
+  }
+};
@@ -32,3 +32,33 @@ public:
   uint16_t loss_rate_dn = 0; //!< Downlink loss rate (for LossyFdAdapter)
   uint16_t loss_rate_up = 0; //!< Uplink loss rate (for LossyFdAdapter)
 };
+
+//! Config for NetemAdapter: the link it emulates for outgoing segments (by default, a perfect one)
+class NetemConfig
+{
+public:
+  uint64_t delay_ms = 0;  //!< Fixed delay added to every segment
+  uint64_t jitter_ms = 0; //!< Each segment's delay varies uniformly by up to this much either way
+
+  uint64_t rate_bps = 0;     //!< Bandwidth cap, in bits per second (0 for none)
+  uint64_t burst_bytes = 0;  //!< Token bucket size (at least one segment): a burst this large goes out at once
+  size_t queue_limit = 1000; //!< Segments that can wait for the bandwidth cap; more are dropped from the tail
+
+  double reorder = 0;   //!< Probability that a segment skips the delay, overtaking those delayed before it
+  double duplicate = 0; //!< Probability that a segment is sent twice
+
+  //! Gilbert-Elliott loss: a two-state Markov chain, with a loss probability in each state. (With `gilbert_p` at
+  //! zero, the chain stays in the good state, and `loss_good` is a plain loss rate.)
+  double gilbert_p = 0; //!< Probability of going from the good state to the bad one, per segment
+  double gilbert_r = 1; //!< Probability of going from the bad state back to the good one, per segment
+  double loss_good = 0; //!< Loss probability in the good state
+  double loss_bad = 1;  //!< Loss probability in the bad state
+
+  std::optional<uint64_t> seed {}; //!< Seed for the random choices (if unset, a random one)
+
+  //! Does the link do anything to segments?
+  bool impaired() const
+  {
+    return delay_ms or jitter_ms or rate_bps or reorder > 0 or duplicate > 0 or gilbert_p > 0 or loss_good > 0;
+  }
+};
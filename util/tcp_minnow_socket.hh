@@ -1,16 +1,22 @@
 #pragma once
 
+#include "byte_ring_channel.hh"
 #include "byte_stream.hh"
+#include "eventfd.hh"
 #include "eventloop.hh"
 #include "file_descriptor.hh"
 #include "socket.hh"
 #include "tcp_config.hh"
 #include "tcp_peer.hh"
+#include "timerfd.hh"
 #include "tuntap_adapter.hh"
 
 #include <atomic>
+#include <chrono>
 #include <cstdint>
+#include <memory>
 #include <optional>
+#include <string_view>
 #include <thread>
 #include <vector>
 
@@ -58,6 +64,24 @@ public:
   // Return peer address from underlying datagram adapter
   const Address& peer_address() const { return _datagram_adapter.config().destination; }
 
+  //! \name
+  //! Optional in-process outbound channel: instead of writing to the socket, the owner copies bytes straight
+  //! into a ring that the TCPPeer thread drains, avoiding the two kernel copies of the socketpair.
+
+  //!@{
+  //! Switch the outbound direction to a shared ring of (at least) `capacity` bytes; call before connecting
+  void enable_outbound_ring( size_t capacity = TCPConfig::DEFAULT_CAPACITY );
+
+  //! Copy as much of `data` as currently fits into the ring; returns the number of bytes accepted
+  size_t write_outbound( std::string_view data );
+
+  //! Copy all of `data` into the ring, blocking while the ring is full
+  void write_outbound_all( std::string_view data );
+
+  //! End the outbound stream (the outbound-ring equivalent of `shutdown( SHUT_WR )`)
+  void close_outbound();
+  //!@}
+
 protected:
   //! Adapter to underlying datagram socket (e.g., UDP or IP)
   AdaptT _datagram_adapter;
@@ -66,15 +90,42 @@ private:
   //! Stream socket for reads and writes between owner and TCP thread
   LocalStreamSocket _thread_data;
 
+  //! Shared ring from owner to TCP thread (present only in outbound-ring mode)
+  std::unique_ptr<ByteRingChannel> _outbound_ring {};
+
   //! Set up the TCPPeer and the event loop
   void _initialize_TCP( const TCPConfig& config );
 
   //! TCP state machine
   std::optional<TCPPeer> _tcp {};
 
+  //! Segments read from the network in one wakeup, given to the TCPPeer together
+  std::vector<TCPMessage> _rx_batch {};
+
+  //! Segments generated while processing a batch of inbound datagrams, sent once the batch is done. Only the
+  //! first _tx_batch_size are in the batch: the rest are kept, with their payloads' buffers, for later batches.
+  std::vector<TCPMessage> _tx_batch {};
+  size_t _tx_batch_size {};
+
+  //! Add a copy of `msg` to _tx_batch (into a kept slot, if there is one, so that nothing is allocated)
+  void _queue_tx( const TCPMessage& msg );
+
+  //! Send (and empty) _tx_batch, leaving out pure ACKs that a later segment of the batch supersedes, and
+  //! merging consecutive data segments into super-segments if the adapter supports segmentation offload
+  void _flush_tx_batch();
+
   //! eventloop that handles all the events (new inbound datagram, new outbound bytes, new inbound bytes)
   EventLoop _eventloop {};
 
+  //! Armed for the TCPPeer's next deadline, so an idle connection sleeps instead of polling
+  TimerFD _tick_timer {};
+
+  //! When _tick_timer is due to fire (if it is armed)
+  std::optional<std::chrono::steady_clock::time_point> _tick_timer_target {};
+
+  //! Lets the owner interrupt a TCPPeer thread that is sleeping with no deadline (e.g., to abort)
+  EventFD _wakeup {};
+
   //! Process events while specified condition is true
   void _tcp_loop( const std::function<bool()>& condition );
 
@@ -15,35 +15,57 @@
 #include <unistd.h>
 #include <utility>
 
-static constexpr size_t TCP_TICK_MS = 10;
-
-inline uint64_t timestamp_ms()
-{
-  static_assert( std::is_same<std::chrono::steady_clock::duration, std::chrono::nanoseconds>::value );
-
-  return std::chrono::steady_clock::now().time_since_epoch().count() / 1000000;
-}
+//! Maximum number of inbound datagrams handled per wakeup before replies are sent
+static constexpr size_t TCP_RX_BATCH = 32;
 
 //! \param[in] condition is a function returning true if loop should continue
 template<TCPDatagramAdapter AdaptT>
 void TCPMinnowSocket<AdaptT>::_tcp_loop( const std::function<bool()>& condition )
 {
-  auto base_time = timestamp_ms();
+  using namespace std::chrono;
+
+  auto base_time = steady_clock::now();
+  nanoseconds carry {}; // time that has passed since the last tick, but less than a whole millisecond
   while ( condition() ) {
-    auto ret = _eventloop.wait_next_event( TCP_TICK_MS );
+    if ( not _tcp.has_value() ) {
+      throw std::runtime_error( "_tcp_loop entered before TCPPeer initialized" );
+    }
+
+    // Sleep until the earliest deadline of the TCPPeer (or of the adapter, if it has any), or indefinitely if
+    // there is none
+    auto deadline = _tcp->active() ? _tcp->time_until_deadline() : std::nullopt;
+    if constexpr ( requires { _datagram_adapter.time_until_deadline(); } ) {
+      if ( const auto adapter_deadline = _datagram_adapter.time_until_deadline(); adapter_deadline.has_value() ) {
+        deadline = std::min( deadline.value_or( UINT64_MAX ), adapter_deadline.value() );
+      }
+    }
+    std::optional<steady_clock::time_point> target;
+    if ( deadline.has_value() ) {
+      target = base_time - carry + milliseconds { deadline.value() };
+    }
+    if ( target != _tick_timer_target ) {
+      if ( target.has_value() ) {
+        _tick_timer.arm( target.value() - steady_clock::now() );
+      } else {
+        _tick_timer.disarm();
+      }
+      _tick_timer_target = target;
+    }
+
+    auto ret = _eventloop.wait_next_event( -1 );
     if ( ret == EventLoop::Result::Exit or _abort ) {
       break;
     }
 
-    if ( not _tcp.has_value() ) {
-      throw std::runtime_error( "_tcp_loop entered before TCPPeer initialized" );
-    }
+    const auto next_time = steady_clock::now();
+    carry += next_time - base_time;
+    base_time = next_time;
+    const auto elapsed = duration_cast<milliseconds>( carry );
+    carry -= elapsed;
 
-    if ( _tcp.value().active() ) {
-      const auto next_time = timestamp_ms();
-      _tcp.value().tick( next_time - base_time, [&]( auto x ) { _datagram_adapter.write( x ); } );
-      _datagram_adapter.tick( next_time - base_time );
-      base_time = next_time;
+    if ( _tcp.value().active() and elapsed.count() > 0 ) {
+      _tcp.value().tick( elapsed.count(), [&]( const TCPMessage& x ) { _datagram_adapter.write( x ); } );
+      _datagram_adapter.tick( elapsed.count() );
     }
   }
 }
@@ -73,25 +95,42 @@ void TCPMinnowSocket<AdaptT>::_initialize_TCP( const TCPConfig& config )
   // 1) Incoming datagram received (needs to be given to TCPPeer::receive method)
   //
   // 2) Outbound bytes received from local application via a write()
-  //    call (needs to be read from the local stream socket and
-  //    given to TCPPeer)
+  //    call (needs to be read from the local stream socket, or drained
+  //    from the shared ring in outbound-ring mode, and given to TCPPeer)
   //
   // 3) Incoming bytes reassembled by the Reassembler
   //    (needs to be read from the inbound_stream and written
   //    to the local stream socket back to the application)
+  //
+  // Two more fds only exist to wake up the loop: the timer armed
+  // for the TCPPeer's next deadline, and the owner's abort signal.
 
   // rule 1: read from filtered packet stream and dump into TCPConnection
+  // Drains up to TCP_RX_BATCH datagrams per wakeup and gives them to the TCPPeer as one batch; the reply
+  // (and any data the new ACKs let us send) goes out once, after the whole batch has been processed.
+  _datagram_adapter.fd().set_blocking( false );
+  _rx_batch.reserve( TCP_RX_BATCH );
+  _tx_batch.reserve( 2 * TCP_RX_BATCH );
   _eventloop.add_rule(
     "receive TCP segment from the network",
     _datagram_adapter.fd(),
     Direction::In,
     [&] {
-      if ( auto seg = _datagram_adapter.read() ) {
-        _tcp->receive( std::move( seg.value() ), [&]( auto x ) { _datagram_adapter.write( x ); } );
+      for ( size_t i = 0; i < TCP_RX_BATCH; ++i ) {
+        const auto reads_before = _datagram_adapter.fd().read_count();
+        if ( auto seg = _datagram_adapter.read() ) {
+          _rx_batch.push_back( std::move( seg.value() ) );
+        }
+        if ( _datagram_adapter.fd().read_count() == reads_before ) {
+          break; // nothing more to read right now
+        }
       }
+      _tcp->receive_batch( _rx_batch, [&]( const TCPMessage& x ) { _queue_tx( x ); } );
+      _rx_batch.clear();
+      _flush_tx_batch();
 
       // debugging output:
-      if ( _thread_data.eof() and _tcp.value().sender().sequence_numbers_in_flight() == 0 and not _fully_acked ) {
+      if ( _outbound_shutdown and _tcp.value().sender().sequence_numbers_in_flight() == 0 and not _fully_acked ) {
         std::cerr << "DEBUG: minnow outbound stream to " << _datagram_adapter.config().destination.to_string()
                   << " has been fully acknowledged.\n";
         _fully_acked = true;
@@ -99,42 +138,84 @@ void TCPMinnowSocket<AdaptT>::_initialize_TCP( const TCPConfig& config )
     },
     [&] { return _tcp->active(); } );
 
-  // rule 2: read from pipe into outbound buffer
-  _eventloop.add_rule(
-    "push bytes to TCPPeer",
-    _thread_data,
-    Direction::In,
-    [&] {
-      std::string data;
-      data.resize( _tcp->outbound_writer().available_capacity() );
-      _thread_data.read( data );
-      _tcp->outbound_writer().push( move( data ) );
-
-      if ( _thread_data.eof() ) {
+  // rule 2: read from pipe (or shared ring) into outbound buffer
+  if ( _outbound_ring ) {
+    _eventloop.add_rule(
+      "push bytes from outbound ring to TCPPeer",
+      _outbound_ring->ready(),
+      Direction::In,
+      [&] {
+        ByteRingChannel& ring = *_outbound_ring;
+        Writer& outbound = _tcp->outbound_writer();
+
+        // The owner only signals when the ring stops being empty, so if we leave bytes behind
+        // (outbound stream full), re-arm the wakeup ourselves for when capacity frees up.
+        ring.ready().drain();
+        while ( ring.bytes_buffered() and outbound.available_capacity() ) {
+          const auto view = ring.peek().substr( 0, outbound.available_capacity() );
+          outbound.push( std::string { view } );
+          ring.pop( view.size() );
+        }
+        if ( ring.bytes_buffered() ) {
+          ring.ready().notify();
+        }
+
+        if ( ring.is_finished() ) {
+          outbound.close();
+          _outbound_shutdown = true;
+
+          // debugging output:
+          std::cerr << "DEBUG: minnow outbound stream to " << _datagram_adapter.config().destination.to_string()
+                    << " finished (" << _tcp.value().sender().sequence_numbers_in_flight() << " seqno"
+                    << ( _tcp.value().sender().sequence_numbers_in_flight() == 1 ? "" : "s" )
+                    << " still in flight).\n";
+        }
+
+        _tcp->push( [&]( const TCPMessage& x ) { _queue_tx( x ); } );
+        _flush_tx_batch();
+      },
+      [&] {
+        return ( _tcp->active() ) and ( not _outbound_shutdown )
+               and ( _tcp->outbound_writer().available_capacity() > 0 );
+      } );
+  } else {
+    _eventloop.add_rule(
+      "push bytes to TCPPeer",
+      _thread_data,
+      Direction::In,
+      [&] {
+        std::string data;
+        data.resize( _tcp->outbound_writer().available_capacity() );
+        _thread_data.read( data );
+        _tcp->outbound_writer().push( move( data ) );
+
+        if ( _thread_data.eof() ) {
+          _tcp->outbound_writer().close();
+          _outbound_shutdown = true;
+
+          // debugging output:
+          std::cerr << "DEBUG: minnow outbound stream to " << _datagram_adapter.config().destination.to_string()
+                    << " finished (" << _tcp.value().sender().sequence_numbers_in_flight() << " seqno"
+                    << ( _tcp.value().sender().sequence_numbers_in_flight() == 1 ? "" : "s" )
+                    << " still in flight).\n";
+        }
+
+        _tcp->push( [&]( const TCPMessage& x ) { _queue_tx( x ); } );
+        _flush_tx_batch();
+      },
+      [&] {
+        return ( _tcp->active() ) and ( not _outbound_shutdown )
+               and ( _tcp->outbound_writer().available_capacity() > 0 );
+      },
+      [&] {
         _tcp->outbound_writer().close();
         _outbound_shutdown = true;
-
-        // debugging output:
-        std::cerr << "DEBUG: minnow outbound stream to " << _datagram_adapter.config().destination.to_string()
-                  << " finished (" << _tcp.value().sender().sequence_numbers_in_flight() << " seqno"
-                  << ( _tcp.value().sender().sequence_numbers_in_flight() == 1 ? "" : "s" )
-                  << " still in flight).\n";
-      }
-
-      _tcp->push( [&]( auto x ) { _datagram_adapter.write( x ); } );
-    },
-    [&] {
-      return ( _tcp->active() ) and ( not _outbound_shutdown )
-             and ( _tcp->outbound_writer().available_capacity() > 0 );
-    },
-    [&] {
-      _tcp->outbound_writer().close();
-      _outbound_shutdown = true;
-    },
-    [&] {
-      std::cerr << "DEBUG: minnow outbound stream had error.\n";
-      _tcp->outbound_writer().set_error();
-    } );
+      },
+      [&] {
+        std::cerr << "DEBUG: minnow outbound stream had error.\n";
+        _tcp->outbound_writer().set_error();
+      } );
+  }
 
   // rule 3: read from inbound buffer into pipe
   _eventloop.add_rule(
@@ -171,6 +252,79 @@ void TCPMinnowSocket<AdaptT>::_initialize_TCP( const TCPConfig& config )
       std::cerr << "DEBUG: minnow inbound stream had error.\n";
       _tcp->inbound_reader().set_error();
     } );
+
+  // rule 4: the TCPPeer has a deadline (the ticking itself happens in _tcp_loop after every event)
+  _eventloop.add_rule(
+    "TCP timer expired",
+    _tick_timer,
+    Direction::In,
+    [&] {
+      _tick_timer.drain();
+      _tick_timer_target.reset();
+    },
+    [&] { return _tcp->active(); } );
+
+  // rule 5: the owner wants the TCPPeer thread's attention
+  _eventloop.add_rule(
+    "wake up TCPPeer thread",
+    _wakeup,
+    Direction::In,
+    [&] { _wakeup.drain(); },
+    [&] { return _tcp->active() or not _inbound_shutdown; } );
+}
+
+template<TCPDatagramAdapter AdaptT>
+void TCPMinnowSocket<AdaptT>::_queue_tx( const TCPMessage& msg )
+{
+  if ( _tx_batch_size < _tx_batch.size() ) {
+    _tx_batch[_tx_batch_size] = msg;
+  } else {
+    _tx_batch.push_back( msg );
+  }
+  _tx_batch_size++;
+}
+
+template<TCPDatagramAdapter AdaptT>
+void TCPMinnowSocket<AdaptT>::_flush_tx_batch()
+{
+  // If the adapter takes super-segments (segmentation offload), a run of consecutive full-sized segments goes
+  // out as one, carrying the last segment's ackno and window (which are at least as new as the others').
+  const size_t max_payload = _datagram_adapter.max_payload_size();
+  const auto extends = [&]( const TCPMessage& run, const TCPMessage& next ) {
+    return max_payload > TCPConfig::MAX_PAYLOAD_SIZE and not run.sender.SYN and not run.sender.FIN
+           and not run.sender.RST and not run.receiver.RST and not run.sender.payload.empty()
+           and run.sender.payload.size() % TCPConfig::MAX_PAYLOAD_SIZE == 0 and not next.sender.SYN
+           and not next.sender.RST and not next.receiver.RST and not next.sender.payload.empty()
+           and run.sender.payload.size() + next.sender.payload.size() <= max_payload
+           and next.sender.seqno == run.sender.seqno + run.sender.sequence_length();
+  };
+
+  TCPMessage* run = nullptr;
+  for ( size_t i = 0; i < _tx_batch_size; ++i ) {
+    // Every segment carries the receiver's latest ackno and window, so an empty, non-RST segment is
+    // redundant if anything else follows it in the batch.
+    TCPMessage& msg = _tx_batch[i];
+    if ( i + 1 < _tx_batch_size and msg.sender.sequence_length() == 0 and not msg.sender.RST ) {
+      continue;
+    }
+
+    if ( run and extends( *run, msg ) ) {
+      run->sender.payload.append( msg.sender.payload );
+      run->sender.payload_sum.reset();
+      run->sender.FIN = msg.sender.FIN;
+      run->receiver = msg.receiver;
+      continue;
+    }
+
+    if ( run ) {
+      _datagram_adapter.write( *run );
+    }
+    run = &msg;
+  }
+  if ( run ) {
+    _datagram_adapter.write( *run );
+  }
+  _tx_batch_size = 0;
 }
 
 //! \brief Call [socketpair](\ref man2::socketpair) and return connected Unix-domain sockets of specified type
@@ -199,6 +353,7 @@ TCPMinnowSocket<AdaptT>::~TCPMinnowSocket()
       std::cerr << "Warning: unclean shutdown of TCPMinnowSocket\n";
       // force the other side to exit
       _abort.store( true );
+      _wakeup.notify();
       _tcp_thread.join();
     }
   } catch ( const std::exception& e ) {
@@ -206,9 +361,51 @@ TCPMinnowSocket<AdaptT>::~TCPMinnowSocket()
   }
 }
 
+template<TCPDatagramAdapter AdaptT>
+void TCPMinnowSocket<AdaptT>::enable_outbound_ring( const size_t capacity )
+{
+  if ( _tcp ) {
+    throw std::runtime_error( "enable_outbound_ring() with TCPConnection already initialized" );
+  }
+
+  _outbound_ring = std::make_unique<ByteRingChannel>( capacity );
+}
+
+//! \param[in] data is the outbound payload; bytes that don't fit are left to the caller
+//! \returns the number of bytes accepted into the ring
+template<TCPDatagramAdapter AdaptT>
+size_t TCPMinnowSocket<AdaptT>::write_outbound( const std::string_view data )
+{
+  if ( not _outbound_ring ) {
+    throw std::runtime_error( "write_outbound() without enable_outbound_ring()" );
+  }
+  return _outbound_ring->write( data );
+}
+
+template<TCPDatagramAdapter AdaptT>
+void TCPMinnowSocket<AdaptT>::write_outbound_all( const std::string_view data )
+{
+  if ( not _outbound_ring ) {
+    throw std::runtime_error( "write_outbound_all() without enable_outbound_ring()" );
+  }
+  _outbound_ring->write_all( data );
+}
+
+template<TCPDatagramAdapter AdaptT>
+void TCPMinnowSocket<AdaptT>::close_outbound()
+{
+  if ( not _outbound_ring ) {
+    throw std::runtime_error( "close_outbound() without enable_outbound_ring()" );
+  }
+  _outbound_ring->close();
+}
+
 template<TCPDatagramAdapter AdaptT>
 void TCPMinnowSocket<AdaptT>::wait_until_closed()
 {
+  if ( _outbound_ring ) {
+    close_outbound();
+  }
   shutdown( SHUT_RDWR );
   if ( _tcp_thread.joinable() ) {
     std::cerr << "DEBUG: minnow waiting for clean shutdown... ";
@@ -236,7 +433,7 @@ void TCPMinnowSocket<AdaptT>::connect( const TCPConfig& c_tcp, const FdAdapterCo
     throw std::runtime_error( "TCPPeer not successfully initialized" );
   }
 
-  _tcp->push( [&]( auto x ) { _datagram_adapter.write( x ); } );
+  _tcp->push( [&]( const TCPMessage& x ) { _datagram_adapter.write( x ); } );
 
   if ( _tcp->sender().sequence_numbers_in_flight() != 1 ) {
     throw std::runtime_error( "After TCPConnection::connect(), expected sequence_numbers_in_flight() == 1" );
@@ -282,6 +479,9 @@ void TCPMinnowSocket<AdaptT>::_tcp_main()
     }
     _tcp_loop( [] { return true; } );
     shutdown( SHUT_RDWR );
+    if ( _outbound_ring ) {
+      _outbound_ring->set_consumer_done();
+    }
     if ( not _tcp.value().active() ) {
       std::cerr << "DEBUG: minnow TCP connection finished "
                 << ( _tcp->inbound_reader().has_error() ? "uncleanly.\n" : "cleanly.\n" );
@@ -24,26 +24,62 @@ using namespace std;
 //! from the TCP header; it uses this information to filter future reads.
 //! \returns a std::optional<TCPSegment> that is empty if the segment was invalid or unrelated
 optional<TCPMessage> TCPOverIPv4Adapter::unwrap_tcp_in_ip( const InternetDatagram& ip_dgram )
+{
+  Parser payload { ip_dgram.payload };
+  return unwrap_tcp_in_ip( ip_dgram.header, payload, true );
+}
+
+optional<TCPMessage> TCPOverIPv4Adapter::unwrap_tcp_in_ip( string_view datagram, bool verify_checksum )
+{
+  Parser parser { datagram };
+  IPv4Header header;
+  header.parse( parser );
+  if ( parser.has_error() ) {
+    return {};
+  }
+  return unwrap_tcp_in_ip( header, parser, verify_checksum );
+}
+
+optional<TCPMessage> TCPOverIPv4Adapter::unwrap_tcp_in_ip( const IPv4DatagramView& ip_dgram )
+{
+  Parser payload { ip_dgram.payload };
+  return unwrap_tcp_in_ip( ip_dgram.header, payload, true );
+}
+
+optional<TCPMessage> TCPOverIPv4Adapter::unwrap_tcp_in_ip( const IPv4Header& header,
+                                                            Parser& payload,
+                                                            bool verify_checksum )
 {
   // is the IPv4 datagram for us?
   // Note: it's valid to bind to address "0" (INADDR_ANY) and reply from actual address contacted
-  if ( not listening() and ( ip_dgram.header.dst != config().source.ipv4_numeric() ) ) {
+  if ( not listening() and ( header.dst != config().source.ipv4_numeric() ) ) {
     return {};
   }
 
   // is the IPv4 datagram from our peer?
-  if ( not listening() and ( ip_dgram.header.src != config().destination.ipv4_numeric() ) ) {
+  if ( not listening() and ( header.src != config().destination.ipv4_numeric() ) ) {
     return {};
   }
 
   // does the IPv4 datagram claim that its payload is a TCP segment?
-  if ( ip_dgram.header.proto != IPv4Header::PROTO_TCP ) {
+  if ( header.proto != IPv4Header::PROTO_TCP ) {
     return {};
   }
 
+  // is it a fragment? (if so, wait for the rest of the datagram, and then check the TCP segment it carries)
+  if ( IPv4Reassembler::is_fragment( header ) ) {
+    const auto whole = _reassembler.push( header, payload );
+    if ( not whole.has_value() ) {
+      return {};
+    }
+    Parser reassembled { whole->second };
+    return unwrap_tcp_in_ip( whole->first, reassembled, true );
+  }
+
   // is the payload a valid TCP segment?
   TCPSegment tcp_seg;
-  if ( not parse( tcp_seg, ip_dgram.payload, ip_dgram.header.pseudo_checksum() ) ) {
+  tcp_seg.parse( payload, header.pseudo_checksum(), verify_checksum );
+  if ( payload.has_error() ) {
     return {};
   }
 
@@ -55,9 +91,9 @@ optional<TCPMessage> TCPOverIPv4Adapter::unwrap_tcp_in_ip( const InternetDatagra
   // should we target this source addr/port (and use its destination addr as our source) in reply?
   if ( listening() ) {
     if ( tcp_seg.message.sender.SYN and not tcp_seg.message.sender.RST ) {
-      config_mutable().source = Address { inet_ntoa( { htobe32( ip_dgram.header.dst ) } ), config().source.port() };
+      config_mutable().source = Address { inet_ntoa( { htobe32( header.dst ) } ), config().source.port() };
       config_mutable().destination
-        = Address { inet_ntoa( { htobe32( ip_dgram.header.src ) } ), tcp_seg.udinfo.src_port };
+        = Address { inet_ntoa( { htobe32( header.src ) } ), tcp_seg.udinfo.src_port };
       set_listening( false );
     } else {
       return {};
@@ -69,28 +105,64 @@ optional<TCPMessage> TCPOverIPv4Adapter::unwrap_tcp_in_ip( const InternetDatagra
     return {};
   }
 
-  return tcp_seg.message;
+  return move( tcp_seg.message );
 }
 
 //! Takes a TCP segment, sets port numbers as necessary, and wraps it in an IPv4 datagram
 //! \param[in] seg is the TCP segment to convert
-InternetDatagram TCPOverIPv4Adapter::wrap_tcp_in_ip( const TCPMessage& msg )
+//! \param[in] checksum_offload is `true` if the device will finish the TCP checksum
+InternetDatagram TCPOverIPv4Adapter::wrap_tcp_in_ip( const TCPMessage& msg, bool checksum_offload )
+{
+  auto [header, seg] = wrap_headers( msg, checksum_offload );
+
+  InternetDatagram ip_dgram { .header = header, .payload = serialize( seg ) };
+  if ( not msg.sender.payload.empty() ) {
+    ip_dgram.payload.push_back( msg.sender.payload );
+  }
+  return ip_dgram;
+}
+
+pair<IPv4Header, TCPSegment> TCPOverIPv4Adapter::wrap_headers( const TCPMessage& msg, bool checksum_offload )
 {
-  TCPSegment seg { .message = msg };
+  // everything but the payload
+  TCPSegment seg { .message { .sender { .seqno = msg.sender.seqno,
+                                        .SYN = msg.sender.SYN,
+                                        .payload = {},
+                                        .FIN = msg.sender.FIN,
+                                        .RST = msg.sender.RST,
+                                        .payload_sum = {} },
+                              .receiver = msg.receiver } };
+
   // set the port numbers in the TCP segment
   seg.udinfo.src_port = config().source.port();
   seg.udinfo.dst_port = config().destination.port();
 
-  // create an Internet Datagram and set its addresses and length
-  InternetDatagram ip_dgram;
-  ip_dgram.header.src = config().source.ipv4_numeric();
-  ip_dgram.header.dst = config().destination.ipv4_numeric();
-  ip_dgram.header.len = ip_dgram.header.hlen * 4 + 20 /* tcp header len */ + seg.message.sender.payload.size();
+  // create an IPv4 header and set its addresses and length
+  IPv4Header header;
+  header.src = config().source.ipv4_numeric();
+  header.dst = config().destination.ipv4_numeric();
+  header.len = header.hlen * 4 + 20 /* tcp header len */ + msg.sender.payload.size();
+  header.compute_checksum();
 
-  // set payload, calculating TCP checksum using information from IP header
-  seg.compute_checksum( ip_dgram.header.pseudo_checksum() );
-  ip_dgram.header.compute_checksum();
-  ip_dgram.payload = serialize( seg );
+  // calculate TCP checksum using information from IP header
+  const uint32_t pseudo_checksum = header.pseudo_checksum();
+  if ( checksum_offload ) {
+    seg.compute_partial_checksum( pseudo_checksum );
+    return { header, seg };
+  }
 
-  return ip_dgram;
+  // A pure ACK differs from the previous one only in a few header words, so just update its checksum.
+  const bool pure_ack = msg.sender.sequence_length() == 0 and not msg.sender.RST and not msg.receiver.RST;
+  if ( pure_ack and _last_pure_ack.has_value() and _last_pure_ack->second == pseudo_checksum
+       and _last_pure_ack->first.udinfo.src_port == seg.udinfo.src_port
+       and _last_pure_ack->first.udinfo.dst_port == seg.udinfo.dst_port ) {
+    seg.update_checksum( _last_pure_ack->first );
+  } else {
+    seg.compute_checksum( pseudo_checksum, msg.sender.payload, msg.sender.payload_sum );
+  }
+
+  if ( pure_ack ) {
+    _last_pure_ack.emplace( seg, pseudo_checksum );
+  }
+  return { header, seg };
 }
@@ -2,15 +2,44 @@
 
 #include "fd_adapter.hh"
 #include "ipv4_datagram.hh"
+#include "ipv4_fragments.hh"
+#include "parser.hh"
 #include "tcp_segment.hh"
 
 #include <optional>
+#include <utility>
+#include <string_view>
 
 //! \brief A converter from TCP segments to serialized IPv4 datagrams
 class TCPOverIPv4Adapter : public FdAdapterBase
 {
+  std::optional<TCPMessage> unwrap_tcp_in_ip( const IPv4Header& header, Parser& payload, bool verify_checksum );
+
+  //! The last pure ACK sent (and its pseudo-header sum), whose checksum the next one is derived from
+  std::optional<std::pair<TCPSegment, uint32_t>> _last_pure_ack {};
+
+  //! Fragments of datagrams from the peer, waiting for the rest of their datagrams
+  IPv4Reassembler _reassembler {};
+
 public:
   std::optional<TCPMessage> unwrap_tcp_in_ip( const InternetDatagram& ip_dgram );
 
-  InternetDatagram wrap_tcp_in_ip( const TCPMessage& msg );
+  //! Parse a serialized IPv4 datagram in place (the TCP payload is the only copy made)
+  //! \param[in] verify_checksum is `false` if the device has already verified (or vouches for) the TCP checksum
+  std::optional<TCPMessage> unwrap_tcp_in_ip( std::string_view datagram, bool verify_checksum = true );
+
+  //! Unwrap a datagram that has been parsed in place (e.g. out of an Ethernet frame)
+  std::optional<TCPMessage> unwrap_tcp_in_ip( const IPv4DatagramView& ip_dgram );
+
+  //! \param[in] checksum_offload leaves the TCP checksum for the device to finish (see
+  //! TCPSegment::compute_partial_checksum)
+  InternetDatagram wrap_tcp_in_ip( const TCPMessage& msg, bool checksum_offload = false );
+
+  //! The IPv4 header and TCP header for `msg`, with ports, lengths and checksums filled in.
+  //! The returned segment has an empty payload: `msg.sender.payload` goes on the wire right after the two
+  //! headers, so checksumming it is the only time its bytes are read here.
+  std::pair<IPv4Header, TCPSegment> wrap_headers( const TCPMessage& msg, bool checksum_offload = false );
+
+  //! Called periodically when time elapses (times out incomplete fragmented datagrams)
+  void tick( const size_t ms_since_last_tick ) { _reassembler.tick( ms_since_last_tick ); }
 };
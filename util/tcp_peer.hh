@@ -7,8 +7,13 @@
 #include "tcp_sender.hh"
 #include "tcp_sender_message.hh"
 
+#include <algorithm>
+#include <concepts>
+#include <cstdint>
 #include <functional>
 #include <optional>
+#include <span>
+#include <utility>
 
 class TCPPeer
 {
@@ -23,54 +28,48 @@ public:
   Writer& outbound_writer() { return sender_.writer(); }
   Reader& inbound_reader() { return receiver_.reader(); }
 
-  /* Type of the `transmit` function that the push and tick methods can use to send messages */
-  using TransmitFunction = std::function<void( TCPMessage )>;
+  /* A `transmit` function that the push and tick methods can use to send messages. The methods take any
+   * callable (and are templates, so that a lambda that hands messages to an adapter is inlined): this type is
+   * for callers that need to store one. */
+  using TransmitFunction = std::function<void( const TCPMessage& )>;
 
   /* Passthrough methods */
-  void push( const TransmitFunction& transmit ) { sender_.push( make_send( transmit ) ); }
-  void tick( uint64_t t, const TransmitFunction& transmit )
+  void push( const std::invocable<const TCPMessage&> auto& transmit ) { sender_.push( make_send( transmit ) ); }
+  void tick( uint64_t t, const std::invocable<const TCPMessage&> auto& transmit )
   {
     cumulative_time_ += t;
     sender_.tick( t, make_send( transmit ) );
   }
   bool has_ackno() const { return receiver_.send().ackno.has_value(); }
 
+  /* How many ms until tick() would next change something (a retransmission or the end of lingering)? */
+  std::optional<uint64_t> time_until_deadline() const
+  {
+    std::optional<uint64_t> ret = sender_.time_until_timeout();
+    const uint64_t linger_end = time_of_last_receipt_ + 10UL * cfg_.rt_timeout;
+    if ( streams_finished() and linger_after_streams_finish_ and cumulative_time_ < linger_end ) {
+      ret = std::min( ret.value_or( UINT64_MAX ), linger_end - cumulative_time_ );
+    }
+    return ret;
+  }
+
   /* Is the peer still active? */
   bool active() const
   {
     const bool any_errors = receiver_.reader().has_error() or sender_.writer().has_error();
-    const bool sender_active = sender_.sequence_numbers_in_flight() or not sender_.reader().is_finished();
-    const bool receiver_active = not receiver_.writer().is_closed();
     const bool lingering
       = linger_after_streams_finish_ and ( cumulative_time_ < time_of_last_receipt_ + 10UL * cfg_.rt_timeout );
 
-    return ( not any_errors ) and ( sender_active or receiver_active or lingering );
+    return ( not any_errors ) and ( not streams_finished() or lingering );
   }
 
-  void receive( TCPMessage msg, const TransmitFunction& transmit )
+  void receive( TCPMessage msg, const std::invocable<const TCPMessage&> auto& transmit )
   {
     if ( not active() ) {
       return;
     }
 
-    // Record time in case this peer has to linger after streams finish.
-    time_of_last_receipt_ = cumulative_time_;
-
-    // If SenderMessage occupies a sequence number, make sure to reply.
-    need_send_ |= ( msg.sender.sequence_length() > 0 );
-
-    // If SenderMessage is a "keep-alive" (with intentionally invalid seqno), make sure to reply.
-    // (N.B. orthodox TCP rules require a reply on any unacceptable segment.)
-    const auto our_ackno = receiver_.send().ackno;
-    need_send_ |= ( our_ackno.has_value() and msg.sender.seqno + 1 == our_ackno.value() );
-
-    // Did the inbound stream finish before the outbound stream? If so, no need to linger after streams finish.
-    if ( receiver_.writer().is_closed() and not sender_.reader().is_finished() ) {
-      linger_after_streams_finish_ = false;
-    }
-
-    // Give incoming TCPSenderMessage to receiver.
-    receiver_.receive( std::move( msg.sender ) );
+    receive_sender_message( std::move( msg.sender ) );
 
     // Give incoming TCPReceiverMessage to sender.
     sender_.receive( msg.receiver );
@@ -81,6 +80,46 @@ public:
     }
   }
 
+  /* Receive a burst of messages at once (e.g. everything the network had queued up). The receiver gets every
+   * message, but the sender only the newest acknowledgment and window (of those it would accept: one that
+   * acknowledges something not yet sent doesn't hide an older, valid one), and the reply is one push of
+   * whatever the sender can now send or, if that is nothing and a reply is owed, a single ACK. */
+  void receive_batch( std::span<TCPMessage> msgs, const std::invocable<const TCPMessage&> auto& transmit )
+  {
+    if ( not active() ) {
+      return;
+    }
+
+    const Wrap32 next_seqno = sender_.make_empty_message().seqno;
+    std::optional<TCPReceiverMessage> newest;
+    for ( auto& msg : msgs ) {
+      if ( not active() ) {
+        break;
+      }
+
+      receive_sender_message( std::move( msg.sender ) );
+
+      if ( msg.receiver.RST ) {
+        sender_.receive( msg.receiver );
+        newest.reset();
+      } else if ( acknowledges_only_sent( msg.receiver, next_seqno )
+                  and ( not newest.has_value() or is_at_least_as_new( msg.receiver, newest.value() ) ) ) {
+        newest = msg.receiver;
+      }
+    }
+
+    if ( newest.has_value() ) {
+      sender_.receive( newest.value() );
+    }
+
+    if ( active() ) {
+      push( transmit );
+      if ( need_send_ ) {
+        send( sender_.make_empty_message(), transmit );
+      }
+    }
+  }
+
   // Testing interface
   const TCPReceiver& receiver() const { return receiver_; }
   const TCPSender& sender() const { return sender_; }
@@ -91,11 +130,70 @@ private:
   TCPReceiver receiver_ { Reassembler { ByteStream { cfg_.recv_capacity } } };
 
   bool need_send_ {};
+  TCPMessage outgoing_ {};
+
+  // Has the sender sent (and had acknowledged) its whole stream, and the receiver received all of its own?
+  bool streams_finished() const
+  {
+    const bool sender_active = sender_.sequence_numbers_in_flight() or not sender_.reader().is_finished();
+    const bool receiver_active = not receiver_.writer().is_closed();
+    return not sender_active and not receiver_active;
+  }
+
+  // Bookkeeping for an incoming TCPSenderMessage, which then goes to the receiver
+  void receive_sender_message( TCPSenderMessage message )
+  {
+    // Record time in case this peer has to linger after streams finish.
+    time_of_last_receipt_ = cumulative_time_;
+
+    // If SenderMessage occupies a sequence number, make sure to reply.
+    need_send_ |= ( message.sequence_length() > 0 );
+
+    // If SenderMessage is a "keep-alive" (with intentionally invalid seqno), make sure to reply.
+    // (N.B. orthodox TCP rules require a reply on any unacceptable segment.)
+    const auto our_ackno = receiver_.send().ackno;
+    need_send_ |= ( our_ackno.has_value() and message.seqno + 1 == our_ackno.value() );
+
+    // Did the inbound stream finish before the outbound stream? If so, no need to linger after streams finish.
+    if ( receiver_.writer().is_closed() and not sender_.reader().is_finished() ) {
+      linger_after_streams_finish_ = false;
+    }
+
+    // Give incoming TCPSenderMessage to receiver.
+    receiver_.receive( std::move( message ) );
+  }
+
+  // Does `msg` acknowledge at least as much as `other`? (Acknowledgments within 2^31 of each other compare
+  // correctly across wraparound; a message without an ackno is older than any with one.)
+  static bool is_at_least_as_new( const TCPReceiverMessage& msg, const TCPReceiverMessage& other )
+  {
+    if ( not other.ackno.has_value() ) {
+      return true;
+    }
+    if ( not msg.ackno.has_value() ) {
+      return false;
+    }
+    constexpr uint64_t midpoint = 1UL << 32;
+    return msg.ackno->unwrap( other.ackno.value(), midpoint ) >= midpoint;
+  }
+
+  // Does `msg` acknowledge nothing beyond `next_seqno` (the sender's next sequence number)? The sender ignores
+  // an acknowledgment of something it hasn't sent.
+  static bool acknowledges_only_sent( const TCPReceiverMessage& msg, Wrap32 next_seqno )
+  {
+    if ( not msg.ackno.has_value() ) {
+      return true;
+    }
+    constexpr uint64_t midpoint = 1UL << 32;
+    return next_seqno.unwrap( msg.ackno.value(), midpoint ) >= midpoint;
+  }
 
-  void send( const TCPSenderMessage& sender_message, const TransmitFunction& transmit )
+  void send( const TCPSenderMessage& sender_message, const std::invocable<const TCPMessage&> auto& transmit )
   {
-    TCPMessage msg { sender_message, receiver_.send() };
-    transmit( std::move( msg ) );
+    // (assigned into the same message every time, so the payload's buffer is reused)
+    outgoing_.sender = sender_message;
+    outgoing_.receiver = receiver_.send();
+    transmit( std::as_const( outgoing_ ) );
     need_send_ = false;
   }
 
@@ -1,5 +1,6 @@
 #include "tcp_segment.hh"
 #include "checksum.hh"
+#include "header_layout.hh"
 #include "wrapping_integers.hh"
 
 #include <cstddef>
@@ -8,84 +9,160 @@ static constexpr uint32_t TCPHeaderMinLen = 5; // 32-bit words
 
 using namespace std;
 
-void TCPSegment::parse( Parser& parser, uint32_t datagram_layer_pseudo_checksum )
+class Wrap32Serializable : public Wrap32
 {
-  /* verify checksum */
-  InternetChecksum check { datagram_layer_pseudo_checksum };
-  check.add( parser.buffer() );
-  if ( check.value() ) {
-    parser.set_error();
-    return;
-  }
-
-  uint32_t raw32 {};
-  uint16_t raw16 {};
-  uint8_t octet {};
-
-  parser.integer( udinfo.src_port );
-  parser.integer( udinfo.dst_port );
+public:
+  uint32_t raw_value() const { return raw_value_; }
+};
 
-  parser.integer( raw32 );
-  message.sender.seqno = Wrap32 { raw32 };
+namespace {
+// The fixed part of the header as it appears on the wire (a TCPSegment keeps the same information as a TCPMessage)
+struct TCPHeaderFields
+{
+  uint16_t src_port {};
+  uint16_t dst_port {};
+  uint32_t seqno {};
+  uint32_t ackno {};
+  uint8_t data_offset { TCPHeaderMinLen };
+  bool ack {};
+  bool rst {};
+  bool syn {};
+  bool fin {};
+  uint16_t window {};
+  uint16_t cksum {};
+};
 
-  parser.integer( raw32 );
-  message.receiver.ackno = Wrap32 { raw32 };
+using TCPHeaderLayout = HeaderLayout<Field<&TCPHeaderFields::src_port>,
+                                     Field<&TCPHeaderFields::dst_port>,
+                                     Field<&TCPHeaderFields::seqno>,
+                                     Field<&TCPHeaderFields::ackno>,
+                                     Field<&TCPHeaderFields::data_offset, 4>,
+                                     Constant<7>, // reserved, CWR, ECE, URG
+                                     Field<&TCPHeaderFields::ack, 1>,
+                                     Constant<1>, // PSH
+                                     Field<&TCPHeaderFields::rst, 1>,
+                                     Field<&TCPHeaderFields::syn, 1>,
+                                     Field<&TCPHeaderFields::fin, 1>,
+                                     Field<&TCPHeaderFields::window>,
+                                     Field<&TCPHeaderFields::cksum>,
+                                     Constant<16>>; // urgent pointer
+static_assert( TCPHeaderLayout::size == TCPHeaderMinLen * 4 );
+} // namespace
+
+void TCPSegment::parse( Parser& parser, uint32_t datagram_layer_pseudo_checksum, bool verify_checksum )
+{
+  /* verify checksum */
+  if ( verify_checksum ) {
+    InternetChecksum check { datagram_layer_pseudo_checksum };
+    parser.for_each_buffer( [&]( string_view buf ) { check.add( buf ); } );
+    if ( check.value() ) {
+      parser.set_error();
+      return;
+    }
+  }
 
-  parser.integer( octet );
-  const uint8_t data_offset = octet >> 4;
+  TCPHeaderFields fields;
+  TCPHeaderLayout::parse( fields, parser );
+  if ( parser.has_error() ) {
+    return;
+  }
 
-  parser.integer( octet ); // flags
-  if ( not( octet & 0b0001'0000 ) ) {
+  udinfo = { .src_port = fields.src_port, .dst_port = fields.dst_port, .cksum = fields.cksum };
+  message.sender.seqno = Wrap32 { fields.seqno };
+  message.receiver.ackno = Wrap32 { fields.ackno };
+  if ( not fields.ack ) {
     message.receiver.ackno.reset(); // no ACK
   }
-
-  message.sender.RST = message.receiver.RST = octet & 0b0000'0100;
-  message.sender.SYN = octet & 0b0000'0010;
-  message.sender.FIN = octet & 0b0000'0001;
-
-  parser.integer( message.receiver.window_size );
-  parser.integer( udinfo.cksum );
-  parser.integer( raw16 ); // urgent pointer
+  message.sender.RST = message.receiver.RST = fields.rst;
+  message.sender.SYN = fields.syn;
+  message.sender.FIN = fields.fin;
+  message.receiver.window_size = fields.window;
 
   // skip any options or anything extra in the header
-  if ( data_offset < TCPHeaderMinLen ) {
+  if ( fields.data_offset < TCPHeaderMinLen ) {
     parser.set_error();
   }
-  parser.remove_prefix( data_offset * 4 - TCPHeaderMinLen * 4 );
+  parser.remove_prefix( fields.data_offset * 4 - TCPHeaderMinLen * 4 );
 
   parser.all_remaining( message.sender.payload );
 }
 
-class Wrap32Serializable : public Wrap32
+namespace {
+uint8_t flags_of( const TCPMessage& message )
 {
-public:
-  uint32_t raw_value() const { return raw_value_; }
-};
+  const bool reset = message.sender.RST or message.receiver.RST;
+  return ( message.receiver.ackno.has_value() ? 0b0001'0000U : 0 ) | ( reset ? 0b0000'0100U : 0 )
+         | ( message.sender.SYN ? 0b0000'0010U : 0 ) | ( message.sender.FIN ? 0b0000'0001U : 0 );
+}
+} // namespace
 
 void TCPSegment::serialize( Serializer& serializer ) const
 {
-  serializer.integer( udinfo.src_port );
-  serializer.integer( udinfo.dst_port );
-  serializer.integer( Wrap32Serializable { message.sender.seqno }.raw_value() );
-  serializer.integer( Wrap32Serializable { message.receiver.ackno.value_or( Wrap32 { 0 } ) }.raw_value() );
-  serializer.integer( uint8_t { TCPHeaderMinLen << 4 } ); // data offset
-  const bool reset = message.sender.RST or message.receiver.RST;
-  const uint8_t flags = ( message.receiver.ackno.has_value() ? 0b0001'0000U : 0 ) | ( reset ? 0b0000'0100U : 0 )
-                        | ( message.sender.SYN ? 0b0000'0010U : 0 ) | ( message.sender.FIN ? 0b0000'0001U : 0 );
-  serializer.integer( flags );
-  serializer.integer( message.receiver.window_size );
-  serializer.integer( udinfo.cksum );
-  serializer.integer( uint16_t { 0 } ); // urgent pointer
+  const TCPHeaderFields fields { .src_port = udinfo.src_port,
+                                 .dst_port = udinfo.dst_port,
+                                 .seqno = Wrap32Serializable { message.sender.seqno }.raw_value(),
+                                 .ackno = Wrap32Serializable { message.receiver.ackno.value_or( Wrap32 { 0 } ) }
+                                            .raw_value(),
+                                 .data_offset = TCPHeaderMinLen,
+                                 .ack = message.receiver.ackno.has_value(),
+                                 .rst = message.sender.RST or message.receiver.RST,
+                                 .syn = message.sender.SYN,
+                                 .fin = message.sender.FIN,
+                                 .window = message.receiver.window_size,
+                                 .cksum = udinfo.cksum };
+  TCPHeaderLayout::serialize( fields, serializer );
   serializer.buffer( message.sender.payload );
 }
 
+array<uint16_t, 6> TCPSegment::variable_header_words() const
+{
+  const uint32_t seqno = Wrap32Serializable { message.sender.seqno }.raw_value();
+  const uint32_t ackno = Wrap32Serializable { message.receiver.ackno.value_or( Wrap32 { 0 } ) }.raw_value();
+  return { static_cast<uint16_t>( seqno >> 16 ),
+           static_cast<uint16_t>( seqno ),
+           static_cast<uint16_t>( ackno >> 16 ),
+           static_cast<uint16_t>( ackno ),
+           static_cast<uint16_t>( ( TCPHeaderMinLen << 12 ) | flags_of( message ) ),
+           message.receiver.window_size };
+}
+
 void TCPSegment::compute_checksum( uint32_t datagram_layer_pseudo_checksum )
 {
-  udinfo.cksum = 0;
-  Serializer s;
-  serialize( s );
+  compute_checksum( datagram_layer_pseudo_checksum, message.sender.payload, message.sender.payload_sum );
+}
 
-  InternetChecksum check { datagram_layer_pseudo_checksum };
-  check.add( s.output() );
+void TCPSegment::compute_checksum( uint32_t datagram_layer_pseudo_checksum,
+                                   string_view payload,
+                                   optional<uint16_t> payload_sum )
+{
+  // the header is a whole number of 16-bit words, so its fields can be summed directly
+  // (the checksum field counts as zero, and so does the urgent pointer)
+  uint32_t header_sum = udinfo.src_port + udinfo.dst_port;
+  for ( const uint16_t word : variable_header_words() ) {
+    header_sum += word;
+  }
+
+  // (the header is 20 bytes, so the payload's words line up with the payload sum's)
+  InternetChecksum check { datagram_layer_pseudo_checksum + header_sum + payload_sum.value_or( 0 ) };
+  if ( not payload_sum.has_value() ) {
+    check.add( payload );
+  }
   udinfo.cksum = check.value();
 }
+
+void TCPSegment::update_checksum( const TCPSegment& previous )
+{
+  const auto old_words = previous.variable_header_words();
+  const auto new_words = variable_header_words();
+
+  udinfo.cksum = previous.udinfo.cksum;
+  for ( size_t i = 0; i < old_words.size(); i++ ) {
+    udinfo.cksum = InternetChecksum::update( udinfo.cksum, old_words[i], new_words[i] );
+  }
+}
+
+void TCPSegment::compute_partial_checksum( uint32_t datagram_layer_pseudo_checksum )
+{
+  const InternetChecksum check { datagram_layer_pseudo_checksum };
+  udinfo.cksum = ~check.value();
+}
@@ -5,6 +5,11 @@
 #include "tcp_sender_message.hh"
 #include "udinfo.hh"
 
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
 struct TCPMessage
 {
   TCPSenderMessage sender {};
@@ -16,8 +21,27 @@ struct TCPSegment
   TCPMessage message {};
   UserDatagramInfo udinfo {};
 
-  void parse( Parser& parser, uint32_t datagram_layer_pseudo_checksum );
+  // (skip verify_checksum only if the device that delivered the segment has already verified it)
+  void parse( Parser& parser, uint32_t datagram_layer_pseudo_checksum, bool verify_checksum = true );
   void serialize( Serializer& serializer ) const;
 
+  // Checksum the header fields plus one pass over the payload (without serializing anything),
+  // or no pass at all if message.sender.payload_sum is known
   void compute_checksum( uint32_t datagram_layer_pseudo_checksum );
+
+  // Same, for a segment whose payload is kept elsewhere (message.sender.payload left empty)
+  void compute_checksum( uint32_t datagram_layer_pseudo_checksum,
+                         std::string_view payload,
+                         std::optional<uint16_t> payload_sum = {} );
+
+  // Update the checksum of `previous` (RFC 1624) for a segment that differs from it only in the seqno, ackno,
+  // flags or window (e.g. the next pure ACK, or a retransmission carrying a newer ackno)
+  void update_checksum( const TCPSegment& previous );
+
+  // Store just the folded pseudo-header sum, for a device that will finish the checksum (checksum offload)
+  void compute_partial_checksum( uint32_t datagram_layer_pseudo_checksum );
+
+  // The 16-bit header words that change between segments of one connection:
+  // seqno, ackno, data offset and flags, and window
+  std::array<uint16_t, 6> variable_header_words() const;
 };
@@ -2,6 +2,8 @@
 
 #include "wrapping_integers.hh"
 
+#include <cstdint>
+#include <optional>
 #include <string>
 
 /*
@@ -20,6 +22,9 @@
  * 4) The FIN flag. If set, the payload represents the ending of the byte stream.
  *
  * 5) The RST (reset) flag. If set, the stream has suffered an error and the connection should be aborted.
+ *
+ * It can also carry the Internet checksum's folded sum of the payload, if the sender computed it while
+ * copying the payload out of the stream, so that the checksum of the segment doesn't have to read it again.
  */
 
 struct TCPSenderMessage
@@ -32,6 +37,8 @@ struct TCPSenderMessage
 
   bool RST {};
 
+  std::optional<uint16_t> payload_sum {}; // only valid while `payload` is unchanged
+
   // How many sequence numbers does this segment use?
   size_t sequence_length() const { return SYN + payload.size() + FIN; }
 };
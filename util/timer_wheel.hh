@@ -0,0 +1,76 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+//! \brief A hashed timing wheel: a set of timers, each holding a `T`, that expire as time advances.
+//!
+//! Each timer goes in the slot for the `GranularityMs`-long interval in which it expires, so adding one is O(1),
+//! and advancing time only looks at the slots for the interval that passed (not at every timer). Timers
+//! expire at exactly their deadline; a timer further ahead than one turn of the wheel waits in its slot until
+//! the turn it's due.
+template<class T, uint64_t GranularityMs, size_t Slots>
+class TimerWheel
+{
+  struct Timer
+  {
+    uint64_t deadline;
+    T value;
+  };
+
+  std::array<std::vector<Timer>, Slots> slots_ {};
+  std::vector<Timer> expired_ {}; // kept between calls to advance(), to reuse its capacity
+  uint64_t now_ {};
+  size_t size_ {};
+
+  static size_t slot( uint64_t time ) { return time / GranularityMs % Slots; }
+
+public:
+  //! Milliseconds since the wheel was constructed
+  uint64_t now() const { return now_; }
+
+  //! Number of timers that haven't expired yet
+  size_t size() const { return size_; }
+
+  //! Add a timer that expires `delay_ms` from now
+  void add( uint64_t delay_ms, T value )
+  {
+    const uint64_t deadline = now_ + delay_ms;
+    slots_[slot( deadline )].push_back( { deadline, std::move( value ) } );
+    size_++;
+  }
+
+  //! Advance time by `ms`, and call `on_expire( value, deadline )` for every timer that has expired (in
+  //! no particular order). `on_expire` may add timers.
+  template<class F>
+  void advance( uint64_t ms, F&& on_expire )
+  {
+    const uint64_t then = now_ + ms;
+    const uint64_t intervals = then / GranularityMs - now_ / GranularityMs;
+    for ( uint64_t i = 0; i <= intervals and i < Slots; i++ ) {
+      auto& timers = slots_[slot( now_ + i * GranularityMs )];
+      size_t kept = 0;
+      for ( size_t j = 0; j < timers.size(); j++ ) {
+        if ( timers[j].deadline <= then ) {
+          expired_.push_back( std::move( timers[j] ) );
+        } else {
+          if ( kept != j ) {
+            timers[kept] = std::move( timers[j] );
+          }
+          kept++;
+        }
+      }
+      timers.erase( timers.begin() + static_cast<std::ptrdiff_t>( kept ), timers.end() );
+    }
+
+    now_ = then;
+    size_ -= expired_.size();
+    for ( auto& timer : expired_ ) {
+      on_expire( std::move( timer.value ), timer.deadline );
+    }
+    expired_.clear();
+  }
+};
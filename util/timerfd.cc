@@ -0,0 +1,45 @@
+#include "timerfd.hh"
+#include "exception.hh"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <sys/timerfd.h>
+
+using namespace std;
+using namespace std::chrono;
+
+TimerFD::TimerFD()
+  : FileDescriptor( ::CheckSystemCall( "timerfd_create",
+                                       timerfd_create( CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC ) ) )
+{}
+
+void TimerFD::arm( const nanoseconds delay )
+{
+  // an all-zero it_value would disarm the timer, so round up to the smallest representable delay
+  const auto ns = max( delay.count(), nanoseconds::rep { 1 } );
+
+  itimerspec spec {};
+  spec.it_value.tv_sec = ns / 1'000'000'000;
+  spec.it_value.tv_nsec = ns % 1'000'000'000;
+  CheckSystemCall( "timerfd_settime", timerfd_settime( fd_num(), 0, &spec, nullptr ) );
+}
+
+void TimerFD::disarm()
+{
+  const itimerspec spec {};
+  CheckSystemCall( "timerfd_settime", timerfd_settime( fd_num(), 0, &spec, nullptr ) );
+}
+
+uint64_t TimerFD::drain()
+{
+  string expirations( sizeof( uint64_t ), 0 );
+  read( expirations );
+  if ( expirations.size() != sizeof( uint64_t ) ) {
+    return 0; // not expired (EAGAIN)
+  }
+
+  uint64_t ret {};
+  memcpy( &ret, expirations.data(), sizeof( ret ) );
+  return ret;
+}
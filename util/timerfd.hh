@@ -0,0 +1,24 @@
+#pragma once
+
+#include "file_descriptor.hh"
+
+#include <chrono>
+#include <cstdint>
+
+//! A FileDescriptor to a one-shot Linux [timerfd](\ref man2::timerfd_create) on the monotonic clock
+class TimerFD : public FileDescriptor
+{
+public:
+  //! Create a non-blocking, disarmed timer
+  TimerFD();
+
+  //! Arm the timer to become readable after `delay` (a non-positive delay fires as soon as possible)
+  void arm( std::chrono::nanoseconds delay );
+
+  //! Disarm the timer (it will not become readable)
+  void disarm();
+
+  //! Acknowledge expirations so the fd stops being readable
+  //! \returns the number of expirations since the last drain (0 if there were none)
+  uint64_t drain();
+};
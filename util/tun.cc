@@ -14,6 +14,10 @@ using namespace std;
 //! \param[in] devname is the name of the TUN or TAP device, specified at its creation.
 //! \param[in] is_tun is `true` for a TUN device (expects IP datagrams), or `false` for a TAP device (expects
 //! Ethernet frames)
+//! \param[in] offload asks for a `struct virtio_net_hdr` in front of each packet (IFF_VNET_HDR), which lets
+//! the kernel finish TCP checksums and cut TCP super-segments (up to 64 KiB) into MTU-sized packets, and lets it
+//! hand us GRO-merged super-segments in return. If the kernel doesn't support this, the device is opened
+//! without it; check has_vnet_hdr().
 //!
 //! To create a TUN device, you should already have run
 //!
@@ -21,13 +25,18 @@ using namespace std;
 //!
 //! as root before calling this function.
 
-TunTapFD::TunTapFD( const string& devname, const bool is_tun )
+TunTapFD::TunTapFD( const string& devname, const bool is_tun, const bool offload )
   : FileDescriptor( ::CheckSystemCall( "open", open( CLONEDEV, O_RDWR | O_CLOEXEC ) ) )
 {
   struct ifreq tun_req
   {};
 
-  tun_req.ifr_flags = static_cast<int16_t>( ( is_tun ? IFF_TUN : IFF_TAP ) | IFF_NO_PI ); // no packetinfo
+  // probe whether this kernel supports the virtio-net header
+  unsigned int features = 0;
+  _vnet_hdr = offload and ioctl( fd_num(), TUNGETFEATURES, &features ) == 0 and ( features & IFF_VNET_HDR );
+
+  tun_req.ifr_flags = static_cast<int16_t>( ( is_tun ? IFF_TUN : IFF_TAP ) | IFF_NO_PI // no packetinfo
+                                            | ( _vnet_hdr ? IFF_VNET_HDR : 0 ) );
 
   // copy devname to ifr_name, making sure to null terminate
 
@@ -35,4 +44,17 @@ TunTapFD::TunTapFD( const string& devname, const bool is_tun )
   tun_req.ifr_name[IFNAMSIZ - 1] = '\0';
 
   CheckSystemCall( "ioctl", ioctl( fd_num(), TUNSETIFF, static_cast<void*>( &tun_req ) ) );
+
+  if ( _vnet_hdr ) {
+    int vnet_hdr_size = sizeof( VirtioNetHeader );
+    CheckSystemCall( "ioctl", ioctl( fd_num(), TUNSETVNETHDRSZ, &vnet_hdr_size ) );
+  }
+
+  // The offloads are a property of the (persistent) device, not of this open file, so always set them: otherwise
+  // the kernel could keep sending us super-segments that an earlier offloading user asked for.
+  const unsigned long offloads = _vnet_hdr ? TUN_F_CSUM | TUN_F_TSO4 : 0;
+  if ( ioctl( fd_num(), TUNSETOFFLOAD, offloads ) < 0 and _vnet_hdr ) {
+    // We can still write with a vnet header; the kernel will just send us ordinary packets.
+    ioctl( fd_num(), TUNSETOFFLOAD, 0UL );
+  }
 }
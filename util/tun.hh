@@ -2,15 +2,39 @@
 
 #include "file_descriptor.hh"
 
+#include <cstdint>
 #include <string>
 
+//! The `struct virtio_net_hdr` in front of every packet on a TUN/TAP device opened with IFF_VNET_HDR
+//! (fields are in host byte order; <linux/virtio_net.h> itself does not compile as C++)
+struct VirtioNetHeader
+{
+  static constexpr uint8_t F_NEEDS_CSUM = 1; //!< checksum from csum_start to the end is left to finish
+  static constexpr uint8_t F_DATA_VALID = 2; //!< checksum has already been verified
+  static constexpr uint8_t GSO_NONE = 0;
+  static constexpr uint8_t GSO_TCPV4 = 1;
+
+  uint8_t flags {};
+  uint8_t gso_type { GSO_NONE };
+  uint16_t hdr_len {};     //!< length of the headers to copy into each segment
+  uint16_t gso_size {};    //!< payload bytes per segment
+  uint16_t csum_start {};  //!< where the checksum computation starts
+  uint16_t csum_offset {}; //!< where (after csum_start) to store the checksum
+};
+static_assert( sizeof( VirtioNetHeader ) == 10 );
+
 //! A FileDescriptor to a [Linux TUN/TAP](https://www.kernel.org/doc/Documentation/networking/tuntap.txt) device
 class TunTapFD : public FileDescriptor
 {
+  bool _vnet_hdr = false;
+
 public:
   //! Open an existing persistent [TUN or TAP
   //! device](https://www.kernel.org/doc/Documentation/networking/tuntap.txt).
-  explicit TunTapFD( const std::string& devname, bool is_tun );
+  explicit TunTapFD( const std::string& devname, bool is_tun, bool offload = false );
+
+  //! Does every packet read or written carry a leading `struct virtio_net_hdr` (IFF_VNET_HDR)?
+  bool has_vnet_hdr() const { return _vnet_hdr; }
 };
 
 //! A FileDescriptor to a [Linux TUN](https://www.kernel.org/doc/Documentation/networking/tuntap.txt) device
@@ -18,7 +42,8 @@ class TunFD : public TunTapFD
 {
 public:
   //! Open an existing persistent [TUN device](https://www.kernel.org/doc/Documentation/networking/tuntap.txt).
-  explicit TunFD( const std::string& devname ) : TunTapFD( devname, true ) {}
+  //! \param[in] offload asks for checksum and TCP segmentation offload, if the kernel supports it
+  explicit TunFD( const std::string& devname, bool offload = false ) : TunTapFD( devname, true, offload ) {}
 };
 
 //! A FileDescriptor to a [Linux TAP](https://www.kernel.org/doc/Documentation/networking/tuntap.txt) device
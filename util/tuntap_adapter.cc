@@ -1,20 +1,83 @@
 #include "tuntap_adapter.hh"
 #include "parser.hh"
 
+#include <array>
+#include <cstring>
+#include <span>
+#include <string_view>
+
 using namespace std;
 
+namespace {
+constexpr size_t TCP_HEADER_LENGTH = 20;    // no options
+constexpr uint16_t TCP_CHECKSUM_OFFSET = 16; // offset of the checksum field in the TCP header
+
+// Largest whole number of MAX_PAYLOAD_SIZE segments that fits in one IPv4 datagram
+constexpr size_t GSO_MAX_PAYLOAD
+  = ( 65535 - IPv4Header::LENGTH - TCP_HEADER_LENGTH ) / TCPConfig::MAX_PAYLOAD_SIZE * TCPConfig::MAX_PAYLOAD_SIZE;
+} // namespace
+
 optional<TCPMessage> TCPOverIPv4OverTunFdAdapter::read()
 {
-  vector<string> strs( 2 );
-  strs.front().resize( IPv4Header::LENGTH );
-  _tun.read( strs );
-
-  InternetDatagram ip_dgram;
-  const vector<string> buffers = { strs.at( 0 ), strs.at( 1 ) };
-  if ( parse( ip_dgram, buffers ) ) {
-    return unwrap_tcp_in_ip( ip_dgram );
+  // receive into the same buffer for every datagram, and parse it in place
+  const size_t bytes_read = _tun.read( span { _read_buffer.get(), MAX_DATAGRAM_SIZE } );
+  if ( bytes_read == 0 ) {
+    return {}; // non-blocking and nothing to read
   }
-  return {};
+
+  string_view datagram { _read_buffer.get(), bytes_read };
+  bool verify_checksum = true;
+  if ( _tun.has_vnet_hdr() ) {
+    VirtioNetHeader vnet {};
+    if ( datagram.size() < sizeof( vnet ) ) {
+      return {};
+    }
+    memcpy( &vnet, datagram.data(), sizeof( vnet ) );
+    datagram.remove_prefix( sizeof( vnet ) );
+
+    // Packets from the local stack (including GRO-merged super-segments) carry only a partial checksum,
+    // for the "device" to finish; the kernel vouches for them.
+    verify_checksum = not( vnet.flags & ( VirtioNetHeader::F_NEEDS_CSUM | VirtioNetHeader::F_DATA_VALID ) );
+  }
+
+  return unwrap_tcp_in_ip( datagram, verify_checksum );
+}
+
+void TCPOverIPv4OverTunFdAdapter::write( const TCPMessage& seg )
+{
+  // Each header is serialized in place in front of the one inside it, so the headers end up as one region;
+  // the payload goes from the TCPMessage to the kernel directly.
+  const bool offload = _tun.has_vnet_hdr();
+  const auto [ip_header, tcp_header] = wrap_headers( seg, offload );
+
+  _write_buffer.clear();
+  Serializer tcp_serializer { _write_buffer.prepend( TCP_HEADER_LENGTH ) };
+  tcp_header.serialize( tcp_serializer );
+  Serializer ip_serializer { _write_buffer.prepend( IPv4Header::LENGTH ) };
+  ip_header.serialize( ip_serializer );
+
+  // with offload, leave the TCP checksum to the kernel, and have it cut super-segments into
+  // MAX_PAYLOAD_SIZE segments
+  if ( offload ) {
+    VirtioNetHeader vnet {};
+    vnet.flags = VirtioNetHeader::F_NEEDS_CSUM;
+    vnet.csum_start = IPv4Header::LENGTH;
+    vnet.csum_offset = TCP_CHECKSUM_OFFSET;
+    if ( seg.sender.payload.size() > TCPConfig::MAX_PAYLOAD_SIZE ) {
+      vnet.gso_type = VirtioNetHeader::GSO_TCPV4;
+      vnet.gso_size = TCPConfig::MAX_PAYLOAD_SIZE;
+      vnet.hdr_len = IPv4Header::LENGTH + TCP_HEADER_LENGTH;
+    }
+    memcpy( _write_buffer.prepend( sizeof( vnet ) ).data(), &vnet, sizeof( vnet ) );
+  }
+
+  const array<string_view, 2> buffers { _write_buffer.contents(), seg.sender.payload };
+  _tun.write( buffers );
+}
+
+size_t TCPOverIPv4OverTunFdAdapter::max_payload_size() const
+{
+  return _tun.has_vnet_hdr() ? GSO_MAX_PAYLOAD : TCPConfig::MAX_PAYLOAD_SIZE;
 }
 
 //! Specialize LossyFdAdapter to TCPOverIPv4OverTunFdAdapter
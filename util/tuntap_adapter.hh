@@ -1,12 +1,16 @@
 #pragma once
 
+#include "packet_buffer.hh"
 #include "tcp_over_ip.hh"
 #include "tcp_segment.hh"
 #include "tun.hh"
 
+#include <memory>
 #include <optional>
+#include <string>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 template<class T>
 concept TCPDatagramAdapter = requires( T a, TCPMessage seg ) {
@@ -25,6 +29,18 @@ class TCPOverIPv4OverTunFdAdapter : public TCPOverIPv4Adapter
 private:
   TunFD _tun;
 
+  //! Largest datagram read() will accept (the maximum IPv4 total length)
+  static constexpr size_t MAX_DATAGRAM_SIZE = 65535;
+
+  //! Buffer that read() receives every datagram into and parses in place
+  std::unique_ptr<char[]> _read_buffer { std::make_unique<char[]>( MAX_DATAGRAM_SIZE ) }; // NOLINT(*-c-arrays)
+
+  //! Room for all of write()'s headers: the vnet header, the IPv4 header, and the TCP header (no options)
+  static constexpr size_t MAX_HEADERS_SIZE = sizeof( VirtioNetHeader ) + IPv4Header::LENGTH + 20;
+
+  //! Buffer that write() serializes every datagram's headers into, in place and without allocating
+  PacketBuffer _write_buffer { MAX_HEADERS_SIZE, MAX_HEADERS_SIZE };
+
 public:
   //! Construct from a TunFD
   explicit TCPOverIPv4OverTunFdAdapter( TunFD&& tun ) : _tun( std::move( tun ) ) {}
@@ -33,7 +49,10 @@ public:
   std::optional<TCPMessage> read();
 
   //! Creates an IPv4 datagram from a TCP segment and writes it to the TUN device
-  void write( const TCPMessage& seg ) { _tun.write( serialize( wrap_tcp_in_ip( seg ) ) ); }
+  void write( const TCPMessage& seg );
+
+  //! With segmentation offload, the kernel cuts a super-segment of up to 64 KiB into MAX_PAYLOAD_SIZE segments
+  size_t max_payload_size() const;
 
   //! Access the underlying TUN device
   explicit operator TunFD&() { return _tun; }